@@ -1,1178 +1,4151 @@
-/*
-  Conceptinetics.cpp - DMX library for Arduino
-  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
-
-  This library is free software; you can redistribute it and/or
-  modify it under the terms of the GNU Lesser General Public
-  License as published by the Free Software Foundation; either
-  version 3 of the License, or (at your option) any later version.
-
-  This library is distributed in the hope that it will be useful,
-  but WITHOUT ANY WARRANTY; without even the implied warranty of
-  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
-  Lesser General Public License for more details.
-
-  You should have received a copy of the GNU Lesser General Public
-  License along with this library; if not, write to the Free Software
-  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
-*/
-
-/*
-  This code has been tested using the following hardware:
-
-  - Arduino UNO R3 using a CTC-DRA-13-1 ISOLATED DMX-RDM SHIELD 
-  - Arduino MEGA2560 R3 using a CTC-DRA-13-1 ISOLATED DMX-RDM SHIELD 
-*/
-
-
-#include "pins_arduino.h"
-#include "Conceptinetics.h"
-
-#include <inttypes.h>
-#include <stdlib.h>
-
-#include <avr/interrupt.h>
-#include <avr/io.h>
-
-#include <util/delay.h>
-
-
-#if defined (USE_DMX_SERIAL_0)
-
-    #if defined (USART__TXC_vect)
-      #define USART_TX USART__TXC_vect
-    #elif defined(USART_TX_vect)
-      #define USART_TX  USART_TX_vect
-    #elif defined(USART0_TX_vect)
-      #define USART_TX USART0_TX_vect
-    #endif 
-
-    #if defined (USART__RXC_vect)
-      #define USART_RX USART__RXC_vect
-    #elif defined(USART_RX_vect)
-      #define USART_RX  USART_RX_vect
-    #elif defined(USART0_RX_vect)
-      #define USART_RX USART0_RX_vect
-    #endif 
-
-    #if defined UDR
-      #define DMX_UDR UDR
-    #elif defined UDR0
-      #define DMX_UDR UDR0
-    #endif
-
-    #if defined(UBRRH) && defined(UBRRL)
-      #define DMX_UBRRH UBRRH
-      #define DMX_UBRRL UBRRL
-    #elif defined(UBRR0H) && defined(UBRR0L)
-      #define DMX_UBRRH UBRR0H
-      #define DMX_UBRRL UBRR0L
-    #endif
-
-    #if defined(UCSRA)
-      #define DMX_UCSRA UCSRA
-    #elif defined(UCSR0A)
-      #define DMX_UCSRA UCSR0A
-    #endif
-
-    #if defined(UCSRB)
-       #define DMX_UCSRB UCSRB
-    #elif defined (UCSR0B)
-       #define DMX_UCSRB UCSR0B
-    #endif
-
-    #if defined(TXEN) && defined(TXCIE)
-        #define DMX_TXEN TXEN
-        #define DMX_TXCIE TXCIE
-    #elif defined(TXEN0) && defined(TXCIE0)
-        #define DMX_TXEN TXEN0
-        #define DMX_TXCIE TXCIE0
-    #endif
-
-    #if defined(RXEN) && defined(RXCIE)
-        #define DMX_RXEN RXEN
-        #define DMX_RXCIE RXCIE
-    #elif defined(RXEN0) && defined(RXCIE0)
-        #define DMX_RXEN RXEN0
-        #define DMX_RXCIE RXCIE0
-    #endif
-
-    #if defined(FE)
-      #define DMX_FE FE
-    #elif defined(FE0)
-      #define DMX_FE FE0
-    #endif
-
-    #define RX_PIN 0
-    #define TX_PIN 1
-
-#elif defined (USE_DMX_SERIAL_1)
-    #define USART_RX USART1_RX_vect
-    #define USART_TX USART1_TX_vect
-    #define DMX_UDR UDR1
-    #define DMX_UBRRH UBRR1H
-    #define DMX_UBRRL UBRR1L
-    #define DMX_UCSRA UCSR1A
-    #define DMX_UCSRB UCSR1B
-    #define DMX_TXEN TXEN1
-    #define DMX_TXCIE TXCIE1
-    #define DMX_RXEN RXEN1
-    #define DMX_RXCIE RXCIE1
-    #define DMX_FE FE1
-    #define RX_PIN 19
-    #define TX_PIN 18
-#elif defined (USE_DMX_SERIAL_2)
-    #define USART_RX USART2_RX_vect
-    #define USART_TX USART2_TX_vect
-    #define DMX_UDR UDR2
-    #define DMX_UBRRH UBRR2H
-    #define DMX_UBRRL UBRR2L
-    #define DMX_UCSRA UCSR2A
-    #define DMX_UCSRB UCSR2B
-    #define DMX_TXEN TXEN2
-    #define DMX_TXCIE TXCIE2
-    #define DMX_RXEN RXEN2
-    #define DMX_RXCIE RXCIE2
-    #define DMX_FE FE2
-    #define RX_PIN 17
-    #define TX_PIN 16
-#elif defined (USE_DMX_SERIAL_3)
-    #define USART_RX USART3_RX_vect
-    #define USART_TX USART3_TX_vect
-    #define DMX_UDR UDR3
-    #define DMX_UBRRH UBRR3H
-    #define DMX_UBRRL UBRR3L
-    #define DMX_UCSRA UCSR3A
-    #define DMX_UCSRB UCSR3B
-    #define DMX_TXEN TXEN3
-    #define DMX_TXCIE TXCIE3
-    #define DMX_RXEN RXEN3
-    #define DMX_RXCIE RXCIE3
-    #define DMX_FE FE3
-    #define RX_PIN 14
-    #define TX_PIN 15
-#endif
-
-
-#define LOWBYTE(v)   ((uint8_t) (v))
-#define HIGHBYTE(v)  ((uint8_t) (((uint16_t) (v)) >> 8))
-
-#define BSWAP_16(x)  ( (uint8_t)((x) >> 8) | ((uint8_t)(x)) << 8 )
-
-namespace isr
-{
-    enum isrState
-    {
-        Idle,
-        Break,
-        DmxBreak,
-        DmxBreakManual,
-        DmxStartByte,   
-        DmxRecordData,
-        DmxTransmitData,
-        RdmStartByte,
-        RdmRecordData,
-        RdmTransmitData,
-    };
-
-    enum isrMode
-    {
-        Disabled,
-        Receive,
-        DMXTransmit,
-        DMXTransmitManual,  /* Manual break... */
-        RDMTransmit,
-        RDMTransmitNoInt,   /* Setup uart but leave interrupt disabled */
-    };
-};
-
-
-DMX_Master      *__dmx_master;
-DMX_Slave       *__dmx_slave;
-RDM_Responder   *__rdm_responder;
-
-int8_t          __re_pin;                               // R/W Pin on shield
-
-isr::isrState   __isr_txState;                          // TX ISR state
-isr::isrState   __isr_rxState;                          // RX ISR state
-
-
-void SetISRMode ( isr::isrMode );
-
-
-DMX_FrameBuffer::DMX_FrameBuffer ( uint16_t buffer_size )
-{
-    m_refcount = (uint8_t*) malloc ( sizeof ( uint8_t ) );
-
-    if ( buffer_size >= DMX_MIN_FRAMESIZE && buffer_size <= DMX_MAX_FRAMESIZE )
-    {
-        m_buffer = (uint8_t*) malloc ( buffer_size );
-        if ( m_buffer != NULL )
-        {
-            memset ( (void *)m_buffer, 0x0, buffer_size );
-            m_bufferSize = buffer_size;
-        }
-        else 
-            m_buffer = 0x0;
-    }
-    else
-        m_bufferSize = 0x0;
-
-    *m_refcount++;
-}
-
-DMX_FrameBuffer::DMX_FrameBuffer ( DMX_FrameBuffer &buffer )
-{
-    // Copy references and make sure the parent object does not dispose our
-    // buffer when deleted and we are still active
-    this->m_refcount = buffer.m_refcount;
-    (*this->m_refcount)++;
-    
-    this->m_buffer = buffer.m_buffer;
-    this->m_bufferSize = buffer.m_bufferSize;
-}
-
-DMX_FrameBuffer::~DMX_FrameBuffer ( void )
-{
-    // If we are the last object using the
-    // allocated buffer then free it together
-    // with the refcounter
-    if ( --(*m_refcount) == 0 )
-    {
-        if ( m_buffer )
-            free ( m_buffer );
-
-        free ( m_refcount );
-    }
-}
-
-uint16_t DMX_FrameBuffer::getBufferSize ( void )
-{
-    return m_bufferSize;
-}        
-
-
-uint8_t DMX_FrameBuffer::getSlotValue ( uint16_t index )
-{
-    if (index < m_bufferSize)
-        return m_buffer[index];
-    else
-        return 0x0;
-}
-
-
-void DMX_FrameBuffer::setSlotValue ( uint16_t index, uint8_t value )
-{
-    if ( index < m_bufferSize )
-        m_buffer[index] = value;
-}
-
-
-void DMX_FrameBuffer::setSlotRange ( uint16_t start, uint16_t end, uint8_t value )
-{
-    if ( start < m_bufferSize && end < m_bufferSize && start < end )
-        memset ( (void *) &m_buffer[start], value, end-start );
-}
-
-void DMX_FrameBuffer::clear ( void )
-{
-    memset ( (void *) m_buffer, 0x0, m_bufferSize );
-}        
-
-uint8_t &DMX_FrameBuffer::operator[] ( uint16_t index )
-{
-    return m_buffer[index];
-}
-
-
-DMX_Master::DMX_Master ( DMX_FrameBuffer &buffer, int readEnablePin )
-: m_frameBuffer ( buffer ), 
-  m_autoBreak ( 1 )                                     // Autobreak generation is default on
-{
-    setStartCode ( DMX_START_CODE );    
-
-    __re_pin = readEnablePin;
-    ::SetISRMode ( isr::Disabled );
-}
-
-DMX_Master::DMX_Master ( uint16_t maxChannel, int readEnablePin )
-: m_frameBuffer ( maxChannel + DMX_STARTCODE_SIZE ), 
-  m_autoBreak ( 1 )                                     // Autobreak generation is default on
-{
-    setStartCode ( DMX_START_CODE );
-
-    __re_pin = readEnablePin;
-    ::SetISRMode ( isr::Disabled );
-}
-
-DMX_Master::~DMX_Master ( void )
-{
-    disable ();                                         // Stop sending
-    __dmx_master = NULL;
-}
-
-DMX_FrameBuffer &DMX_Master::getBuffer ( void )
-{
-    return m_frameBuffer;                               // Return reference to frame buffer
-}
-
-void DMX_Master::setStartCode ( uint8_t value )
-{
-    m_frameBuffer[0] = value;                           // Set the first byte in our frame buffer
-}
-
-void DMX_Master::setChannelValue ( uint16_t channel, uint8_t value )
-{
-    if ( channel > 0 )                                  // Prevent overwriting the start code
-        m_frameBuffer.setSlotValue ( channel, value );
-}
-
-void DMX_Master::setChannelRange ( uint16_t start, uint16_t end, uint8_t value )
-{
-    if ( start > 0 )                                    // Prevent overwriting the start code
-        m_frameBuffer.setSlotRange ( start, end, value );
-}
-
-
-void DMX_Master::enable  ( void )
-{
-    __dmx_master = this;  
-
-    if ( m_autoBreak )
-        ::SetISRMode ( isr::DMXTransmit );
-    else
-        ::SetISRMode ( isr::DMXTransmitManual );
-}
-
-void DMX_Master::disable ( void )
-{
-     ::SetISRMode ( isr::Disabled );
-    __dmx_master = NULL;                                // No active master
-}
-
-void    DMX_Master::setAutoBreakMode ( void ) { m_autoBreak = 1; }
-void    DMX_Master::setManualBreakMode ( void ) { m_autoBreak = 0; }
-uint8_t DMX_Master::autoBreakEnabled ( void ) { return m_autoBreak; }
-
-
-uint8_t DMX_Master::waitingBreak ( void )
-{
-    return ( __isr_txState == isr::DmxBreakManual );
-}
-        
-void DMX_Master::breakAndContinue ( uint8_t breakLength_us )
-{
-    // Only execute if we are the controlling master object
-    if ( __dmx_master == this && __isr_txState == isr::DmxBreakManual )
-    {
-        pinMode ( TX_PIN, OUTPUT );
-        digitalWrite ( TX_PIN, LOW );               // Begin BREAK                               
-
-        for (uint8_t bl=0; bl<breakLength_us; bl++)
-            _delay_us ( 1 );
-
-        // Turn TX Pin into Logic HIGH
-        digitalWrite ( TX_PIN, HIGH );              // END BREAK
-
-        __isr_txState = isr::DmxStartByte;
-   
-        // TX Enable
-        DMX_UCSRB |= (1<<DMX_TXEN);
-
-        _delay_us ( 12 );                           // MAB 12µSec
-        
-        // TX Interupt enable
-        DMX_UCSRB |= (1<<DMX_TXCIE);
-    }
-}
-
-
-void (*DMX_Slave::event_onFrameReceived)(unsigned short channelsReceived);
-
-
-DMX_Slave::DMX_Slave ( DMX_FrameBuffer &buffer, int readEnablePin )
-: DMX_FrameBuffer ( buffer ), 
-  m_startAddress ( 1 )
-{
-    __dmx_slave = this;
-    __re_pin    = readEnablePin;
-
-    ::SetISRMode ( isr::Disabled );
-}
-
-DMX_Slave::DMX_Slave ( uint16_t nrChannels, int readEnablePin )
-: DMX_FrameBuffer ( nrChannels + 1 ), 
-  m_startAddress ( 1 )
-{
-    __dmx_slave = this;
-    __re_pin    = readEnablePin;
-
-    ::SetISRMode ( isr::Disabled );
-}
-
-DMX_Slave::~DMX_Slave ( void )
-{
-    disable ();
-    __dmx_slave = NULL;
-}
-
-
-void DMX_Slave::enable ( void )
-{
-    ::SetISRMode ( isr::Receive );
-}
-
-void DMX_Slave::disable ( void )
-{
-    ::SetISRMode ( isr::Disabled );
-}
-
-DMX_FrameBuffer &DMX_Slave::getBuffer ( void )
-{
-    return reinterpret_cast<DMX_FrameBuffer&>(*this);
-}
-
-    uint8_t DMX_Slave::getChannelValue ( uint16_t channel )
-{
-    return getSlotValue ( channel );
-}
-
-
-uint16_t DMX_Slave::getStartAddress ( void )
-{
-    return m_startAddress;
-}
-
-void DMX_Slave::setStartAddress ( uint16_t addr )
-{
-    m_startAddress = addr;
-}
-
-void DMX_Slave::onReceiveComplete ( void (*func)(unsigned short) )
-{
-    event_onFrameReceived = func;
-}
-
-
-bool DMX_Slave::processIncoming ( uint8_t val, bool first )
-{
-    static uint16_t idx;
-    bool            rval = false;
-
-    if ( first )
-    {
-        // We could have received less channels then we
-        // expected.. but still is a complete frame
-        if (m_state == dmx::dmxData && event_onFrameReceived)
-            event_onFrameReceived (idx);
-            
-        m_state = dmx::dmxStartByte;  
-    } 
-
-    switch ( m_state )
-    {
-        case dmx::dmxStartByte:
-            setSlotValue ( 0, val );    // Store start code
-            idx = m_startAddress;
-            m_state = dmx::dmxWaitStartAddress;
-
-        case dmx::dmxWaitStartAddress:
-            if ( --idx == 0 )
-                m_state = dmx::dmxData;
-            break;
-
-        case dmx::dmxData:
-            if ( idx++ < getBufferSize() )
-                setSlotValue ( idx, val );
-            else
-            {
-                m_state = dmx::dmxFrameReady;
-
-                // If a onFrameReceived callback is register...
-                if (event_onFrameReceived)
-                    event_onFrameReceived (idx-2);
-                
-                rval = true;
-            }
-            break;
-    }
-
-    return rval;
-}
-
-
-uint16_t RDM_FrameBuffer::getBufferSize ( void ) { return sizeof ( m_msg ); }   
-
-uint8_t RDM_FrameBuffer::getSlotValue ( uint16_t index )
-{
-    if ( index < sizeof ( m_msg ) )
-        return m_msg.d[index];
-    else
-        return 0x0;
-}
-
-
-void RDM_FrameBuffer::setSlotValue ( uint16_t index, uint8_t value )
-{
-    if ( index < sizeof ( m_msg ) )
-        m_msg.d[index] = value;
-}
-
-void RDM_FrameBuffer::clear ( void )
-{
-    memset ( (void*)m_msg.d, 0x0, sizeof( m_msg ) ); 
-    m_state             = rdm::rdmUnknown;
-}
-
-bool RDM_FrameBuffer::processIncoming ( uint8_t val, bool first )
-{
-    static uint16_t idx;
-    bool            rval = false;
-
-    if ( first )
-    {
-        m_state = rdm::rdmStartByte;
-        m_csCalc.checksum   = (uint16_t) 0x0000;
-        idx = 0;
-    }
-
-    // Prevent buffer overflow for large messages
-    if (idx >= sizeof(m_msg))
-        return true;
-
-    switch ( m_state )
-    {
-        case rdm::rdmStartByte: 
-            m_msg.startCode = val;
-            m_state = rdm::rdmSubStartCode;
-            break;
-
-        case rdm::rdmSubStartCode:
-            if ( val != 0x01 )
-            {
-                rval = true;                        // Stop processing data
-                break;
-            }
-
-            m_msg.subStartCode = val;
-            m_state = rdm::rdmMessageLength;
-            break;
-
-        case rdm::rdmMessageLength:
-            m_msg.msgLength = val;
-            m_state = rdm::rdmData;
-            m_csCalc.checksum = 0xcc + 0x01 + val;  // set initial checksum 
-            idx = 3;                                // buffer index for next byte
-            break;
-
-        case rdm::rdmData:
-            m_msg.d[idx++] = val;
-            m_csCalc.checksum += val;
-            if ( idx >= m_msg.msgLength )
-                m_state = rdm::rdmChecksumHigh;
-            break;
-
-        case rdm::rdmChecksumHigh:
-            m_csRecv.csh = val;
-            m_state = rdm::rdmChecksumLow;
-            
-            break;
-
-        case rdm::rdmChecksumLow:
-            m_csRecv.csl = val;
-
-            if ((m_csCalc.checksum % (uint16_t)0x10000) == m_csRecv.checksum)
-            { 
-                m_state = rdm::rdmFrameReady;
-                
-                // valid checksum ... start processing
-                processFrame ();
-            }
-
-            m_state = rdm::rdmUnknown;
-            rval = true;
-            break;
-    };
-
-    return rval;
-}
-
-bool RDM_FrameBuffer::fetchOutgoing ( volatile uint8_t *udr, bool first )
-{
-    static uint16_t idx;
-    bool            rval = false;
-
-
-    if ( first )
-    {
-        m_state             = rdm::rdmData;
-        m_csCalc.checksum   = (uint16_t) 0x0000;
-        idx                 = 0;
-    }
-
-    switch ( m_state )
-    {
-        case rdm::rdmData:
-            m_csCalc.checksum += m_msg.d[idx];
-            *udr = m_msg.d[idx++];
-            if ( idx >= m_msg.msgLength )
-            {
-                m_csCalc.checksum = (m_csCalc.checksum % (uint16_t)0x10000);
-                m_state = rdm::rdmChecksumHigh;
-            }
-            break;
-        
-        case rdm::rdmChecksumHigh:
-            *udr = m_csCalc.csh;
-            m_state = rdm::rdmChecksumLow;
-            break;
-
-        case rdm::rdmChecksumLow:
-            *udr = m_csCalc.csl;
-            m_state = rdm::rdmUnknown;
-            rval = true;
-            break;
-
-    }
-
-    return rval;
-}
-
-
-void (*RDM_Responder::event_onIdentifyDevice)(bool);
-void (*RDM_Responder::event_onDeviceLabelChanged)(const char*, uint8_t);
-void (*RDM_Responder::event_onDMXStartAddressChanged)(uint16_t);
-void (*RDM_Responder::event_onDMXPersonalityChanged)(uint8_t);
-
-//
-// slave parameter is only used to ensure a slave object is present before
-// initializing the rdm responder class
-//
-RDM_Responder::RDM_Responder ( uint16_t m, uint8_t d1, uint8_t d2, 
-                               uint8_t d3, uint8_t d4, DMX_Slave &slave )
-:   RDM_FrameBuffer ( ),
-    m_Personalities (1),    // Available personlities
-    m_Personality (1)       // Default personality eq 1.
-{
-    __rdm_responder = this;
-    m_devid.Initialize ( m, d1, d2, d3, d4 );
-
-    // Default software version id = 0x00000000
-    memset ( (void*)m_SoftwareVersionId, 0x0, 0x4 );
-
-    // Rdm responder is disabled by default
-    m_rdmStatus.enabled = false;
-}
-
-RDM_Responder::~RDM_Responder ( void )
-{
-    __rdm_responder = NULL;
-}
-
-void RDM_Responder::onIdentifyDevice ( void (*func)(bool) )
-{
-    event_onIdentifyDevice = func;
-}
-
-void RDM_Responder::onDeviceLabelChanged ( void (*func) (const char*, uint8_t) )
-{
-    event_onDeviceLabelChanged = func;
-}
-
-void RDM_Responder::onDMXStartAddressChanged ( void (*func) (uint16_t) )
-{
-    event_onDMXStartAddressChanged = func;
-}
-
-void RDM_Responder::onDMXPersonalityChanged ( void (*func) (uint8_t) )
-{
-    event_onDMXPersonalityChanged = func;
-}
-
-void RDM_Responder::setDeviceLabel ( const char *label, size_t len )
-{
-    if ( len > RDM_MAX_DEVICELABEL_LENGTH )
-        len = RDM_MAX_DEVICELABEL_LENGTH;
-
-    memcpy ( (void *)m_deviceLabel, (void *)label, len );
-}
-
-void RDM_Responder::repondDiscUniqueBranch ( void )
-{
-    #if defined(UCSRB)
-	UCSRB  = (1<<TXEN);								
-    #elif defined(UCSR0B)
-	UCSR0B = (1<<TXEN0);
-    #endif 
-
-    uint16_t cs = 0;
-
-    uint8_t response[24] =
-    {
-    0xfe, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe, 0xaa,     // byte 0-7
-    m_devid.m_id[0] | 0xaa, m_devid.m_id[0] | 0x55,     // byte 8, 10   MSB manufacturer
-    m_devid.m_id[1] | 0xaa, m_devid.m_id[1] | 0x55,     // byte 10, 11  LSB manufacturer
-    m_devid.m_id[2] | 0xaa, m_devid.m_id[2] | 0x55,     // byte 12, 13  MSB device
-    m_devid.m_id[3] | 0xaa, m_devid.m_id[3] | 0x55,     // byte 14, 15   .
-    m_devid.m_id[4] | 0xaa, m_devid.m_id[4] | 0x55,     // byte 16, 17   .
-    m_devid.m_id[5] | 0xaa, m_devid.m_id[5] | 0x55,     // byte 18, 19  LSB device
-    0x0, 0x0, 0x0, 0x0                                  // Checksum space
-    };
-
-    // Calculate checksum
-    for ( int i=8; i<20; i++ )
-        cs += (uint16_t)response [i];
-
-    // Write checksum into response
-    response [20] = HIGHBYTE (cs) | 0xaa;
-    response [21] = HIGHBYTE (cs) | 0x55;
-    response [22] = LOWBYTE  (cs) | 0xaa;
-    response [23] = LOWBYTE  (cs) | 0x55;
-
-    // Set shield to transmit mode (turn arround)
-    digitalWrite ( __re_pin, HIGH );
-    
-    // Table 3-2 ANSI_E1-20-2010 <2ms 
-    _delay_us ( MIN_RESPONDER_PACKET_SPACING_USEC );
-
-    for ( int i=0; i<24; i++ )
-    {
-        // Wait until data register is empty
-        #if defined (UCSR0A) && defined (UDRE0)
-        while((UCSR0A & (1 <<UDRE0)) == 0);	
-        #elif defined (UCSRA) && defined (UDRE)
-        while((UCSRA & (1 <<UDRE)) == 0);	
-        #endif
-        
-        DMX_UDR = response[i];
-    }
-
-    // Wait until last byte is send
-    #if defined (UCSR0A) && defined (UDRE0)
-    while((UCSR0A & (1 <<UDRE0)) == 0);	
-    #elif defined (UCSRA) && defined (UDRE)
-    while((UCSRA & (1 <<UDRE)) == 0);	
-    #endif
-
-    // Restore ISR operations
-    ::SetISRMode ( isr::Receive );
-}
-
-void RDM_Responder::populateDeviceInfo ( void )
-{
-    RDM__DeviceInfoPD *pd = reinterpret_cast<RDM__DeviceInfoPD *>(m_msg.PD);
-
-    pd->protocolVersionMajor        = 0x01;
-    pd->protocolVersionMinor        = 0x00;
-    pd->deviceModelId               = BSWAP_16(m_DeviceModelId);
-    pd->ProductCategory             = BSWAP_16(m_ProductCategory);
-    memcpy ( (void*)pd->SoftwareVersionId, (void*)m_SoftwareVersionId, 4 );
-    pd->DMX512FootPrint             = BSWAP_16(__dmx_slave->getBufferSize()-1); // eq buffersize-startbyte
-    pd->DMX512CurrentPersonality    = m_Personality;
-    pd->DMX512NumberPersonalities   = m_Personalities;
-    pd->DMX512StartAddress          = BSWAP_16(__dmx_slave->getStartAddress());
-
-    pd->SubDeviceCount              = 0x0; // Sub devices are not supported by this library
-    pd->SensorCount                 = 0x0; // Sensors are not yet supported
-
-    m_msg.PDL = sizeof (RDM__DeviceInfoPD);
-}
-
-const uint8_t ManufacturerLabel_P[] PROGMEM = "Conceptinetics"; 
-
-void RDM_Responder::processFrame ( void )
-{
-    // If packet is a general broadcast   
-    if (
-        m_msg.dstUid.isBroadcast (m_devid.m_id) ||  
-        m_devid == m_msg.dstUid
-       )
-    {
-        // Set default response type
-        m_msg.portId    = rdm::ResponseTypeAck; 
-        
-        switch ( BSWAP_16(m_msg.PID) )
-        {
-            case rdm::DiscUniqueBranch:
-                digitalWrite (13, HIGH);
-
-                // Check if we are inside the given unique branch...
-                if ( !m_rdmStatus.mute &&
-                     reinterpret_cast<RDM_DiscUniqueBranchPD *>(m_msg.PD)->lbound < m_devid &&
-                     reinterpret_cast<RDM_DiscUniqueBranchPD *>(m_msg.PD)->hbound > m_devid )
-                {
-                    // Discovery messages are responded with data only and no breaks
-                    repondDiscUniqueBranch ();
-                }
-                break;
-
-            case rdm::DiscMute:
-                reinterpret_cast<RDM_DiscMuteUnMutePD *>(m_msg.PD)->ctrlField = 0x0;
-                m_msg.PDL = sizeof ( RDM_DiscMuteUnMutePD );
-                m_rdmStatus.mute = true;
-                break;
-
-            case rdm::DiscUnMute:
-                reinterpret_cast<RDM_DiscMuteUnMutePD *>(m_msg.PD)->ctrlField = 0x0;
-                m_msg.PDL = sizeof ( RDM_DiscMuteUnMutePD );
-                m_rdmStatus.mute = false;
-                break;
-
-            case rdm::SupportedParameters:
-                //
-                // Temporary solution... this will become dynamic
-                // in a later version...
-                //
-                m_msg.PD[0] = HIGHBYTE(rdm::DmxStartAddress);   // MSB
-                m_msg.PD[1] = LOWBYTE (rdm::DmxStartAddress);   // LSB
-                
-                m_msg.PD[2] = HIGHBYTE(rdm::DmxPersonality);
-                m_msg.PD[3] = LOWBYTE (rdm::DmxPersonality);
-                
-                m_msg.PD[4] = HIGHBYTE(rdm::ManufacturerLabel);
-                m_msg.PD[5] = LOWBYTE (rdm::ManufacturerLabel);
-
-                m_msg.PD[6] = HIGHBYTE(rdm::DeviceLabel);
-                m_msg.PD[7] = LOWBYTE (rdm::DeviceLabel);
-
-                m_msg.PDL   = 0x6;
-                break;
-
-            // Only for manufacturer specific parameters
-            // case rdm::ParameterDescription:
-            //    break;
-
-            case rdm::DeviceInfo:
-                if ( m_msg.CC == rdm::GetCommand )
-                    populateDeviceInfo ();
-                break;
-
-            case rdm::DmxStartAddress:                
-                if ( m_msg.CC == rdm::GetCommand )
-                {
-                    m_msg.PD[0] = HIGHBYTE(__dmx_slave->getStartAddress ());
-                    m_msg.PD[1] = LOWBYTE (__dmx_slave->getStartAddress ());
-                    m_msg.PDL   = 0x2;
-                }
-                else // if (  m_msg.CC == rdm::SetCommand  )
-                {
-                    __dmx_slave->setStartAddress ( (m_msg.PD[0] << 8) + m_msg.PD[1] );
-                    m_msg.PDL   = 0x0;
-
-                    if ( event_onDMXStartAddressChanged )
-                        event_onDMXStartAddressChanged ( (m_msg.PD[0] << 8) + m_msg.PD[1] );
-                }
-                break;
-
-            case rdm::DmxPersonality:
-                if ( m_msg.CC == rdm::GetCommand )
-                {
-                    reinterpret_cast<RDM_DeviceGetPersonality_PD *>
-                        (m_msg.PD)->DMX512CurrentPersonality = m_Personality;
-                    reinterpret_cast<RDM_DeviceGetPersonality_PD *>
-                        (m_msg.PD)->DMX512CurrentPersonality = m_Personalities;
-                    m_msg.PDL   = sizeof (RDM_DeviceGetPersonality_PD);
-                }
-                else // if (  m_msg.CC == rdm::SetCommand  )
-                {
-                     m_Personality = reinterpret_cast<RDM_DeviceSetPersonality_PD *>
-                        (m_msg.PD)->DMX512Personality;
-                     m_msg.PDL = 0x0;
-
-                     if ( event_onDMXPersonalityChanged )
-                        event_onDMXPersonalityChanged ( m_Personality );
-                } 
-                break;
-
-            case rdm::IdentifyDevice:
-                if ( m_msg.CC == rdm::GetCommand )
-                {
-                    m_msg.PD[0] = (uint8_t)(m_rdmStatus.ident ? 1 : 0);
-                    m_msg.PDL   = 0x1;
-                }
-                else if (  m_msg.CC == rdm::SetCommand  )
-                {
-                    // Look into first byte to see whether identification
-                    // is turned on or off 
-                    m_rdmStatus.ident = m_msg.PD[0] ? true : false;
-                    if ( event_onIdentifyDevice )
-                        event_onIdentifyDevice ( m_rdmStatus.ident );
-
-                     m_msg.PDL   = 0x0;
-                }
-                break;
-
-            case rdm::ManufacturerLabel:
-                if ( m_msg.CC == rdm::GetCommand )
-                {
-                    memcpy_P( (void*)m_msg.PD, ManufacturerLabel_P, sizeof(ManufacturerLabel_P) );
-    				m_msg.PDL = sizeof ( ManufacturerLabel_P );
-                }
-                break;
-
-            case rdm::DeviceLabel:
-                if ( m_msg.CC == rdm::GetCommand )
-                {
-                    memcpy ( m_msg.PD, (void*) m_deviceLabel, 32 );
-                    m_msg.PDL   = 32;
-                }
-                else if (  m_msg.CC == rdm::SetCommand  )
-                {
-                    memset ( (void*) m_deviceLabel, ' ', 32 );
-                    memcpy ( (void*) m_deviceLabel, m_msg.PD, (m_msg.PDL < 32 ? m_msg.PDL : 32) );
-                    m_msg.PDL   = 0;
-                
-                    // Notify application
-                    if ( event_onDeviceLabelChanged )
-                        event_onDeviceLabelChanged ( m_deviceLabel, 32 );
-                }
-                break;
-
-
-            default:
-                // Unknown parameter ID response
-                m_msg.portId    = rdm::ResponseTypeNackReason;
-                m_msg.PD[0]     = rdm::UnknownPid;
-                m_msg.PD[1]     = 0x0;
-                m_msg.PDL       = 0x2;
-                break;
-        };
-    }
-
-    //
-    // Only respond if this this message
-    // was destined to us only
-    if ( m_msg.dstUid == m_devid )
-    {
-        m_msg.startCode     = RDM_START_CODE;
-        m_msg.subStartCode  = 0x01;
-        m_msg.msgLength     = RDM_HDR_LEN + m_msg.PDL;
-        m_msg.msgCount      = 0;
-
-        /*
-        switch ( m_msg.msg.CC )
-        {
-            case rdm::DiscoveryCommand:
-                m_msg.msg.CC = rdm::DiscoveryCommandResponse;
-                break;
-            case rdm::GetCommand:
-                m_msg.msg.CC = rdm::GetCommandResponse;
-                break;
-            case rdm::SetCommand:
-                m_msg.msg.CC = rdm::SetCommandResponse;
-                break;
-        }
-        */ 
-        /* Above replaced by next line */
-        m_msg.CC++;
-
-        m_msg.dstUid.copy ( m_msg.srcUid );
-        m_msg.srcUid.copy ( m_devid );
-
-        SetISRMode ( isr::RDMTransmit );
-       _delay_us ( MIN_RESPONDER_PACKET_SPACING_USEC );
-
-     }
-}
-
-
-void SetISRMode ( isr::isrMode mode )
-{
-    uint8_t readEnable;
-
-#if defined(USE_DMX_SERIAL_0)
-  #if defined(UCSRB) && defined (UCSRC)
-    UCSRC |= (1<<UMSEL)|(3<<UCSZ0)|(1<<USBS);
-  #elif defined(UCSR0B) && defined (UCSR0C)
-    UCSR0C |= (3<<UCSZ00)|(1<<USBS0);  
-  #endif                
-#elif defined(USE_DMX_SERIAL_1)
-    UCSR1C |= (3<<UCSZ10)|(1<<USBS1);
-#elif defined(USE_DMX_SERIAL_2)
-    UCSR2C |= (3<<UCSZ20)|(1<<USBS2);
-#elif defined(USE_DMX_SERIAL_3)
-    UCSR3C |= (3<<UCSZ30)|(1<<USBS3);
-#endif
-
-    switch ( mode )
-    {
-        case isr::Disabled:
-            #if defined(UCSRB)
-                UCSRB  = 0x0;
-            #elif defined(UCSR0B)
-        	    UCSR0B = 0x0;
-            #endif    
-            readEnable = LOW;
-            break;
-
-        case isr::Receive:
-            DMX_UBRRH = (unsigned char)(((F_CPU + DMX_BAUD_RATE * 8L) / (DMX_BAUD_RATE * 16L) - 1)>>8);
-    	    DMX_UBRRL = (unsigned char) ((F_CPU + DMX_BAUD_RATE * 8L) / (DMX_BAUD_RATE * 16L) - 1);	
-
-            // Prepare before kicking off ISR
-	        //DMX_UDR             = 0x0;
-	        __isr_rxState   = isr::Idle;        
-            readEnable      = LOW; 
-            DMX_UCSRB       = (1<<DMX_RXCIE) | (1<<DMX_RXEN);	
-            break;
-
-        case isr::DMXTransmit:
-            DMX_UDR         = 0x0;                              
-            readEnable      = HIGH;
-            __isr_txState   = isr::DmxBreak; 
-            DMX_UCSRB       = (1<<DMX_TXEN) | (1<<DMX_TXCIE);
-            break;
-
-        case isr::DMXTransmitManual:
-            DMX_UBRRH       = (unsigned char)(((F_CPU + DMX_BAUD_RATE * 8L) / (DMX_BAUD_RATE * 16L) - 1)>>8);
-    	    DMX_UBRRL       = (unsigned char) ((F_CPU + DMX_BAUD_RATE * 8L) / (DMX_BAUD_RATE * 16L) - 1);	
-            DMX_UDR         = 0x0;
-            DMX_UCSRB       = 0x0;
-            readEnable      = HIGH;
-             __isr_txState  = isr::DmxBreakManual;
-            break;
-
-        case isr::RDMTransmit:
-            // If read enable pin is assigned
-            DMX_UBRRH       = (unsigned char)(((F_CPU + DMX_BREAK_RATE * 8L) / (DMX_BREAK_RATE * 16L) - 1)>>8);
-            DMX_UBRRL       = (unsigned char) ((F_CPU + DMX_BREAK_RATE * 8L) / (DMX_BREAK_RATE * 16L) - 1);
-            readEnable      = HIGH;
-            __isr_txState   = isr::RdmStartByte; 
-            DMX_UCSRB       = (1<<DMX_TXEN) | (1<<DMX_TXCIE);
-            DMX_UDR         = 0x0;
-            break;
-    }
-
-    // If read enable pin is assigned
-    if (__re_pin > -1)
-        digitalWrite ( __re_pin, readEnable );
-
-}
-
-//
-// TX UART (DMX Transmission ISR)
-//
-ISR (USART_TX)
-{
-	static uint16_t			current_slot;
-
-	switch ( __isr_txState )
-	{
-	case isr::DmxBreak:
-		DMX_UBRRH = (unsigned char)(((F_CPU + DMX_BREAK_RATE * 8L) / (DMX_BREAK_RATE * 16L) - 1)>>8);
-        DMX_UBRRL = (unsigned char) ((F_CPU + DMX_BREAK_RATE * 8L) / (DMX_BREAK_RATE * 16L) - 1);
-        DMX_UDR   = 0x0;
-        
-        if ( __isr_txState ==  isr::DmxBreak )
-            __isr_txState = isr::DmxStartByte;
-        
-        break;
-
-	case isr::DmxStartByte:
-		DMX_UBRRH = (unsigned char)(((F_CPU + DMX_BAUD_RATE * 8L) / (DMX_BAUD_RATE * 16L) - 1)>>8);
-		DMX_UBRRL = (unsigned char) ((F_CPU + DMX_BAUD_RATE * 8L) / (DMX_BAUD_RATE * 16L) - 1);						
-        current_slot = 0;	
-        DMX_UDR = __dmx_master->getBuffer()[ current_slot++ ];
-		__isr_txState = isr::DmxTransmitData;
-		break;
-	
-
-	case isr::DmxTransmitData:
-        // NOTE: we always send full frames of 513 bytes, this will bring us 
-        // close to 40 frames / sec with no interslot delays
-        #ifdef DMX_IBG
-            _delay_us (DMX_IBG);
-        #endif
-
-		DMX_UDR = __dmx_master->getBuffer().getSlotValue( current_slot++ );
-			
-		// Send 512 channels
-		if ( current_slot >= DMX_MAX_FRAMESIZE )
-        {
-		    if ( __dmx_master->autoBreakEnabled () )
-                __isr_txState = isr::DmxBreak;
-            else
-                SetISRMode ( isr::DMXTransmitManual );
-	    }
-        
-		break;
-
-    case isr::RdmStartByte:
-        DMX_UBRRH = (unsigned char)(((F_CPU + DMX_BAUD_RATE * 8L) / (DMX_BAUD_RATE * 16L) - 1)>>8);
-		DMX_UBRRL = (unsigned char) ((F_CPU + DMX_BAUD_RATE * 8L) / (DMX_BAUD_RATE * 16L) - 1);			
-
-        // Write start byte
-        __rdm_responder->fetchOutgoing ( &DMX_UDR, true );
-        __isr_txState = isr::RdmTransmitData;
-
-        break;
-
-    case isr::RdmTransmitData:
-        // Write rest of data
-        if ( __rdm_responder->fetchOutgoing ( &DMX_UDR ) )
-        {
-            SetISRMode ( isr::Receive );    // Start waitin for new data
-            __isr_txState = isr::Idle;      // No tx state
-        }
-        break;
-    }
-}
-
-
-
-//
-// RX UART (DMX Reception ISR)
-//
-ISR (USART_RX)
-{
-    uint8_t usart_state    = DMX_UCSRA;
-    uint8_t usart_data     = DMX_UDR;
-
-    //
-    // Check for framing error and reset if found
-    // A framing most likely* indicate a break in our ocasion
-    //
-    if ( usart_state & (1<<DMX_FE) )
-	{
-	    DMX_UCSRA &= ~(1<<DMX_FE);
-        __isr_rxState = isr::Break;
-        return;
-    }
-    
-    switch ( __isr_rxState )
-    {
-        case isr::Break:
-            if ( __dmx_slave && usart_data == DMX_START_CODE )
-            {
-                __dmx_slave->processIncoming ( usart_data, true );
-                __isr_rxState = isr::DmxRecordData;
-            }
-            else if ( __rdm_responder && 
-                      usart_data == RDM_START_CODE && 
-                      __rdm_responder->m_rdmStatus.enabled )
-            {
-                // __rdm_responder->clear ();
-                __rdm_responder->processIncoming ( usart_data, true );
-                __isr_rxState = isr::RdmRecordData;
-            }
-            else
-            {
-                __isr_rxState = isr::Idle;
-            }
-            break;
-
-        // Process DMX Data
-        case isr::DmxRecordData:
-            if ( __dmx_slave->processIncoming ( usart_data ) )
-               __isr_rxState = isr::Idle;
-            break;
-
-        // Process RDM Data
-        case isr::RdmRecordData:
-            if ( __rdm_responder->processIncoming ( usart_data ) )
-                __isr_rxState = isr::Idle;
-            break;
-
-    }
-}
-
+/*
+  Conceptinetics.cpp - DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  This code has been tested using the following hardware:
+
+  - Arduino UNO R3 using a CTC-DRA-13-1 ISOLATED DMX-RDM SHIELD 
+  - Arduino MEGA2560 R3 using a CTC-DRA-13-1 ISOLATED DMX-RDM SHIELD 
+*/
+
+
+#include "Conceptinetics.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+
+#define LOWBYTE(v)   ((uint8_t) (v))
+#define HIGHBYTE(v)  ((uint8_t) (((uint16_t) (v)) >> 8))
+
+//
+// Port state, constant initialized so objects constructed anywhere
+// can bind to it
+//
+#if defined(USE_DMX_SERIAL_0)
+static DMX_Port __dmx_port0 ( 0 );
+#endif
+#if defined(USE_DMX_SERIAL_1)
+static DMX_Port __dmx_port1 ( 1 );
+#endif
+#if defined(USE_DMX_SERIAL_2)
+static DMX_Port __dmx_port2 ( 2 );
+#endif
+#if defined(USE_DMX_SERIAL_3)
+static DMX_Port __dmx_port3 ( 3 );
+#endif
+
+#if defined(DMX_SIMULATED_USART)
+// Ports past the USARTs only exist on the simulated wire, they are
+// created when first asked for
+static DMX_Port *simulatedPort ( uint8_t nr )
+{
+    static DMX_Port *ports[DMX_SIM_MAX_PORTS];
+
+    if ( !ports[nr] )
+        ports[nr] = new DMX_Port ( nr );
+
+    return ports[nr];
+}
+#endif
+
+DMX_Port *DMX_GetPort ( uint8_t nr )
+{
+    switch ( nr )
+    {
+#if defined(USE_DMX_SERIAL_0)
+        case 0: return &__dmx_port0;
+#endif
+#if defined(USE_DMX_SERIAL_1)
+        case 1: return &__dmx_port1;
+#endif
+#if defined(USE_DMX_SERIAL_2)
+        case 2: return &__dmx_port2;
+#endif
+#if defined(USE_DMX_SERIAL_3)
+        case 3: return &__dmx_port3;
+#endif
+    }
+
+#if defined(DMX_SIMULATED_USART)
+    if ( nr > 3 )
+        return simulatedPort ( nr );
+#endif
+
+    return NULL;
+}
+
+
+DMX_FrameBuffer::DMX_FrameBuffer ( uint16_t buffer_size )
+{
+    m_refcount = (uint8_t*) malloc ( sizeof ( uint8_t ) );
+
+    if ( buffer_size >= DMX_MIN_FRAMESIZE && buffer_size <= DMX_MAX_FRAMESIZE )
+    {
+        m_buffer = (uint8_t*) malloc ( buffer_size );
+        if ( m_buffer != NULL )
+        {
+            memset ( (void *)m_buffer, 0x0, buffer_size );
+            m_bufferSize = buffer_size;
+        }
+        else 
+        {
+            m_buffer = 0x0;
+            m_bufferSize = 0x0;
+        }
+    }
+    else
+    {
+        m_buffer = 0x0;
+        m_bufferSize = 0x0;
+    }
+
+    *m_refcount = 1;
+
+    clearDirty ();
+}
+
+DMX_FrameBuffer::DMX_FrameBuffer ( DMX_FrameBuffer &buffer )
+{
+    // Copy references and make sure the parent object does not dispose our
+    // buffer when deleted and we are still active
+    this->m_refcount = buffer.m_refcount;
+    (*this->m_refcount)++;
+    
+    this->m_buffer = buffer.m_buffer;
+    this->m_bufferSize = buffer.m_bufferSize;
+
+    clearDirty ();
+}
+
+DMX_FrameBuffer::~DMX_FrameBuffer ( void )
+{
+    // If we are the last object using the
+    // allocated buffer then free it together
+    // with the refcounter
+    if ( --(*m_refcount) == 0 )
+    {
+        if ( m_buffer )
+            free ( m_buffer );
+
+        free ( m_refcount );
+    }
+}
+
+uint16_t DMX_FrameBuffer::getBufferSize ( void )
+{
+    return m_bufferSize;
+}        
+
+
+uint8_t DMX_FrameBuffer::getSlotValue ( uint16_t index )
+{
+    if (index < m_bufferSize)
+        return m_buffer[index];
+    else
+        return 0x0;
+}
+
+
+void DMX_FrameBuffer::setSlotValue ( uint16_t index, uint8_t value )
+{
+    if ( index < m_bufferSize )
+    {
+        m_buffer[index] = value;
+        markDirty ( index, index );
+    }
+}
+
+
+void DMX_FrameBuffer::setSlotRange ( uint16_t start, uint16_t end, uint8_t value )
+{
+    if ( start < m_bufferSize && end < m_bufferSize && start < end )
+    {
+        memset ( (void *) &m_buffer[start], value, end-start );
+        markDirty ( start, end-1 );
+    }
+}
+
+void DMX_FrameBuffer::setSlots ( uint16_t start, const uint8_t *src, uint16_t len )
+{
+    if ( start >= m_bufferSize || len == 0 )
+        return;
+
+    if ( len > m_bufferSize - start )
+        len = m_bufferSize - start;
+
+    memcpy ( (void *) &m_buffer[start], (const void *) src, len );
+    markDirty ( start, start + len - 1 );
+}
+
+void DMX_FrameBuffer::clear ( void )
+{
+    memset ( (void *) m_buffer, 0x0, m_bufferSize );
+
+    if ( m_bufferSize )
+        markDirty ( 0, m_bufferSize - 1 );
+}        
+
+void DMX_FrameBuffer::clearDirty ( void )
+{
+    m_dirtyMin      = 0xffff;
+    m_dirtyMax      = 0x0;
+    m_dirtyBlocks   = 0x0;
+}
+
+void DMX_FrameBuffer::markDirty ( uint16_t first, uint16_t last )
+{
+    if ( first < m_dirtyMin )
+        m_dirtyMin = first;
+
+    if ( last > m_dirtyMax )
+        m_dirtyMax = last;
+
+    // All blocks from first up to and including last
+    m_dirtyBlocks |= ( (uint16_t)(2U << (last >> 6)) - 1 ) & ~( (uint16_t)(1U << (first >> 6)) - 1 );
+}
+
+uint8_t &DMX_FrameBuffer::operator[] ( uint16_t index )
+{
+    return m_buffer[index];
+}
+
+void DMX_FrameBuffer::swap ( DMX_FrameBuffer &buffer )
+{
+    uint8_t     *refcount   = m_refcount;
+    uint16_t    size        = m_bufferSize;
+    uint8_t     *data       = m_buffer;
+
+    m_refcount          = buffer.m_refcount;
+    m_bufferSize        = buffer.m_bufferSize;
+    m_buffer            = buffer.m_buffer;
+
+    buffer.m_refcount   = refcount;
+    buffer.m_bufferSize = size;
+    buffer.m_buffer     = data;
+}
+
+
+DMX_Master::DMX_Master ( DMX_FrameBuffer &buffer, int readEnablePin, uint8_t port )
+: m_port ( DMX_GetPort ( port ) ),
+  m_frameBuffer ( buffer ), 
+  m_autoBreak ( 1 ),                                    // Autobreak generation is default on
+  m_timedBreak ( 0 ),
+  m_breakLength ( DMX_DEFAULT_BREAK_USEC ),
+  m_mabLength ( DMX_DEFAULT_MAB_USEC ),
+  m_frontBuffer ( NULL ),
+  m_commitPending ( 0 ),
+  m_backStale ( 0 ),
+  m_padding ( dmx::dmxPadMinimumFrame ),
+  m_txMode ( dmx::dmxTransmitComplete ),
+  m_lastFrameStart ( 0 ),
+  m_framePeriod ( 0 )
+{
+    setStartCode ( DMX_START_CODE );    
+
+    if ( m_port )
+    {
+        m_port->usart.setReadEnablePin ( readEnablePin );
+        m_port->setMode ( isr::Disabled );
+    }
+}
+
+DMX_Master::DMX_Master ( uint16_t maxChannel, int readEnablePin, uint8_t port )
+: m_port ( DMX_GetPort ( port ) ),
+  m_frameBuffer ( maxChannel + DMX_STARTCODE_SIZE ), 
+  m_autoBreak ( 1 ),                                    // Autobreak generation is default on
+  m_timedBreak ( 0 ),
+  m_breakLength ( DMX_DEFAULT_BREAK_USEC ),
+  m_mabLength ( DMX_DEFAULT_MAB_USEC ),
+  m_frontBuffer ( NULL ),
+  m_commitPending ( 0 ),
+  m_backStale ( 0 ),
+  m_padding ( dmx::dmxPadMinimumFrame ),
+  m_txMode ( dmx::dmxTransmitComplete ),
+  m_lastFrameStart ( 0 ),
+  m_framePeriod ( 0 )
+{
+    setStartCode ( DMX_START_CODE );
+
+    if ( m_port )
+    {
+        m_port->usart.setReadEnablePin ( readEnablePin );
+        m_port->setMode ( isr::Disabled );
+    }
+}
+
+DMX_Master::~DMX_Master ( void )
+{
+    disable ();                                         // Stop sending
+
+    if ( m_frontBuffer )
+        delete m_frontBuffer;
+}
+
+DMX_FrameBuffer &DMX_Master::getBuffer ( void )
+{
+    syncBackBuffer ();
+    return m_frameBuffer;                               // Return reference to frame buffer
+}
+
+DMX_FrameBuffer &DMX_Master::getTransmitBuffer ( void )
+{
+    return m_frontBuffer ? *m_frontBuffer : m_frameBuffer;
+}
+
+void DMX_Master::setStartCode ( uint8_t value )
+{
+    m_frameBuffer[0] = value;                           // Set the first byte in our frame buffer
+}
+
+void DMX_Master::setChannelValue ( uint16_t channel, uint8_t value )
+{
+    syncBackBuffer ();
+
+    if ( channel > 0 )                                  // Prevent overwriting the start code
+        m_frameBuffer.setSlotValue ( channel, value );
+}
+
+void DMX_Master::setChannelRange ( uint16_t start, uint16_t end, uint8_t value )
+{
+    syncBackBuffer ();
+
+    if ( start > 0 )                                    // Prevent overwriting the start code
+        m_frameBuffer.setSlotRange ( start, end, value );
+}
+
+void DMX_Master::setChannels ( uint16_t start, const uint8_t *values, uint16_t len )
+{
+    syncBackBuffer ();
+
+    if ( start > 0 )                                    // Prevent overwriting the start code
+        m_frameBuffer.setSlots ( start, values, len );
+}
+
+bool DMX_Master::setDoubleBuffered ( bool enable )
+{
+    // Buffers can not be exchanged while the ISR is using them
+    if ( m_port && m_port->master == this )
+        return false;
+
+    if ( enable && !m_frontBuffer )
+    {
+        m_frontBuffer = new DMX_FrameBuffer ( m_frameBuffer.getBufferSize () );
+
+        if ( !m_frontBuffer || 
+             m_frontBuffer->getBufferSize () != m_frameBuffer.getBufferSize () )
+        {
+            delete m_frontBuffer;
+            m_frontBuffer = NULL;
+            return false;
+        }
+
+        memcpy ( (void *)&(*m_frontBuffer)[0], (void *)&m_frameBuffer[0], 
+                 m_frameBuffer.getBufferSize () );
+    }
+    else if ( !enable && m_frontBuffer )
+    {
+        // Keep whatever was committed last
+        syncBackBuffer ();
+
+        delete m_frontBuffer;
+        m_frontBuffer = NULL;
+    }
+
+    m_commitPending = 0;
+    m_backStale     = 0;
+
+    return true;
+}
+
+void DMX_Master::commit ( void )
+{
+    if ( !m_frontBuffer )
+        return;
+
+    if ( m_port && m_port->master == this )
+    {
+        // Swap takes place in the ISR at the next break
+        m_commitPending = 1;
+    }
+    else
+    {
+        // Not transmitting, swap right away
+        m_frameBuffer.swap ( *m_frontBuffer );
+        m_backStale = 1;
+    }
+}
+
+bool DMX_Master::commitPending ( void )
+{
+    return m_commitPending;
+}
+
+void DMX_Master::syncBackBuffer ( void )
+{
+    if ( !m_frontBuffer )
+        return;
+
+    // Updates after a commit belong to the next frame, wait for
+    // the ISR to swap buffers (at most one frame)
+    while ( m_commitPending && m_port->master == this )
+        m_port->usart.delay_us ( DMX_SLOT_USEC );
+
+    // After a swap the back buffer holds the frame before the one
+    // now being transmitted, copy outside of the ISR
+    if ( m_backStale )
+    {
+        memcpy ( (void *)&m_frameBuffer[0], (void *)&(*m_frontBuffer)[0], 
+                 m_frameBuffer.getBufferSize () );
+        m_backStale = 0;
+    }
+}
+
+
+void DMX_Master::enable  ( void )
+{
+    if ( !m_port )
+        return;
+
+    m_port->master = this;  
+
+    if ( m_autoBreak )
+        m_port->setMode ( isr::DMXTransmit );
+    else
+        m_port->setMode ( isr::DMXTransmitManual );
+}
+
+void DMX_Master::disable ( void )
+{
+    if ( m_port && m_port->master == this )
+    {
+        m_port->setMode ( isr::Disabled );
+        m_port->master = NULL;                          // No active master
+    }
+
+    m_lastFrameStart    = 0;
+    m_framePeriod       = 0;
+}
+
+void DMX_Master::setFramePadding ( dmx::dmxFramePadding padding )
+{
+    m_padding = padding;
+}
+
+void DMX_Master::setTransmitMode ( dmx::dmxTransmitMode mode )
+{
+    m_txMode = mode;
+}
+
+uint16_t DMX_Master::getFrameRate ( void )
+{
+    uint32_t period;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        period = m_framePeriod;
+    }
+
+    return period ? (uint16_t)(1000000UL / period) : 0;
+}
+
+uint16_t DMX_Master::getFrameSize ( void )
+{
+    uint16_t size = m_frameBuffer.getBufferSize ();
+
+    // Slots past the end of the buffer are transmitted as zero
+    if ( m_padding == dmx::dmxPadMinimumFrame && size < DMX_MIN_PADDED_FRAMESIZE )
+        size = DMX_MIN_PADDED_FRAMESIZE;
+
+    return size;
+}
+
+void DMX_Master::frameStarted ( uint32_t now_us )
+{
+    // Exchange pointers only, the back buffer is brought up
+    // to date from the application context
+    if ( m_commitPending )
+    {
+        m_frameBuffer.swap ( *m_frontBuffer );
+        m_backStale     = 1;
+        m_commitPending = 0;
+    }
+
+    if ( m_lastFrameStart )
+        m_framePeriod = now_us - m_lastFrameStart;
+
+    m_lastFrameStart = now_us;
+}
+
+void    DMX_Master::setAutoBreakMode ( void ) { m_autoBreak = 1; m_timedBreak = 0; }
+void    DMX_Master::setManualBreakMode ( void ) { m_autoBreak = 0; m_timedBreak = 0; }
+uint8_t DMX_Master::autoBreakEnabled ( void ) { return m_autoBreak; }
+uint8_t DMX_Master::timedBreakEnabled ( void ) { return m_timedBreak; }
+
+bool DMX_Master::setTimedBreakMode ( uint16_t breakLength_us, uint16_t mabLength_us )
+{
+#if defined(USE_DMX_BREAK_TIMER)
+    if ( breakLength_us < DMX_MIN_BREAK_USEC || mabLength_us < DMX_MIN_MAB_USEC )
+        return false;
+
+    if ( !m_port || !m_port->usart.hasTimer () )
+        return false;
+
+    m_breakLength   = breakLength_us;
+    m_mabLength     = mabLength_us;
+    m_autoBreak     = 1;
+    m_timedBreak    = 1;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+uint8_t DMX_Master::waitingBreak ( void )
+{
+    return ( m_port && m_port->master == this && 
+             m_port->txState == isr::DmxBreakManual );
+}
+        
+void DMX_Master::breakAndContinue ( uint8_t breakLength_us )
+{
+    // Only execute if we are the controlling master object
+    if ( waitingBreak () )
+    {
+        DMX_Transport &usart = m_port->usart;
+
+        // Let the last slot(s) of the previous frame leave the line,
+        // there are none after enable() or an RDM request
+        if ( m_port->txFlush )
+            usart.flush ();
+
+        m_port->txFlush = false;
+
+        m_port->prepareFrame ();
+
+#if defined(USE_DMX_BREAK_TIMER)
+        // Break and MAB are timed in the background, the
+        // timer interrupt continues with the frame
+        if ( usart.hasTimer () )
+        {
+            ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+            {
+                m_port->txState = isr::DmxTimerBreak;
+                usart.beginBreak ();
+                usart.startTimer ( breakLength_us );
+            }
+            return;
+        }
+#endif
+        usart.beginBreak ();                        // Begin BREAK                               
+
+        usart.delay_us ( breakLength_us );
+
+        // Turn TX Pin into Logic HIGH
+        usart.endBreak ();                          // END BREAK
+
+        m_port->txState = isr::DmxStartByte;
+   
+        // TX Enable
+        usart.setMode ( usart::TransmitPolled );
+
+        usart.delay_us ( 12 );                      // MAB 12µSec
+        
+        // TX Interupt enable and kick off the start byte
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+        {
+            usart.setMode ( usart::Transmit );
+            m_port->transmitComplete ();
+        }
+    }
+}
+
+
+DMX_Slave::DMX_Slave ( DMX_FrameBuffer &buffer, int readEnablePin, uint8_t port )
+: DMX_FrameBuffer ( buffer ), 
+  m_port ( DMX_GetPort ( port ) ),
+  m_startAddress ( 1 ),
+  m_state ( dmx::dmxUnknown ),
+  m_enabled ( false ),
+  m_nextSlave ( NULL ),
+  m_rxBase ( NULL ),
+  m_rxPtr ( NULL ),
+  m_rxEnd ( NULL ),
+  m_shadow ( NULL ),
+  m_frameSequence ( 0 ),
+  m_lossPolicy ( dmx::dmxHoldLastLook ),
+  m_lossTimeout ( 1000000UL ),
+  m_lossFade ( 0 ),
+  m_lossScene ( NULL ),
+  m_lossSceneLen ( 0 ),
+  m_enableTime ( 0 ),
+  m_lastFrameTime ( 0 ),
+  m_framePeriod ( 0 ),
+  event_onFrameReceived ( NULL ),
+  event_onFrameServiced ( NULL )
+{
+    if ( m_port )
+    {
+        // The first slave on the port owns its configuration
+        if ( !m_port->slave )
+        {
+            m_port->usart.setReadEnablePin ( readEnablePin );
+            m_port->setMode ( isr::Disabled );
+        }
+        else if ( readEnablePin > -1 )
+            m_port->usart.setReadEnablePin ( readEnablePin );
+    }
+
+    attach ();
+}
+
+DMX_Slave::DMX_Slave ( uint16_t nrChannels, int readEnablePin, uint8_t port )
+: DMX_FrameBuffer ( nrChannels + 1 ), 
+  m_port ( DMX_GetPort ( port ) ),
+  m_startAddress ( 1 ),
+  m_state ( dmx::dmxUnknown ),
+  m_enabled ( false ),
+  m_nextSlave ( NULL ),
+  m_rxBase ( NULL ),
+  m_rxPtr ( NULL ),
+  m_rxEnd ( NULL ),
+  m_shadow ( NULL ),
+  m_frameSequence ( 0 ),
+  m_lossPolicy ( dmx::dmxHoldLastLook ),
+  m_lossTimeout ( 1000000UL ),
+  m_lossFade ( 0 ),
+  m_lossScene ( NULL ),
+  m_lossSceneLen ( 0 ),
+  m_enableTime ( 0 ),
+  m_lastFrameTime ( 0 ),
+  m_framePeriod ( 0 ),
+  event_onFrameReceived ( NULL ),
+  event_onFrameServiced ( NULL )
+{
+    if ( m_port )
+    {
+        // The first slave on the port owns its configuration
+        if ( !m_port->slave )
+        {
+            m_port->usart.setReadEnablePin ( readEnablePin );
+            m_port->setMode ( isr::Disabled );
+        }
+        else if ( readEnablePin > -1 )
+            m_port->usart.setReadEnablePin ( readEnablePin );
+    }
+
+    attach ();
+}
+
+DMX_Slave::~DMX_Slave ( void )
+{
+    disable ();
+    detach ();
+
+    if ( m_shadow )
+        delete m_shadow;
+}
+
+void DMX_Slave::attach ( void )
+{
+    if ( !m_port )
+        return;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        DMX_Slave **link = &m_port->slave;
+
+        while ( *link && (*link)->m_startAddress <= m_startAddress )
+            link = &(*link)->m_nextSlave;
+
+        m_nextSlave = *link;
+        *link       = this;
+
+        // The frame being received continues with the old list
+        m_port->rxState = isr::Idle;
+    }
+}
+
+void DMX_Slave::detach ( void )
+{
+    if ( !m_port )
+        return;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        DMX_Slave **link = &m_port->slave;
+
+        while ( *link && *link != this )
+            link = &(*link)->m_nextSlave;
+
+        if ( *link )
+            *link = m_nextSlave;
+
+        m_nextSlave     = NULL;
+        m_port->rxState = isr::Idle;
+    }
+}
+
+
+void DMX_Slave::enable ( void )
+{
+    if ( m_port )
+    {
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+        {
+            m_enableTime    = m_port->usart.micros ();
+            m_frameSequence = 0;
+            m_framePeriod   = 0;
+            m_enabled       = true;
+        }
+
+        m_port->setMode ( isr::Receive );
+    }
+}
+
+void DMX_Slave::disable ( void )
+{
+    if ( !m_port )
+        return;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        m_enabled = false;
+        if ( m_state == dmx::dmxWaitStartAddress || m_state == dmx::dmxData )
+            m_state = dmx::dmxUnknown;
+    }
+
+    // Leave the receiver running for the other slaves on the port
+    // and the monitor
+    if ( m_port->monitor )
+        return;
+
+    for ( DMX_Slave *s = m_port->slave; s; s = s->m_nextSlave )
+        if ( s->m_enabled )
+            return;
+
+    m_port->setMode ( isr::Disabled );
+}
+
+DMX_FrameBuffer &DMX_Slave::getBuffer ( void )
+{
+    return reinterpret_cast<DMX_FrameBuffer&>(*this);
+}
+
+uint8_t DMX_Slave::getChannelValue ( uint16_t channel )
+{
+    uint8_t value;
+
+    // The buffers are exchanged from the ISR
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        value = getSlotValue ( channel );
+    }
+
+    if ( m_lossPolicy == dmx::dmxHoldLastLook )
+        return value;
+
+    return applyLoss ( channel, value, lossLevel () );
+}
+
+void DMX_Slave::getChannels ( uint16_t start, uint8_t *dst, uint16_t len )
+{
+    uint16_t size = getBufferSize ();
+    uint16_t sequence;
+
+    if ( start >= size )
+        return;
+
+    if ( len > size - start )
+        len = size - start;
+
+    // Copy with interrupts enabled and start over when a frame
+    // got published in the mean time
+    do
+    {
+        uint8_t *src;
+
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+        {
+            sequence    = m_frameSequence;
+            src         = getData ();
+        }
+
+        memcpy ( dst, src + start, len );
+    }
+    while ( m_shadow && sequence != getFrameSequence () );
+
+    if ( m_lossPolicy != dmx::dmxHoldLastLook )
+    {
+        uint16_t level = lossLevel ();
+
+        if ( level != LossLevelFull )
+            for ( uint16_t i = 0; i < len; i++ )
+                dst[i] = applyLoss ( start + i, dst[i], level );
+    }
+}
+
+uint16_t DMX_Slave::getFrameSequence ( void )
+{
+    uint16_t sequence;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        sequence = m_frameSequence;
+    }
+
+    return sequence;
+}
+
+void DMX_Slave::setSignalLoss ( dmx::dmxSignalLoss policy, 
+                               uint16_t timeout_ms, uint16_t fade_ms )
+{
+    m_lossPolicy    = policy;
+    m_lossTimeout   = (uint32_t)timeout_ms * 1000UL;
+    m_lossFade      = fade_ms;
+}
+
+void DMX_Slave::setLossScene ( const uint8_t *values, uint16_t len )
+{
+    m_lossScene     = values;
+    m_lossSceneLen  = len;
+}
+
+dmx::dmxSignalState DMX_Slave::getSignalState ( void )
+{
+    uint32_t    last;
+    uint16_t    sequence;
+
+    if ( !m_port )
+        return dmx::dmxSignalNone;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        last        = m_lastFrameTime;
+        sequence    = m_frameSequence;
+    }
+
+    if ( sequence == 0 )
+        return dmx::dmxSignalNone;
+
+    if ( m_port->usart.micros () - last > m_lossTimeout )
+        return dmx::dmxSignalLost;
+
+    return dmx::dmxSignalPresent;
+}
+
+uint16_t DMX_Slave::getFrameRate ( void )
+{
+    uint32_t period;
+
+    if ( getSignalState () != dmx::dmxSignalPresent )
+        return 0;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        period = m_framePeriod;
+    }
+
+    return period ? (uint16_t)(1000000UL / period) : 0;
+}
+
+uint16_t DMX_Slave::lossLevel ( void )
+{
+    uint32_t    last;
+    uint32_t    lost_us;
+
+    if ( !m_port )
+        return LossLevelFull;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        last = m_frameSequence ? m_lastFrameTime : m_enableTime;
+    }
+
+    lost_us = m_port->usart.micros () - last;
+
+    if ( lost_us <= m_lossTimeout )
+        return LossLevelFull;
+
+    if ( m_lossPolicy == dmx::dmxPresetScene )
+        return LossLevelScene;
+
+    // Fade to zero, time since the signal got lost in ms
+    uint32_t fading = ( lost_us - m_lossTimeout ) / 1000UL;
+
+    if ( fading >= m_lossFade )
+        return 0;
+
+    return (uint16_t)( ( (uint32_t)( m_lossFade - fading ) << 8 ) / m_lossFade );
+}
+
+uint8_t DMX_Slave::applyLoss ( uint16_t channel, uint8_t value, uint16_t level )
+{
+    if ( level == LossLevelScene )
+    {
+        if ( channel >= 1 && channel <= m_lossSceneLen )
+            return m_lossScene[channel - 1];
+
+        return 0x0;
+    }
+
+    return (uint8_t)( ( (uint16_t)value * level ) >> 8 );
+}
+
+bool DMX_Slave::setDoubleBuffered ( bool enable )
+{
+    if ( enable && !m_shadow )
+    {
+        DMX_FrameBuffer *shadow = new DMX_FrameBuffer ( getBufferSize () );
+
+        if ( !shadow || shadow->getBufferSize () != getBufferSize () )
+        {
+            delete shadow;
+            return false;
+        }
+
+        memcpy ( shadow->getData (), getData (), getBufferSize () );
+
+        // Takes effect at the next start byte
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+        {
+            m_shadow = shadow;
+        }
+    }
+    else if ( !enable && m_shadow )
+    {
+        DMX_FrameBuffer *shadow = m_shadow;
+
+        // Drop the frame being received into the shadow
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+        {
+            if ( m_state == dmx::dmxWaitStartAddress || m_state == dmx::dmxData )
+                m_state = dmx::dmxUnknown;
+
+            m_shadow = NULL;
+        }
+
+        delete shadow;
+    }
+
+    return true;
+}
+
+
+uint16_t DMX_Slave::getStartAddress ( void )
+{
+    return m_startAddress;
+}
+
+void DMX_Slave::setStartAddress ( uint16_t addr )
+{
+    if ( addr == m_startAddress )
+        return;
+
+    // Keep the slave list of the port sorted, the frame being received 
+    // is dropped
+    detach ();
+    m_startAddress = addr;
+    attach ();
+}
+
+void DMX_Slave::onReceiveComplete ( void (*func)(unsigned short) )
+{
+    event_onFrameReceived = func;
+}
+
+void DMX_Slave::onFrameReceived ( void (*func)(unsigned short) )
+{
+    event_onFrameServiced = func;
+}
+
+void DMX_Slave::service ( void )
+{
+    if ( m_port )
+        m_port->service ();
+}
+
+void DMX_Slave::frameServiced ( uint16_t channels )
+{
+    if ( event_onFrameServiced )
+        event_onFrameServiced ( channels );
+}
+
+
+bool DMX_Slave::processIncoming ( uint8_t val, bool first )
+{
+    bool            rval = false;
+
+    if ( first )
+        m_state = m_enabled ? dmx::dmxStartByte : dmx::dmxUnknown;
+
+    switch ( m_state )
+    {
+        case dmx::dmxStartByte:
+            // Receive into the shadow buffer when double buffered
+            m_rxBase = m_shadow ? m_shadow->getData () : getData ();
+            if ( m_rxBase == NULL )
+            {
+                m_state = dmx::dmxUnknown;
+                return true;
+            }
+
+            m_rxEnd     = m_rxBase + getBufferSize ();
+            m_rxPtr     = m_rxBase;
+            *m_rxPtr++  = val;          // Store start code
+
+            // The port passes our first slot next
+            m_state = dmx::dmxWaitStartAddress;
+            break;
+
+        case dmx::dmxWaitStartAddress:
+            m_state = dmx::dmxData;
+
+            // Our first slot is stored like any other
+            // Fall through
+
+        case dmx::dmxData:
+            *m_rxPtr++ = val;
+
+            // Footprint filled
+            if ( m_rxPtr == m_rxEnd )
+            {
+                m_state = dmx::dmxFrameReady;
+                frameComplete ();
+                rval = true;
+            }
+            break;
+
+        default:
+            rval = true;
+            break;
+    }
+
+    return rval;
+}
+
+void DMX_Slave::processBreak ( void )
+{
+    // We could have received less channels then we
+    // expected.. but still is a complete frame
+    if ( m_state == dmx::dmxData )
+    {
+        m_state = dmx::dmxFrameReady;
+        frameComplete ();
+    }
+}
+
+void DMX_Slave::frameComplete ( void )
+{
+    uint16_t channels   = m_rxPtr - m_rxBase - DMX_STARTCODE_SIZE;
+    uint32_t now        = m_port->usart.micros ();
+
+    if ( m_frameSequence )
+        m_framePeriod = now - m_lastFrameTime;
+
+    m_lastFrameTime = now;
+
+    if ( m_shadow )
+    {
+        // Slots missing from a short frame are not carried over
+        // from older frames
+        if ( m_rxPtr != m_rxEnd )
+            memset ( m_rxPtr, 0x0, m_rxEnd - m_rxPtr );
+
+        swap ( *m_shadow );
+    }
+
+    m_frameSequence++;
+
+    // If a onFrameReceived callback is register...
+    if ( event_onFrameReceived )
+        event_onFrameReceived ( channels );
+
+    // Let service() invoke the deferred callback, when the queue is
+    // full the application is already behind and the frame is skipped
+    if ( event_onFrameServiced )
+    {
+        DMX_Event event = { dmx::dmxEventFrame, this, channels };
+        m_port->events.push ( event );
+    }
+}
+
+
+DMX_Monitor::DMX_Monitor ( uint8_t nrFrames, uint16_t maxSlots, 
+                           int readEnablePin, uint8_t port )
+: m_port ( DMX_GetPort ( port ) ),
+  m_frames ( NULL ),
+  m_data ( NULL ),
+  m_nrFrames ( 0 ),
+  m_maxSlots ( 0 ),
+  m_first ( 0 ),
+  m_count ( 0 ),
+  m_dropped ( 0 ),
+  m_frame ( NULL ),
+  m_breakSeen ( false ),
+  m_breakAt ( 0 ),
+  m_lastSlotAt ( 0 )
+{
+    if ( maxSlots < DMX_STARTCODE_SIZE || maxSlots > DMX_MAX_FRAMESIZE )
+        maxSlots = DMX_MAX_FRAMESIZE;
+
+    m_frames    = (DMX_MonitorFrame*) malloc ( nrFrames * sizeof ( DMX_MonitorFrame ) );
+    m_data      = (uint8_t*) malloc ( (uint32_t)nrFrames * maxSlots );
+
+    if ( m_frames && m_data )
+    {
+        memset ( (void *)m_frames, 0x0, nrFrames * sizeof ( DMX_MonitorFrame ) );
+
+        for ( uint8_t i = 0; i < nrFrames; i++ )
+            m_frames[i].data = m_data + (uint32_t)i * maxSlots;
+
+        m_nrFrames  = nrFrames;
+        m_maxSlots  = maxSlots;
+    }
+
+    if ( m_port && readEnablePin > -1 )
+        m_port->usart.setReadEnablePin ( readEnablePin );
+}
+
+DMX_Monitor::~DMX_Monitor ( void )
+{
+    disable ();
+
+    if ( m_frames )
+        free ( m_frames );
+
+    if ( m_data )
+        free ( m_data );
+}
+
+void DMX_Monitor::enable ( void )
+{
+    if ( !m_port )
+        return;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        m_frame         = NULL;
+        m_breakSeen     = false;
+        m_port->monitor = this;
+    }
+
+    m_port->setMode ( isr::Receive );
+}
+
+void DMX_Monitor::disable ( void )
+{
+    if ( !m_port || m_port->monitor != this )
+        return;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        m_port->monitor = NULL;
+    }
+
+    // Leave the receiver running for the slaves on the port
+    for ( DMX_Slave *s = m_port->slave; s; s = s->getNextSlave () )
+        if ( s->isEnabled () )
+            return;
+
+    m_port->setMode ( isr::Disabled );
+}
+
+uint8_t DMX_Monitor::available ( void )
+{
+    return m_count;
+}
+
+const DMX_MonitorFrame *DMX_Monitor::getFrame ( void )
+{
+    // Recorded frames are left alone by the ISR
+    return m_count ? &m_frames[m_first] : NULL;
+}
+
+void DMX_Monitor::release ( void )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        if ( m_count )
+        {
+            m_first = ( m_first + 1 ) % m_nrFrames;
+            m_count--;
+        }
+    }
+}
+
+uint16_t DMX_Monitor::getDroppedFrames ( void )
+{
+    uint16_t dropped;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        dropped = m_dropped;
+    }
+
+    return dropped;
+}
+
+void DMX_Monitor::processIncoming ( uint8_t val, bool framingError )
+{
+    uint32_t now = m_port->usart.micros ();
+
+    if ( framingError )
+    {
+        // The break ends the frame being recorded
+        if ( m_frame )
+        {
+            m_frame->dataTime       = m_lastSlotAt - m_frame->timestamp;
+            m_frame->framePeriod    = now - m_breakAt;
+            m_frame                 = NULL;
+            m_count++;
+        }
+
+        m_breakAt       = now;
+        m_breakSeen     = true;
+        return;
+    }
+
+    if ( m_breakSeen )
+    {
+        // Start code, claim a free frame
+        m_breakSeen = false;
+
+        if ( m_count >= m_nrFrames )
+        {
+            m_dropped++;
+            return;
+        }
+
+        m_frame = &m_frames[( m_first + m_count ) % m_nrFrames];
+        m_frame->timestamp      = now;
+        m_frame->breakToStart   = now - m_breakAt;
+        m_frame->slots          = 0;
+        m_frame->recorded       = 0;
+    }
+
+    if ( !m_frame )
+        return;
+
+    if ( m_frame->recorded < m_maxSlots )
+        m_frame->data[m_frame->recorded++] = val;
+
+    m_frame->slots++;
+    m_lastSlotAt = now;
+}
+
+
+uint16_t RDM_FrameBuffer::getBufferSize ( void ) { return sizeof ( RDM_Message ); }   
+
+uint8_t RDM_FrameBuffer::getSlotValue ( uint16_t index )
+{
+    if ( m_msg && index < sizeof ( RDM_Message ) )
+        return m_msg->d[index];
+    else
+        return 0x0;
+}
+
+
+void RDM_FrameBuffer::setSlotValue ( uint16_t index, uint8_t value )
+{
+    if ( m_msg && index < sizeof ( RDM_Message ) )
+        m_msg->d[index] = value;
+}
+
+void RDM_FrameBuffer::clear ( void )
+{
+    if ( m_msg )
+        memset ( (void*)m_msg->d, 0x0, sizeof ( RDM_Message ) ); 
+    m_state             = rdm::rdmUnknown;
+}
+
+bool RDM_FrameBuffer::processIncoming ( uint8_t val, bool first )
+{
+    bool            rval = false;
+
+    if ( first )
+    {
+        m_state = rdm::rdmStartByte;
+        m_csCalc   = (uint16_t) 0x0000;
+        m_idx = 0;
+    }
+
+    if ( !m_msg )
+        return true;
+
+    switch ( m_state )
+    {
+        case rdm::rdmStartByte: 
+            m_msg->startCode = val;
+            m_state = rdm::rdmSubStartCode;
+            break;
+
+        case rdm::rdmSubStartCode:
+            if ( val != 0x01 )
+            {
+                rval = true;                        // Stop processing data
+                break;
+            }
+
+            m_msg->subStartCode = val;
+            m_state = rdm::rdmMessageLength;
+            break;
+
+        case rdm::rdmMessageLength:
+            // Shorter than a header or longer than we can hold, with
+            // the full RDM_PD_MAXLEN every length fits
+            if ( val < RDM_HDR_LEN
+#if RDM_HDR_LEN + RDM_PD_MAXLEN < 0xff
+                 || val > sizeof ( RDM_Message )
+#endif
+               )
+            {
+                m_state = rdm::rdmUnknown;
+                rval = true;
+                break;
+            }
+
+            m_msg->msgLength = val;
+            m_state = rdm::rdmData;
+            m_csCalc = 0xcc + 0x01 + val;  // set initial checksum 
+            m_idx = 3;                                // buffer index for next byte
+            break;
+
+        case rdm::rdmData:
+            m_msg->d[m_idx++] = val;
+            m_csCalc += val;
+            if ( m_idx >= m_msg->msgLength )
+                m_state = rdm::rdmChecksumHigh;
+            break;
+
+        case rdm::rdmChecksumHigh:
+            m_csRecv = val << 8;
+            m_state = rdm::rdmChecksumLow;
+            
+            break;
+
+        case rdm::rdmChecksumLow:
+            m_csRecv |= val;
+
+            // The checksum is the 16 bit sum (it wraps by itself)
+            if ( m_csCalc == m_csRecv )
+            { 
+                m_state = rdm::rdmFrameReady;
+                
+                // valid checksum ... start processing
+                processFrame ();
+            }
+
+            m_state = rdm::rdmUnknown;
+            rval = true;
+            break;
+
+        default:
+            break;
+    };
+
+    return rval;
+}
+
+bool RDM_FrameBuffer::fetchOutgoing ( uint8_t *val, bool first )
+{
+    bool            rval = false;
+
+
+    if ( first )
+    {
+        m_state             = rdm::rdmData;
+        m_csCalc   = (uint16_t) 0x0000;
+        m_idx                 = 0;
+    }
+
+    switch ( m_state )
+    {
+        case rdm::rdmData:
+            m_csCalc += m_msg->d[m_idx];
+            *val = m_msg->d[m_idx++];
+            if ( m_idx >= m_msg->msgLength )
+            {
+                m_state = rdm::rdmChecksumHigh;
+            }
+            break;
+        
+        case rdm::rdmChecksumHigh:
+            *val = HIGHBYTE(m_csCalc);
+            m_state = rdm::rdmChecksumLow;
+            break;
+
+        case rdm::rdmChecksumLow:
+            *val = LOWBYTE(m_csCalc);
+            m_state = rdm::rdmUnknown;
+            rval = true;
+            break;
+
+        default:
+            break;
+    }
+
+    return rval;
+}
+
+
+//
+// The responder answers on the port of the slave and reports its footprint
+// and start address
+//
+RDM_Responder::RDM_Responder ( uint16_t m, uint8_t d1, uint8_t d2, 
+                               uint8_t d3, uint8_t d4, DMX_Slave &slave )
+:   RDM_FrameBuffer ( slave.getPort () ? slave.getPort ()->getRdmMessage () : NULL ),
+    m_port ( slave.getPort () ),
+    m_slave ( &slave ),
+    m_Personalities (1),    // Available personlities
+    m_Personality (1),      // Default personality eq 1.
+    event_onIdentifyDevice ( NULL ),
+    event_onDeviceLabelChanged ( NULL ),
+    event_onDMXStartAddressChanged ( NULL ),
+    event_onDMXPersonalityChanged ( NULL ),
+    event_onSubDeviceChanged ( NULL ),
+    m_deferred ( false ),
+    m_requestPending ( false ),
+    m_requestEnd ( 0 ),
+    m_overflowPid ( 0 ),
+    m_overflowOffset ( 0 ),
+    m_parameters ( NULL ),
+    m_nrParameters ( 0 ),
+    m_sensors ( NULL ),
+    m_nrSensors ( 0 ),
+    m_sensorInterval ( 100 ),
+    m_sensorSampledAt ( 0 ),
+    m_subDevices ( NULL ),
+    m_nrSubDevices ( 0 ),
+    m_config ( NULL ),
+    m_nrStatus ( 0 ),
+    m_statusReported ( 0 )
+{
+    if ( m_port )
+        m_port->responder = this;
+
+    m_devid.Initialize ( m, d1, d2, d3, d4 );
+
+    // Default software version id = 0x00000000
+    memset ( (void*)m_SoftwareVersionId, 0x0, 0x4 );
+
+    // Rdm responder is disabled by default
+    m_rdmStatus.enabled = false;
+
+    m_lastQueued.pid = 0;
+
+    memset ( (void*)m_deviceLabel, ' ', RDM_MAX_DEVICELABEL_LENGTH );
+}
+
+RDM_Responder::~RDM_Responder ( void )
+{
+    if ( m_port && m_port->responder == this )
+        m_port->responder = NULL;
+
+    free ( m_sensors );
+    free ( m_subDevices );
+}
+
+void RDM_Responder::onIdentifyDevice ( void (*func)(bool) )
+{
+    event_onIdentifyDevice = func;
+}
+
+void RDM_Responder::onDeviceLabelChanged ( void (*func) (const char*, uint8_t) )
+{
+    event_onDeviceLabelChanged = func;
+}
+
+void RDM_Responder::onDMXStartAddressChanged ( void (*func) (uint16_t) )
+{
+    event_onDMXStartAddressChanged = func;
+}
+
+void RDM_Responder::onDMXPersonalityChanged ( void (*func) (uint8_t) )
+{
+    event_onDMXPersonalityChanged = func;
+}
+
+void RDM_Responder::onSubDeviceChanged ( void (*func) (uint16_t, uint16_t) )
+{
+    event_onSubDeviceChanged = func;
+}
+
+void RDM_Responder::setDeviceLabel ( const char *label, size_t len )
+{
+    if ( len > RDM_MAX_DEVICELABEL_LENGTH )
+        len = RDM_MAX_DEVICELABEL_LENGTH;
+
+    memcpy ( (void *)m_deviceLabel, (void *)label, len );
+}
+
+void RDM_Responder::repondDiscUniqueBranch ( void )
+{
+    uint16_t cs = 0;
+
+    // The request is not needed anymore, the response is send
+    // from m_msg by the TX interrupt
+    uint8_t *response = m_msg->d;
+
+    const uint8_t frame[24] =
+    {
+    0xfe, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe, 0xaa,                              // byte 0-7
+    (uint8_t)( m_devid.m_id[0] | 0xaa ), (uint8_t)( m_devid.m_id[0] | 0x55 ),    // byte 8, 10   MSB manufacturer
+    (uint8_t)( m_devid.m_id[1] | 0xaa ), (uint8_t)( m_devid.m_id[1] | 0x55 ),    // byte 10, 11  LSB manufacturer
+    (uint8_t)( m_devid.m_id[2] | 0xaa ), (uint8_t)( m_devid.m_id[2] | 0x55 ),    // byte 12, 13  MSB device
+    (uint8_t)( m_devid.m_id[3] | 0xaa ), (uint8_t)( m_devid.m_id[3] | 0x55 ),    // byte 14, 15   .
+    (uint8_t)( m_devid.m_id[4] | 0xaa ), (uint8_t)( m_devid.m_id[4] | 0x55 ),    // byte 16, 17   .
+    (uint8_t)( m_devid.m_id[5] | 0xaa ), (uint8_t)( m_devid.m_id[5] | 0x55 ),    // byte 18, 19  LSB device
+    0x0, 0x0, 0x0, 0x0                                                           // Checksum space
+    };
+
+    memcpy ( response, frame, sizeof ( frame ) );
+
+    // Calculate checksum
+    for ( int i=8; i<20; i++ )
+        cs += (uint16_t)response [i];
+
+    // Write checksum into response
+    response [20] = HIGHBYTE (cs) | 0xaa;
+    response [21] = HIGHBYTE (cs) | 0x55;
+    response [22] = LOWBYTE  (cs) | 0xaa;
+    response [23] = LOWBYTE  (cs) | 0x55;
+
+    // Table 3-2 ANSI_E1-20-2010 <2ms 
+    m_port->respond ( m_requestEnd, response, sizeof ( frame ) );
+}
+
+void RDM_Responder::setParameters ( const RDM_Parameter *table, uint8_t count )
+{
+    m_parameters    = table;
+    m_nrParameters  = count;
+}
+
+RDM_SubDevice::RDM_SubDevice ( DMX_Slave &slave, uint16_t deviceModelId, uint8_t personalities )
+:   m_slave ( &slave ),
+    m_deviceModelId ( deviceModelId ),
+    m_personalities ( personalities ),
+    m_personality ( 1 ),
+    m_identify ( false )
+{
+    memset ( (void *)m_deviceLabel, ' ', RDM_MAX_DEVICELABEL_LENGTH );
+}
+
+void RDM_SubDevice::setDeviceLabel ( const char *label, size_t len )
+{
+    if ( len > RDM_MAX_DEVICELABEL_LENGTH )
+        len = RDM_MAX_DEVICELABEL_LENGTH;
+
+    memset ( (void *)m_deviceLabel, ' ', RDM_MAX_DEVICELABEL_LENGTH );
+    memcpy ( (void *)m_deviceLabel, (void *)label, len );
+}
+
+uint16_t RDM_Responder::addSubDevice ( RDM_SubDevice &sub )
+{
+    RDM_SubDevice **subs;
+
+    if ( m_nrSubDevices == RDM_MAX_SUBDEVICES )
+        return 0;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        subs = (RDM_SubDevice **) realloc ( m_subDevices, 
+                        (m_nrSubDevices + 1) * sizeof ( RDM_SubDevice * ) );
+        if ( subs )
+        {
+            m_subDevices = subs;
+            m_subDevices[m_nrSubDevices++] = &sub;
+        }
+    }
+
+    return subs ? m_nrSubDevices : 0;
+}
+
+RDM_SubDevice *RDM_Responder::getSubDevice ( uint16_t nr )
+{
+    if ( nr == RDM_ROOT_DEVICE || nr > m_nrSubDevices )
+        return NULL;
+
+    return m_subDevices[nr - 1];
+}
+
+RDM_SubDevice *RDM_Responder::getSubDevice ( RDM_Message *msg )
+{
+    return getSubDevice ( msg->subDevice );
+}
+
+void RDM_Responder::configChanged ( void )
+{
+    if ( m_config )
+        m_config->changed ();
+}
+
+void RDM_Responder::subDeviceChanged ( RDM_Message *msg )
+{
+    if ( event_onSubDeviceChanged )
+        event_onSubDeviceChanged ( msg->subDevice, msg->PID );
+}
+
+bool RDM_Responder::queueMessage ( uint16_t pid, uint16_t subDevice )
+{
+    RDM_QueuedMessage   queued = { pid, subDevice };
+    RDM_Parameter       param;
+    bool                rval;
+
+    // Only what QUEUED_MESSAGE can answer, anything else would be
+    // popped and lost
+    if ( !findParameter ( pid, param ) || !( param.flags & rdm::ParameterGet ) ||
+         param.getPdl )
+        return false;
+
+    // Pushes are serialized, the queue has a single producer
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        rval = m_queued.push ( queued );
+    }
+
+    return rval;
+}
+
+bool RDM_Responder::addStatusMessage ( rdm::RdmStatusTypes type, uint16_t id, 
+                                       int16_t value1, int16_t value2, uint16_t subDevice )
+{
+    bool rval = false;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        if ( m_nrStatus < RDM_STATUS_MESSAGES )
+        {
+            RDM_StatusMessage &status = m_status[m_nrStatus++];
+
+            status.subDevice    = subDevice;
+            status.type         = type;
+            status.id           = id;
+            status.value1       = value1;
+            status.value2       = value2;
+            rval                = true;
+        }
+    }
+
+    return rval;
+}
+
+uint8_t RDM_Responder::getMessageCount ( void )
+{
+    uint8_t count = m_queued.count ();
+
+    // Unreported status messages are collected with one request
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        if ( m_statusReported != (uint8_t)( ( 1 << m_nrStatus ) - 1 ) )
+            count++;
+    }
+
+    return count;
+}
+
+uint8_t RDM_Responder::putStatusMessages ( RDM_ParameterWriter &pd, uint8_t type )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        // Reported messages are dropped once the controller 
+        // asks for new ones
+        if ( type != rdm::StatusGetLastMessage )
+        {
+            uint8_t n = 0;
+
+            for ( uint8_t i = 0; i < m_nrStatus; i++ )
+                if ( !( m_statusReported & ( 1 << i ) ) )
+                    m_status[n++] = m_status[i];
+
+            m_nrStatus          = n;
+            m_statusReported    = 0;
+        }
+
+        for ( uint8_t i = 0; i < m_nrStatus; i++ )
+        {
+            RDM_StatusMessage &status = m_status[i];
+
+            // Cleared types count as the type they clear
+            bool wanted = ( type == rdm::StatusGetLastMessage ) ?
+                            ( m_statusReported & ( 1 << i ) ) :
+                            ( type != rdm::StatusNone && ( status.type & 0x0f ) >= type );
+
+            // What does not fit is reported next time
+            if ( !wanted || pd.length () + RDM_STATUS_MESSAGE_LEN > RDM_PD_MAXLEN )
+                continue;
+
+            pd.put16 ( status.subDevice );
+            pd.put   ( status.type );
+            pd.put16 ( status.id );
+            pd.put16 ( status.value1 );
+            pd.put16 ( status.value2 );
+
+            m_statusReported |= ( 1 << i );
+        }
+    }
+
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::addSensor ( const RDM_SensorDefinition *def, int16_t (*sample)(uint8_t) )
+{
+    RDM_Sensor *sensors;
+
+    // Sensor numbers 0 - 254
+    if ( m_nrSensors == RDM_ALL_SENSORS )
+        return RDM_ALL_SENSORS;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        sensors = (RDM_Sensor *) realloc ( m_sensors, (m_nrSensors + 1) * sizeof ( RDM_Sensor ) );
+        if ( sensors )
+            m_sensors = sensors;
+    }
+
+    if ( !sensors )
+        return RDM_ALL_SENSORS;
+
+    RDM_Sensor &sensor = m_sensors[m_nrSensors];
+
+    sensor.def      = def;
+    sensor.sample   = sample;
+    sensor.value    = 0;
+    sensor.recorded = 0;
+    sensor.lowest   = 0x7fff;       // No value yet
+    sensor.highest  = -0x8000;
+
+    if ( sample )
+        setSensorValue ( m_nrSensors, sample ( m_nrSensors ) );
+
+    return m_nrSensors++;
+}
+
+void RDM_Responder::setSensorValue ( uint8_t sensor, int16_t value )
+{
+    if ( sensor >= m_nrSensors )
+        return;
+
+    RDM_Sensor &s = m_sensors[sensor];
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        s.value = value;
+
+        if ( value < s.lowest )
+            s.lowest = value;
+        if ( value > s.highest )
+            s.highest = value;
+    }
+}
+
+int16_t RDM_Responder::getSensorValue ( uint8_t sensor )
+{
+    int16_t value = 0;
+
+    if ( sensor < m_nrSensors )
+    {
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+        {
+            value = m_sensors[sensor].value;
+        }
+    }
+
+    return value;
+}
+
+void RDM_Responder::sampleSensors ( void )
+{
+    if ( !m_nrSensors || !m_port )
+        return;
+
+    uint32_t now = m_port->usart.micros ();
+
+    if ( now - m_sensorSampledAt < (uint32_t)m_sensorInterval * 1000 )
+        return;
+
+    m_sensorSampledAt = now;
+
+    for ( uint8_t i = 0; i < m_nrSensors; i++ )
+        if ( m_sensors[i].sample )
+            setSensorValue ( i, m_sensors[i].sample ( i ) );
+}
+
+void RDM_Responder::populateDeviceInfo ( RDM_ParameterWriter &pd, RDM_SubDevice *sub )
+{
+    DMX_Slave *slave = sub ? sub->m_slave : m_slave;
+
+    pd.put   ( 0x01 );                              // Protocol version major
+    pd.put   ( 0x00 );                              // Protocol version minor
+    pd.put16 ( sub ? sub->m_deviceModelId : m_DeviceModelId );
+    pd.put16 ( m_ProductCategory );
+    pd.put   ( m_SoftwareVersionId, 4 );
+    pd.put16 ( slave->getBufferSize()-1 );          // Footprint eq buffersize-startbyte
+    pd.put   ( sub ? sub->m_personality : m_Personality );
+    pd.put   ( sub ? sub->m_personalities : m_Personalities );
+    pd.put16 ( slave->getStartAddress() );
+
+    // Sub-devices and sensors belong to the root device
+    pd.put16 ( sub ? 0 : m_nrSubDevices );
+    pd.put   ( sub ? 0 : m_nrSensors );
+}
+
+const uint8_t ManufacturerLabel_P[] PROGMEM = "Conceptinetics"; 
+
+//
+// Parameter tables are searched by halving the range, the standard
+// table is checked to be sorted at compile time
+//
+static constexpr bool rdmParametersSorted ( const RDM_Parameter *table, uint8_t count )
+{
+    return count < 2 || 
+           ( table[0].pid < table[1].pid && rdmParametersSorted ( table + 1, count - 1 ) );
+}
+
+const RDM_Parameter *RDM_Responder::getStandardParameters ( uint8_t &count )
+{
+    using namespace rdm;
+
+    static constexpr RDM_Parameter table[] PROGMEM =
+    {
+        // PID                  Flags                                       GET SET     Handler
+        { DiscUniqueBranch,     ParameterDiscovery | ParameterRequired,     0,  12, 12, discUniqueBranch },
+        { DiscMute,             ParameterDiscovery | ParameterRequired,     0,  0,  0,  discMute },
+        { DiscUnMute,           ParameterDiscovery | ParameterRequired,     0,  0,  0,  discUnMute },
+        { QueuedMessage,        ParameterGet,                               1,  0,  0,  queuedMessage },
+        { StatusMessages,       ParameterGet,                               1,  0,  0,  statusMessages },
+        { SupportedParameters,  ParameterGet | ParameterRequired | ParameterSubDevice, 0, 0, 0, supportedParameters },
+        { DeviceInfo,           ParameterGet | ParameterRequired | ParameterSubDevice, 0, 0, 0, deviceInfo },
+        { ManufacturerLabel,    ParameterGet,                               0,  0,  0,  manufacturerLabel },
+        { DeviceLabel,          ParameterGet | ParameterSet | ParameterSubDevice, 0, 0, RDM_MAX_DEVICELABEL_LENGTH, deviceLabel },
+        { DmxPersonality,       ParameterGet | ParameterSet | ParameterSubDevice, 0, 1, 1, dmxPersonality },
+        { DmxStartAddress,      ParameterGet | ParameterSet | ParameterRequired | ParameterSubDevice, 0, 2, 2, dmxStartAddress },
+        { SensorDefinition,     ParameterGet | ParameterSensor,             1,  0,  0,  sensorDefinition },
+        { SensorValue,          ParameterGet | ParameterSet | ParameterSensor, 1, 1, 1, sensorValue },
+        { RecordSensors,        ParameterSet | ParameterSensor,             0,  1,  1,  recordSensors },
+        { IdentifyDevice,       ParameterGet | ParameterSet | ParameterRequired | ParameterSubDevice, 0, 1, 1, identifyDevice },
+    };
+
+    static_assert ( rdmParametersSorted ( table, sizeof ( table ) / sizeof ( table[0] ) ),
+                    "Standard parameters must be sorted by PID" );
+
+    count = sizeof ( table ) / sizeof ( table[0] );
+    return table;
+}
+
+//
+// Binary search of a PROGMEM table, the entry is copied into param
+//
+static bool findParameterIn ( const RDM_Parameter *table, uint8_t count, 
+                              uint16_t pid, RDM_Parameter &param )
+{
+    uint8_t lo = 0;
+    uint8_t hi = count;
+
+    while ( lo < hi )
+    {
+        uint8_t     mid = ( lo + hi ) / 2;
+        uint16_t    v   = pgm_read_word ( &table[mid].pid );
+
+        if ( v == pid )
+        {
+            memcpy_P ( &param, &table[mid], sizeof ( RDM_Parameter ) );
+            return true;
+        }
+
+        if ( v < pid )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return false;
+}
+
+bool RDM_Responder::findParameter ( uint16_t pid, RDM_Parameter &param )
+{
+    uint8_t             count;
+    const RDM_Parameter *table = getStandardParameters ( count );
+
+    if ( findParameterIn ( table, count, pid, param ) )
+        return true;
+
+    return m_parameters && findParameterIn ( m_parameters, m_nrParameters, pid, param );
+}
+
+//
+// Answered from the cache, interrupts are disabled while reading
+// it for deferred requests
+//
+void RDM_Responder::putSensorValue ( RDM_ParameterWriter &pd, uint8_t sensor )
+{
+    RDM_Sensor s;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        s = m_sensors[sensor];
+    }
+
+    // Not sampled yet
+    if ( s.lowest > s.highest )
+        s.lowest = s.highest = 0;
+
+    pd.put   ( sensor );
+    pd.put16 ( s.value );
+    pd.put16 ( s.lowest );
+    pd.put16 ( s.highest );
+    pd.put16 ( s.recorded );
+}
+
+uint8_t RDM_Responder::discUniqueBranch ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter & )
+{
+    RDM_DiscUniqueBranchPD &branch = msg->view<RDM_DiscUniqueBranchPD> ();
+
+    // Check if we are inside the given unique branch (bounds included)...
+    if ( !r.m_rdmStatus.mute && r.m_devid.within ( branch.lbound, branch.hbound ) )
+    {
+        // Discovery messages are responded with data only and no breaks
+        r.repondDiscUniqueBranch ();
+    }
+
+    return RDM_NO_RESPONSE;
+}
+
+uint8_t RDM_Responder::discMute ( RDM_Responder &r, RDM_Message *, RDM_ParameterWriter &pd )
+{
+    r.m_rdmStatus.mute = true;
+    pd.put16 ( 0x0 );   // Control field
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::discUnMute ( RDM_Responder &r, RDM_Message *, RDM_ParameterWriter &pd )
+{
+    r.m_rdmStatus.mute = false;
+    pd.put16 ( 0x0 );   // Control field
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::queuedMessage ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd )
+{
+    uint8_t             type = msg->PD[0];
+    RDM_QueuedMessage   queued;
+    RDM_Parameter       param;
+
+    if ( type > rdm::StatusError )
+        return rdm::DataOutOfRange;
+
+    if ( type == rdm::StatusGetLastMessage )
+        queued = r.m_lastQueued;
+    else if ( !r.m_queued.pop ( queued ) )
+        queued.pid = 0;
+
+    if ( type != rdm::StatusGetLastMessage )
+        r.m_lastQueued = queued;
+
+    // Respond with the GET response of the queued parameter
+    if ( queued.pid && r.findParameter ( queued.pid, param ) &&
+         ( param.flags & rdm::ParameterGet ) && !param.getPdl )
+    {
+        msg->PID        = queued.pid;
+        msg->subDevice  = queued.subDevice;
+        msg->PDL        = 0;
+
+        return param.handler ( r, msg, pd );
+    }
+
+    // Nothing queued, respond with the status messages
+    msg->PID = rdm::StatusMessages;
+
+    return r.putStatusMessages ( pd, type );
+}
+
+uint8_t RDM_Responder::statusMessages ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd )
+{
+    uint8_t type = msg->PD[0];
+
+    if ( type > rdm::StatusError )
+        return rdm::DataOutOfRange;
+
+    return r.putStatusMessages ( pd, type );
+}
+
+uint8_t RDM_Responder::supportedParameters ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd )
+{
+    uint8_t             count;
+    const RDM_Parameter *table  = getStandardParameters ( count );
+    bool                sub     = r.getSubDevice ( msg ) != NULL;
+
+    // Parameters required for every device are not listed
+    for ( uint8_t i = 0; i < count; i++ )
+    {
+        uint8_t flags = pgm_read_byte ( &table[i].flags );
+
+        if ( ( flags & rdm::ParameterRequired ) ||
+             ( ( flags & rdm::ParameterSensor ) && !r.m_nrSensors ) ||
+             ( sub && !( flags & rdm::ParameterSubDevice ) ) )
+            continue;
+
+        pd.put16 ( pgm_read_word ( &table[i].pid ) );
+    }
+
+    for ( uint8_t i = 0; r.m_parameters && i < r.m_nrParameters; i++ )
+    {
+        if ( sub && !( pgm_read_byte ( &r.m_parameters[i].flags ) & rdm::ParameterSubDevice ) )
+            continue;
+
+        pd.put16 ( pgm_read_word ( &r.m_parameters[i].pid ) );
+    }
+
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::deviceInfo ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd )
+{
+    r.populateDeviceInfo ( pd, r.getSubDevice ( msg ) );
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::manufacturerLabel ( RDM_Responder &, RDM_Message *, RDM_ParameterWriter &pd )
+{
+    // Without the terminating zero
+    for ( uint8_t i = 0; i < sizeof ( ManufacturerLabel_P ) - 1; i++ )
+        pd.put ( pgm_read_byte ( &ManufacturerLabel_P[i] ) );
+
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::deviceLabel ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd )
+{
+    RDM_SubDevice   *sub    = r.getSubDevice ( msg );
+    char            *label  = sub ? sub->m_deviceLabel : r.m_deviceLabel;
+
+    if ( msg->CC == rdm::GetCommand )
+    {
+        pd.put ( (const uint8_t*) label, RDM_MAX_DEVICELABEL_LENGTH );
+    }
+    else
+    {
+        memset ( (void*) label, ' ', RDM_MAX_DEVICELABEL_LENGTH );
+        memcpy ( (void*) label, msg->PD, msg->PDL );
+
+        // Notify application
+        if ( sub )
+            r.subDeviceChanged ( msg );
+        else
+        {
+            r.configChanged ();
+
+            if ( r.event_onDeviceLabelChanged )
+                r.event_onDeviceLabelChanged ( label, RDM_MAX_DEVICELABEL_LENGTH );
+        }
+    }
+
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::dmxPersonality ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd )
+{
+    RDM_SubDevice   *sub            = r.getSubDevice ( msg );
+    uint8_t         &current        = sub ? sub->m_personality : r.m_Personality;
+    uint8_t         personalities   = sub ? sub->m_personalities : r.m_Personalities;
+
+    if ( msg->CC == rdm::GetCommand )
+    {
+        pd.put ( current );
+        pd.put ( personalities );
+    }
+    else
+    {
+        uint8_t personality = msg->PD[0];
+
+        if ( personality < 1 || personality > personalities )
+            return rdm::DataOutOfRange;
+
+        current = personality;
+
+        if ( sub )
+            r.subDeviceChanged ( msg );
+        else
+        {
+            r.configChanged ();
+
+            if ( r.event_onDMXPersonalityChanged )
+                r.event_onDMXPersonalityChanged ( current );
+        }
+    }
+
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::dmxStartAddress ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd )
+{
+    RDM_SubDevice   *sub    = r.getSubDevice ( msg );
+    DMX_Slave       *slave  = sub ? sub->m_slave : r.m_slave;
+
+    if ( msg->CC == rdm::GetCommand )
+    {
+        pd.put16 ( slave->getStartAddress () );
+    }
+    else
+    {
+        uint16_t address = msg->view<RDM_DmxStartAddressPD> ().address;
+
+        if ( address < 1 || address > DMX_MAX_FRAMECHANNELS )
+            return rdm::DataOutOfRange;
+
+        slave->setStartAddress ( address );
+
+        if ( sub )
+            r.subDeviceChanged ( msg );
+        else
+        {
+            r.configChanged ();
+
+            if ( r.event_onDMXStartAddressChanged )
+                r.event_onDMXStartAddressChanged ( address );
+        }
+    }
+
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::sensorDefinition ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd )
+{
+    uint8_t                 sensor = msg->PD[0];
+    RDM_SensorDefinition    def;
+
+    if ( sensor >= r.m_nrSensors )
+        return rdm::DataOutOfRange;
+
+    memcpy_P ( &def, r.m_sensors[sensor].def, sizeof ( def ) );
+
+    pd.put   ( sensor );
+    pd.put   ( def.type );
+    pd.put   ( def.unit );
+    pd.put   ( def.prefix );
+    pd.put16 ( def.rangeMin );
+    pd.put16 ( def.rangeMax );
+    pd.put16 ( def.normalMin );
+    pd.put16 ( def.normalMax );
+    pd.put   ( 0x03 );      // Recorded value and lowest / highest supported
+
+    for ( uint8_t i = 0; def.description && i < RDM_MAX_DESCRIPTION_LENGTH; i++ )
+    {
+        uint8_t c = pgm_read_byte ( &def.description[i] );
+
+        if ( !c )
+            break;
+
+        pd.put ( c );
+    }
+
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::sensorValue ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd )
+{
+    uint8_t sensor = msg->PD[0];
+
+    if ( sensor == RDM_ALL_SENSORS && msg->CC == rdm::SetCommand )
+    {
+        for ( uint8_t i = 0; i < r.m_nrSensors; i++ )
+        {
+            RDM_Sensor &s = r.m_sensors[i];
+
+            ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+            {
+                s.lowest = s.highest = s.recorded = s.value;
+            }
+        }
+
+        // Response to a reset of all sensors holds no values
+        pd.put ( RDM_ALL_SENSORS );
+        for ( uint8_t i = 0; i < 8; i++ )
+            pd.put ( 0x0 );
+
+        return RDM_ACK;
+    }
+
+    if ( sensor >= r.m_nrSensors )
+        return rdm::DataOutOfRange;
+
+    if ( msg->CC == rdm::SetCommand )
+    {
+        RDM_Sensor &s = r.m_sensors[sensor];
+
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+        {
+            s.lowest = s.highest = s.recorded = s.value;
+        }
+    }
+
+    r.putSensorValue ( pd, sensor );
+
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::recordSensors ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter & )
+{
+    uint8_t sensor = msg->PD[0];
+
+    if ( sensor != RDM_ALL_SENSORS && sensor >= r.m_nrSensors )
+        return rdm::DataOutOfRange;
+
+    for ( uint8_t i = 0; i < r.m_nrSensors; i++ )
+    {
+        if ( sensor != RDM_ALL_SENSORS && sensor != i )
+            continue;
+
+        RDM_Sensor &s = r.m_sensors[i];
+
+        ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+        {
+            s.recorded = s.value;
+        }
+    }
+
+    return RDM_ACK;
+}
+
+uint8_t RDM_Responder::identifyDevice ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd )
+{
+    RDM_SubDevice *sub = r.getSubDevice ( msg );
+
+    if ( msg->CC == rdm::GetCommand )
+    {
+        pd.put ( ( sub ? sub->m_identify : r.m_rdmStatus.ident ) ? 1 : 0 );
+    }
+    else
+    {
+        if ( msg->PD[0] > 1 )
+            return rdm::DataOutOfRange;
+
+        // Look into first byte to see whether identification
+        // is turned on or off 
+        if ( sub )
+        {
+            sub->m_identify = msg->PD[0] ? true : false;
+            r.subDeviceChanged ( msg );
+        }
+        else
+        {
+            r.m_rdmStatus.ident = msg->PD[0] ? true : false;
+
+            if ( r.event_onIdentifyDevice )
+                r.event_onIdentifyDevice ( r.m_rdmStatus.ident );
+        }
+    }
+
+    return RDM_ACK;
+}
+
+void RDM_Responder::service ( void )
+{
+    if ( m_port )
+        m_port->service ();
+}
+
+void RDM_Responder::processFrame ( void )
+{
+    // The turnaround time is counted from here
+    m_requestEnd = m_port->usart.micros ();
+
+    if ( !m_deferred )
+    {
+        processRequest ();
+        return;
+    }
+
+    // Only queue what we would process, m_msg is left alone
+    // until service() took care of it
+    if ( m_msg->dstUid.isBroadcast (m_devid.m_id) || m_devid == m_msg->dstUid )
+    {
+        DMX_Event event = { dmx::dmxEventRdmRequest, NULL, 0 };
+
+        if ( m_port->events.push ( event ) )
+            m_requestPending = true;
+    }
+}
+
+void RDM_Responder::processRequest ( void )
+{
+    uint16_t pid    = m_msg->PID;
+    uint16_t skip   = 0;
+
+    // Page to repeat when the response is dropped
+    uint16_t overflowPid    = m_overflowPid;
+    uint16_t overflowOffset = m_overflowOffset;
+    RDM_Uid  overflowSrc    = m_overflowSrc;
+
+    // A controller repeating a request which got an ACK_OVERFLOW
+    // response reads the next page
+    if ( m_msg->CC == rdm::GetCommand && pid == m_overflowPid && 
+         m_msg->srcUid == m_overflowSrc )
+        skip = m_overflowOffset;
+
+    RDM_ParameterWriter pd ( m_msg->PD, skip );
+
+    // If packet is a general broadcast   
+    if (
+        m_msg->dstUid.isBroadcast (m_devid.m_id) ||  
+        m_devid == m_msg->dstUid
+       )
+    {
+        RDM_Parameter   param;
+        uint8_t         command;
+        uint8_t         result;
+
+        switch ( m_msg->CC )
+        {
+            case rdm::DiscoveryCommand: command = rdm::ParameterDiscovery;  break;
+            case rdm::GetCommand:       command = rdm::ParameterGet;        break;
+            case rdm::SetCommand:       command = rdm::ParameterSet;        break;
+            default:                    command = 0;                        break;
+        }
+
+        uint16_t        sub = m_msg->subDevice;
+
+        // Only SET requests can address all sub-devices at once
+        if ( sub == RDM_ALL_SUBDEVICES ? command != rdm::ParameterSet || !m_nrSubDevices :
+             sub > m_nrSubDevices )
+            result = rdm::SubDeviceOutOfRange;
+        else if ( !findParameter ( pid, param ) ||
+             ( ( param.flags & rdm::ParameterSensor ) && !m_nrSensors ) ||
+             ( sub != RDM_ROOT_DEVICE && !( param.flags & rdm::ParameterSubDevice ) ) )
+            result = rdm::UnknownPid;
+        else if ( !( param.flags & command ) )
+            result = rdm::UnsupportedCmdClass;
+        else if ( command == rdm::ParameterGet ? m_msg->PDL != param.getPdl :
+                  m_msg->PDL < param.minPdl || m_msg->PDL > param.maxPdl )
+            result = rdm::FormatError;
+        else if ( sub != RDM_ALL_SUBDEVICES )
+            result = param.handler ( *this, m_msg, pd );
+        else
+        {
+            // Handled once for every sub-device, the first NACK is
+            // reported
+            result = RDM_ACK;
+
+            for ( uint16_t i = 1; i <= m_nrSubDevices; i++ )
+            {
+                m_msg->subDevice = i;
+
+                uint8_t r = param.handler ( *this, m_msg, pd );
+
+                if ( result == RDM_ACK )
+                    result = r;
+            }
+
+            m_msg->subDevice = RDM_ALL_SUBDEVICES;
+        }
+
+        if ( result == RDM_NO_RESPONSE )
+        {
+            m_requestPending = false;
+            return;
+        }
+
+        if ( result == RDM_ACK )
+        {
+            m_msg->portId   = rdm::ResponseTypeAck;
+            m_msg->PDL      = pd.length ();
+        }
+        else
+        {
+            m_msg->portId   = rdm::ResponseTypeNackReason;
+            m_msg->PDL      = sizeof ( RDM_NackReasonPD );
+            m_msg->view<RDM_NackReasonPD> ().reason = result;
+        }
+
+        // More parameter data is left for the next request
+        if ( result == RDM_ACK && pd.overflow () )
+        {
+            m_msg->portId       = rdm::ResponseTypeAckOverflow;
+            m_overflowPid       = pid;
+            m_overflowOffset    = skip + pd.length ();
+            m_overflowSrc.copy ( m_msg->srcUid );
+        }
+        else
+        {
+            m_overflowPid       = 0;
+        }
+    }
+
+    //
+    // Only respond if this this message
+    // was destined to us only
+    if ( m_msg->dstUid == m_devid )
+    {
+        m_msg->startCode     = RDM_START_CODE;
+        m_msg->subStartCode  = 0x01;
+        m_msg->msgLength     = RDM_HDR_LEN + m_msg->PDL;
+        m_msg->msgCount      = getMessageCount ();
+
+        /*
+        switch ( m_msg->msg.CC )
+        {
+            case rdm::DiscoveryCommand:
+                m_msg->msg.CC = rdm::DiscoveryCommandResponse;
+                break;
+            case rdm::GetCommand:
+                m_msg->msg.CC = rdm::GetCommandResponse;
+                break;
+            case rdm::SetCommand:
+                m_msg->msg.CC = rdm::SetCommandResponse;
+                break;
+        }
+        */ 
+        /* Above replaced by next line */
+        m_msg->CC++;
+
+        m_msg->dstUid.copy ( m_msg->srcUid );
+        m_msg->srcUid.copy ( m_devid );
+
+        if ( !m_port->respond ( m_requestEnd ) )
+        {
+            m_overflowPid       = overflowPid;
+            m_overflowOffset    = overflowOffset;
+            m_overflowSrc.copy ( overflowSrc );
+        }
+     }
+
+    m_requestPending = false;
+}
+
+
+//
+// CRC-16-CCITT of the configuration records
+//
+static uint16_t crc16 ( const uint8_t *data, uint8_t len )
+{
+    uint16_t crc = 0xffff;
+
+    while ( len-- )
+    {
+        crc ^= (uint16_t)*data++ << 8;
+
+        for ( uint8_t i = 0; i < 8; i++ )
+            crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ 0x1021 : crc << 1;
+    }
+
+    return crc;
+}
+
+RDM_ConfigStore::RDM_ConfigStore ( RDM_Responder &responder, uint16_t base, uint16_t size )
+:   m_responder ( &responder ),
+    m_base ( base ),
+    m_slots ( size / RecordSize < 255 ? size / RecordSize : 255 ),
+    m_slot ( 0 ),
+    m_seq ( 0 ),
+    m_dirty ( false ),
+    m_changedAt ( 0 ),
+    m_writeDelay ( 2000 ),
+    m_writeSlot ( 0 ),
+    m_writePos ( RecordSize )
+{
+    // First record goes into slot 0
+    if ( m_slots )
+        m_slot = m_slots - 1;
+
+    responder.m_config = this;
+
+    restore ();
+}
+
+RDM_ConfigStore::~RDM_ConfigStore ( void )
+{
+    if ( m_responder->m_config == this )
+        m_responder->m_config = NULL;
+}
+
+uint32_t RDM_ConfigStore::micros ( void )
+{
+    DMX_Port *port = m_responder->m_port;
+
+    return port ? port->usart.micros () : 0;
+}
+
+bool RDM_ConfigStore::restore ( void )
+{
+    uint8_t record[RecordSize];
+    bool    found = false;
+
+    // The newest valid record wins, sequence numbers wrap
+    for ( uint8_t slot = 0; slot < m_slots; slot++ )
+    {
+        DMX_EepromRead ( slotAddress ( slot ), record, RecordSize );
+
+        uint16_t crc = ( record[RecordSize - 2] << 8 ) | record[RecordSize - 1];
+        uint16_t seq = ( record[0] << 8 ) | record[1];
+
+        if ( crc != crc16 ( record, RecordSize - 2 ) )
+            continue;
+
+        if ( !found || (int16_t)( seq - m_seq ) > 0 )
+        {
+            found   = true;
+            m_seq   = seq;
+            m_slot  = slot;
+        }
+    }
+
+    if ( !found )
+        return false;
+
+    DMX_EepromRead ( slotAddress ( m_slot ), record, RecordSize );
+
+    uint16_t address = ( record[2] << 8 ) | record[3];
+
+    if ( address >= 1 && address <= DMX_MAX_FRAMECHANNELS )
+        m_responder->m_slave->setStartAddress ( address );
+
+    if ( record[4] )
+        m_responder->m_Personality = record[4];
+
+    memcpy ( (void*)m_responder->m_deviceLabel, &record[5], RDM_MAX_DEVICELABEL_LENGTH );
+
+    return true;
+}
+
+void RDM_ConfigStore::changed ( void )
+{
+    uint32_t now = micros ();
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        m_dirty     = true;
+        m_changedAt = now;
+    }
+}
+
+void RDM_ConfigStore::flush ( void )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        // Due right away
+        m_changedAt = micros () - (uint32_t)m_writeDelay * 1000;
+    }
+}
+
+bool RDM_ConfigStore::pending ( void )
+{
+    return m_dirty || m_writePos < RecordSize;
+}
+
+//
+// Take a snapshot of the configuration into the next slot
+//
+void RDM_ConfigStore::prepare ( void )
+{
+    uint16_t seq        = m_seq + 1;
+    uint16_t address    = m_responder->m_slave->getStartAddress ();
+
+    m_record[0] = HIGHBYTE(seq);
+    m_record[1] = LOWBYTE (seq);
+    m_record[2] = HIGHBYTE(address);
+    m_record[3] = LOWBYTE (address);
+    m_record[4] = m_responder->m_Personality;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        memcpy ( &m_record[5], (void*)m_responder->m_deviceLabel, RDM_MAX_DEVICELABEL_LENGTH );
+    }
+
+    uint16_t crc = crc16 ( m_record, RecordSize - 2 );
+
+    m_record[RecordSize - 2] = HIGHBYTE(crc);
+    m_record[RecordSize - 1] = LOWBYTE (crc);
+
+    m_writeSlot = ( m_slot + 1 ) % m_slots;
+    m_writePos  = 0;
+}
+
+void RDM_ConfigStore::service ( void )
+{
+    bool due;
+
+    if ( !m_slots )
+        return;
+
+    // One byte at a time, the CRC is written last so the record only
+    // becomes valid once complete
+    if ( m_writePos < RecordSize )
+    {
+        if ( DMX_EepromReady () )
+        {
+            DMX_EepromWrite ( slotAddress ( m_writeSlot ) + m_writePos, m_record[m_writePos] );
+
+            if ( ++m_writePos == RecordSize )
+            {
+                m_slot  = m_writeSlot;
+                m_seq   = ( m_record[0] << 8 ) | m_record[1];
+            }
+        }
+        return;
+    }
+
+    uint32_t now = micros ();
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        due = m_dirty && now - m_changedAt >= (uint32_t)m_writeDelay * 1000;
+
+        if ( due )
+            m_dirty = false;
+    }
+
+    if ( due )
+        prepare ();
+}
+
+
+static const RDM_Uid &broadcastUid ( void )
+{
+    static constexpr RDM_Uid all = RDM_Uid::fromInt ( 0xffffffffffffULL );
+    return all;
+}
+
+RDM_Controller::RDM_Controller ( DMX_Master &master, uint16_t m, uint8_t d1, uint8_t d2, 
+                                 uint8_t d3, uint8_t d4 )
+:   RDM_FrameBuffer ( master.getPort () ? master.getPort ()->getRdmMessage () : NULL ),
+    m_port ( master.getPort () ),
+    m_tn ( 0 ),
+    m_reqState ( RequestIdle ),
+    m_reqCC ( 0 ),
+    m_reqPid ( 0 ),
+    m_expectResponse ( false ),
+    m_discovery ( false ),
+    m_window ( 0 ),
+    m_windowStart ( 0 ),
+    m_cost ( 0 ),
+    m_floorPeriod ( 0 ),
+    m_budget ( 0 ),
+    m_lastBreak ( 0 ),
+    m_rxStage ( 0 ),
+    m_rxValid ( false ),
+    m_discLen ( 0 ),
+    m_discCollision ( false ),
+    m_discState ( DiscIdle ),
+    m_branchLo ( 0 ),
+    m_branchDepth ( 0 ),
+    m_foundMuted ( false ),
+    m_fullDiscovery ( false ),
+    m_sweepInterval ( 0 ),
+    m_sweepAt ( 0 ),
+    m_checkNext ( 0 ),
+    m_discStart ( 0 ),
+    m_discTime ( 0 ),
+    m_devices ( NULL ),
+    m_nrDevices ( 0 ),
+    m_maxDevices ( 0 ),
+    m_polls ( NULL ),
+    m_nrPolls ( 0 ),
+    m_pollActive ( 0 ),
+    m_userState ( UserIdle ),
+    m_heldAt ( 0 ),
+    m_pollStatsAt ( 0 ),
+    event_onDeviceFound ( NULL ),
+    event_onDeviceLost ( NULL ),
+    event_onPollResponse ( NULL )
+{
+    if ( m_port )
+        m_port->controller = this;
+
+    m_uid.Initialize ( m, d1, d2, d3, d4 );
+    memset ( (void *)&m_stats, 0x0, sizeof ( m_stats ) );
+    memset ( (void *)&m_pollStats, 0x0, sizeof ( m_pollStats ) );
+}
+
+RDM_Controller::~RDM_Controller ( void )
+{
+    if ( m_port && m_port->controller == this )
+        m_port->controller = NULL;
+
+    free ( m_devices );
+    free ( m_polls );
+}
+
+void RDM_Controller::onDeviceFound ( void (*func)(const RDM_Uid &) )
+{
+    event_onDeviceFound = func;
+}
+
+void RDM_Controller::onDeviceLost ( void (*func)(const RDM_Uid &) )
+{
+    event_onDeviceLost = func;
+}
+
+void RDM_Controller::setMinFrameRate ( uint16_t fps )
+{
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        m_floorPeriod   = fps ? 1000000UL / fps : 0;
+        m_budget        = 0;
+    }
+}
+
+//
+// Every frame earns the time it leaves of the frame period at the 
+// minimum rate, requests spend it. The budget is capped so a burst of
+// requests after a quiet period can not stall the frames
+//
+void RDM_Controller::frameStarted ( uint32_t now_us )
+{
+    int32_t cap     = m_floorPeriod + 2 * RDM_DISCOVERY_WINDOW_USEC;
+    int32_t budget  = m_budget + (int32_t)m_floorPeriod - (int32_t)( now_us - m_lastBreak );
+
+    if ( budget > cap )
+        budget = cap;
+    else if ( budget < -cap )
+        budget = -cap;
+
+    m_budget    = budget;
+    m_lastBreak = now_us;
+}
+
+bool RDM_Controller::requestFits ( uint32_t now_us, bool sameGap )
+{
+    if ( !m_floorPeriod )
+        return !sameGap;
+
+    // Budget at the next break if the request goes out now
+    return m_budget + (int32_t)m_floorPeriod - (int32_t)( now_us - m_lastBreak ) 
+           - (int32_t)m_cost >= 0;
+}
+
+bool RDM_Controller::isBusy ( void )
+{
+    uint8_t state = m_reqState;
+
+    // A poll is busy until its response is handled by service()
+    return state == RequestReady || state == RequestBusy || m_pollActive;
+}
+
+bool RDM_Controller::sendRequest ( const RDM_Uid &dst, rdm::RdmCommandClass cc, uint16_t pid,
+                                   const uint8_t *pd, uint8_t pdl, uint16_t subDevice )
+{
+    if ( !m_msg || isBusy () || m_discState != DiscIdle || pdl > RDM_PD_MAXLEN )
+    {
+        deferPolls ();
+        return false;
+    }
+
+    // The response stays available for a sweep interval
+    m_sweepAt   = m_port->usart.micros ();
+    m_userState = UserBusy;
+
+    request ( dst, cc, pid, pd, pdl, subDevice );
+    return true;
+}
+
+RDM_Message *RDM_Controller::getResponse ( void )
+{
+    if ( m_reqState != RequestDone )
+        return NULL;
+
+    // Read, polls and sweeps can go on
+    if ( m_userState == UserHeld )
+        m_userState = UserIdle;
+
+    return responseValid () ? m_msg : NULL;
+}
+
+void RDM_Controller::request ( const RDM_Uid &dst, uint8_t cc, uint16_t pid, 
+                               const uint8_t *pd, uint8_t pdl, uint16_t subDevice )
+{
+    m_msg->startCode    = RDM_START_CODE;
+    m_msg->subStartCode = 0x01;
+    m_msg->msgLength    = RDM_HDR_LEN + pdl;
+    m_msg->dstUid.copy ( dst );
+    m_msg->srcUid.copy ( m_uid );
+    m_msg->TN           = ++m_tn;
+    m_msg->portId       = 0x01;
+    m_msg->msgCount     = 0x0;
+    m_msg->subDevice    = subDevice;
+    m_msg->CC           = cc;
+    m_msg->PID          = pid;
+    m_msg->PDL          = pdl;
+
+    if ( pdl )
+        memcpy ( (void *)m_msg->PD, (void *)pd, pdl );
+
+    m_reqCC     = cc;
+    m_reqPid    = pid;
+    m_reqDst.copy ( dst );
+
+    // Responses to discovery branches collide, they are collected
+    // for the whole window and decoded afterwards
+    m_discovery = ( cc == rdm::DiscoveryCommand && pid == rdm::DiscUniqueBranch );
+
+    if ( m_discovery )
+    {
+        m_expectResponse    = true;
+        m_window            = RDM_DISCOVERY_WINDOW_USEC;
+    }
+    else if ( m_reqDst.isBroadcast ( m_reqDst.m_id ) )
+    {
+        m_expectResponse    = false;
+        m_window            = RDM_BROADCAST_SPACING_USEC;
+    }
+    else
+    {
+        m_expectResponse    = true;
+        m_window            = RDM_RESPONSE_TIMEOUT_USEC;
+    }
+
+    // Line time counted against the minimum frame rate, a response is
+    // counted without parameter data
+    m_cost = DMX_BREAK_USEC + ( RDM_HDR_LEN + pdl + 2 ) * DMX_SLOT_USEC + m_window;
+
+    if ( m_expectResponse && !m_discovery )
+        m_cost += ( RDM_HDR_LEN + 2 ) * DMX_SLOT_USEC + RDM_CONTROLLER_SPACING_USEC;
+
+    m_rxStage       = 0;
+    m_rxValid       = false;
+    m_discLen       = 0;
+    m_discCollision = false;
+    m_reqState      = RequestReady;
+}
+
+bool RDM_Controller::responseValid ( void )
+{
+    return m_rxValid &&
+           m_msg->CC == m_reqCC + 1 &&
+           m_msg->TN == m_tn &&
+           // A queued message is answered with the response of its PID
+           ( m_msg->PID == m_reqPid || m_reqPid == rdm::QueuedMessage ) &&
+           m_msg->srcUid == m_reqDst &&
+           m_msg->dstUid == m_uid;
+}
+
+bool RDM_Controller::requestSent ( uint16_t &window )
+{
+    m_windowStart   = m_port->usart.micros ();
+    window          = m_window;
+
+    return m_expectResponse;
+}
+
+uint16_t RDM_Controller::windowSpacing ( void )
+{
+    // The timeout of a lost response ends short of the spacing
+    return m_expectResponse && !m_discovery ? 
+           RDM_LOST_RESPONSE_USEC - RDM_RESPONSE_TIMEOUT_USEC : 0;
+}
+
+bool RDM_Controller::processResponse ( uint8_t val, bool framingError )
+{
+    if ( m_discovery )
+    {
+        // Responders answering together garble the bytes or send
+        // more than a single response
+        if ( framingError || m_discLen == DiscResponseSize )
+            m_discCollision = true;
+        else
+            m_disc[m_discLen++] = val;
+
+        return false;
+    }
+
+    // Every slot extends the window, responses can be longer than it
+    m_windowStart = m_port->usart.micros ();
+
+#if defined(USE_DMX_BREAK_TIMER)
+    if ( m_port->usart.hasTimer () )
+        m_port->usart.startTimer ( m_window );
+#endif
+
+    switch ( m_rxStage )
+    {
+        case 0:
+            // Response starts with a break
+            if ( framingError )
+                m_rxStage = 1;
+            return false;
+
+        case 1:
+            if ( framingError || val != RDM_START_CODE )
+                return true;
+
+            m_rxStage = 2;
+            return processIncoming ( val, true );
+
+        default:
+            // A break ends the response
+            return framingError || processIncoming ( val );
+    }
+}
+
+void RDM_Controller::processFrame ( void )
+{
+    m_rxValid = true;
+}
+
+void RDM_Controller::service ( void )
+{
+    if ( !m_port )
+        return;
+
+    ATOMIC_BLOCK ( ATOMIC_RESTORESTATE )
+    {
+        // Without a master nothing is transmitted, no gap to wait for
+        if ( m_reqState == RequestReady && !m_port->master )
+            m_port->startRequest ();
+
+        // Window passed without the timer noticing (not available, or
+        // stopped by a master which got disabled)
+        if ( m_reqState == RequestBusy && m_port->txState == isr::RdmResponseWait &&
+             m_port->usart.micros () - m_windowStart >= m_window )
+            m_port->requestDone ( windowSpacing () );
+    }
+
+    if ( m_discState == DiscIdle )
+    {
+        if ( m_pollActive && m_reqState == RequestDone )
+            pollAnswered ();
+
+        if ( !m_msg || isBusy () || holdResponse () )
+            return;
+
+        // Background sweep when the line is free, polls otherwise
+        if ( m_sweepInterval &&
+             m_port->usart.micros () - m_sweepAt >= (uint32_t)m_sweepInterval * 1000 )
+        {
+            m_fullDiscovery = false;
+            m_branchLo      = 0;
+            m_branchDepth   = 0;
+            m_foundMuted    = false;
+            m_discState     = DiscBranch;
+            sendBranch ();
+        }
+        else
+        {
+            sendPoll ();
+        }
+        return;
+    }
+
+    if ( m_reqState != RequestDone )
+        return;
+
+    switch ( m_discState )
+    {
+        case DiscUnMute:
+            // Start with the whole UID space
+            m_branchLo      = 0;
+            m_branchDepth   = 0;
+            m_foundMuted    = false;
+            m_discState     = DiscBranch;
+            sendBranch ();
+            break;
+
+        case DiscBranch:
+            branchAnswered ();
+            break;
+
+        case DiscMute:
+            muteAnswered ();
+            break;
+
+        case DiscCheck:
+            checkAnswered ();
+            break;
+    }
+}
+
+bool RDM_Controller::startDiscovery ( void )
+{
+    if ( !m_msg || isBusy () || m_discState != DiscIdle )
+    {
+        deferPolls ();
+        return false;
+    }
+
+    // Devices not found again are removed at the end
+    for ( uint16_t i = 0; i < m_nrDevices; i++ )
+        m_devices[i].missed = Unconfirmed;
+
+    memset ( (void *)&m_stats, 0x0, sizeof ( m_stats ) );
+
+    m_fullDiscovery = true;
+    m_discStart     = m_port->usart.micros ();
+    m_discState     = DiscUnMute;
+
+    request ( broadcastUid (), rdm::DiscoveryCommand, rdm::DiscUnMute, NULL, 0, RDM_ROOT_DEVICE );
+    return true;
+}
+
+void RDM_Controller::sendBranch ( void )
+{
+    RDM_DiscUniqueBranchPD  pd;
+    uint64_t                size = 1ULL << ( 48 - m_branchDepth );
+
+    // UIDs are bisected as 48 bit numbers
+    pd.lbound = RDM_Uid::fromInt ( m_branchLo );
+    pd.hbound = RDM_Uid::fromInt ( m_branchLo + size - 1 );
+
+    m_stats.branches++;
+    request ( broadcastUid (), rdm::DiscoveryCommand, rdm::DiscUniqueBranch, 
+              (const uint8_t *)&pd, sizeof ( pd ), RDM_ROOT_DEVICE );
+}
+
+void RDM_Controller::splitBranch ( void )
+{
+    // A single UID can not be split, two responders share it
+    if ( m_branchDepth == 48 )
+    {
+        nextBranch ();
+        return;
+    }
+
+    // Lower half first
+    m_branchDepth++;
+    sendBranch ();
+}
+
+void RDM_Controller::nextBranch ( void )
+{
+    while ( m_branchDepth )
+    {
+        uint64_t size = 1ULL << ( 48 - m_branchDepth );
+
+        // Lower half done, continue with the upper half
+        if ( !( m_branchLo & size ) )
+        {
+            m_branchLo += size;
+            sendBranch ();
+            return;
+        }
+
+        // Both halves done, so is their parent
+        m_branchLo -= size;
+        m_branchDepth--;
+    }
+
+    if ( !m_fullDiscovery )
+    {
+        sweepDone ();
+        return;
+    }
+
+    for ( uint16_t i = m_nrDevices; i-- > 0; )
+        if ( m_devices[i].missed == Unconfirmed )
+            removeDevice ( i );
+
+    m_discState = DiscIdle;
+    m_discTime  = ( m_port->usart.micros () - m_discStart ) / 1000;
+    m_sweepAt   = m_port->usart.micros ();
+}
+
+void RDM_Controller::branchAnswered ( void )
+{
+    RDM_Uid uid;
+
+    if ( !m_discLen && !m_discCollision )
+    {
+        nextBranch ();
+    }
+    else if ( decodeDiscovery ( uid ) && !( m_foundMuted && uid == m_found ) )
+    {
+        // Only the mute response proves the UID was not a lucky
+        // checksum of a collision
+        m_found.copy ( uid );
+        m_foundMuted    = false;
+        m_discState     = DiscMute;
+        m_stats.mutes++;
+
+        request ( uid, rdm::DiscoveryCommand, rdm::DiscMute, NULL, 0, RDM_ROOT_DEVICE );
+    }
+    else
+    {
+        // A device answering after it was muted is split off as well
+        m_stats.collisions++;
+        splitBranch ();
+    }
+}
+
+void RDM_Controller::muteAnswered ( void )
+{
+    RDM_Message *msg = getResponse ();
+    uint16_t    index;
+
+    m_discState = DiscBranch;
+
+    if ( msg && msg->portId == rdm::ResponseTypeAck )
+    {
+        // Known devices answer when they lost their mute (power cycle)
+        if ( findDevice ( m_found, index ) )
+            m_devices[index].missed = 0;
+        else
+            addDevice ( m_found );
+
+        m_foundMuted = true;
+
+        // Others may be hiding behind it
+        sendBranch ();
+    }
+    else
+    {
+        m_stats.collisions++;
+        splitBranch ();
+    }
+}
+
+//
+// End of a background sweep, one known device is muted again to see 
+// whether it is still there
+//
+void RDM_Controller::sweepDone ( void )
+{
+    if ( m_checkNext >= m_nrDevices )
+        m_checkNext = 0;
+
+    if ( !m_nrDevices )
+    {
+        m_discState = DiscIdle;
+        m_sweepAt   = m_port->usart.micros ();
+        return;
+    }
+
+    m_discState = DiscCheck;
+    request ( m_devices[m_checkNext].uid, rdm::DiscoveryCommand, rdm::DiscMute, 
+              NULL, 0, RDM_ROOT_DEVICE );
+}
+
+void RDM_Controller::checkAnswered ( void )
+{
+    RDM_Message *msg = getResponse ();
+    Device      &dev = m_devices[m_checkNext];
+
+    if ( msg && msg->portId == rdm::ResponseTypeAck )
+    {
+        dev.missed = 0;
+        m_checkNext++;
+    }
+    else if ( ++dev.missed >= MissedLimit )
+    {
+        // Next device moves into its place
+        removeDevice ( m_checkNext );
+    }
+    else
+    {
+        m_checkNext++;
+    }
+
+    m_discState = DiscIdle;
+    m_sweepAt   = m_port->usart.micros ();
+}
+
+//
+// Decode a response as send by RDM_Responder::repondDiscUniqueBranch,
+// up to 7 preamble bytes (0xfe) and a separator (0xaa) followed by the
+// UID and checksum with every byte send twice, or'ed with 0xaa and 0x55
+//
+bool RDM_Controller::decodeDiscovery ( RDM_Uid &uid )
+{
+    const uint8_t   *e = m_disc;
+    const uint8_t   *end = m_disc + m_discLen;
+    uint16_t        sum = 0;
+
+    if ( m_discCollision )
+        return false;
+
+    while ( e < end && e - m_disc < 7 && *e == 0xfe )
+        e++;
+
+    if ( e == end || *e++ != 0xaa || end - e < 16 )
+        return false;
+
+    for ( uint8_t i = 0; i < 16; i += 2 )
+    {
+        // Collisions leave bits low which are always set
+        if ( ( e[i] & 0xaa ) != 0xaa || ( e[i + 1] & 0x55 ) != 0x55 )
+            return false;
+    }
+
+    for ( uint8_t i = 0; i < 12; i++ )
+        sum += e[i];
+
+    for ( uint8_t i = 0; i < 6; i++ )
+        uid.m_id[i] = e[2 * i] & e[2 * i + 1];
+
+    return sum == ( ( ( e[12] & e[13] ) << 8 ) | ( e[14] & e[15] ) );
+}
+
+bool RDM_Controller::findDevice ( const RDM_Uid &uid, uint16_t &index )
+{
+    uint16_t lo = 0;
+    uint16_t hi = m_nrDevices;
+
+    while ( lo < hi )
+    {
+        uint16_t mid = ( lo + hi ) / 2;
+
+        if ( m_devices[mid].uid < uid )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    index = lo;
+
+    return lo < m_nrDevices && m_devices[lo].uid == uid;
+}
+
+void RDM_Controller::addDevice ( const RDM_Uid &uid )
+{
+    uint16_t index;
+
+    if ( m_nrDevices == m_maxDevices )
+    {
+        Device *devices = (Device *)realloc ( (void *)m_devices, 
+                                              ( m_maxDevices + 8 ) * sizeof ( Device ) );
+
+        // It stays muted, the rest of the line is still discovered
+        if ( !devices )
+        {
+            m_stats.dropped++;
+            return;
+        }
+
+        m_devices       = devices;
+        m_maxDevices   += 8;
+    }
+
+    findDevice ( uid, index );
+
+    memmove ( (void *)&m_devices[index + 1], (void *)&m_devices[index], 
+              ( m_nrDevices - index ) * sizeof ( Device ) );
+
+    m_devices[index].uid.copy ( uid );
+    m_devices[index].missed = 0;
+    m_nrDevices++;
+
+    // Keep checking the same device next
+    if ( index < m_checkNext )
+        m_checkNext++;
+
+    if ( event_onDeviceFound )
+        event_onDeviceFound ( uid );
+}
+
+void RDM_Controller::removeDevice ( uint16_t index )
+{
+    RDM_Uid uid;
+
+    uid.copy ( m_devices[index].uid );
+
+    m_nrDevices--;
+    memmove ( (void *)&m_devices[index], (void *)&m_devices[index + 1], 
+              ( m_nrDevices - index ) * sizeof ( Device ) );
+
+    if ( index < m_checkNext )
+        m_checkNext--;
+
+    if ( event_onDeviceLost )
+        event_onDeviceLost ( uid );
+}
+
+//
+// Poll plan
+//
+uint16_t RDM_Controller::addPoll ( const RDM_Uid &uid, uint16_t pid, uint16_t interval_ms,
+                                   uint8_t priority, const uint8_t *pd, uint8_t pdl, 
+                                   uint16_t subDevice )
+{
+    uint16_t i;
+
+    if ( pdl > PollDataSize )
+        return 0;
+
+    // Numbers of removed polls are reused
+    for ( i = 0; i < m_nrPolls && m_polls[i].state != PollFree; i++ );
+
+    if ( i == m_nrPolls )
+    {
+        Poll *polls = (Poll *)realloc ( (void *)m_polls, ( m_nrPolls + 8 ) * sizeof ( Poll ) );
+
+        if ( !polls )
+            return 0;
+
+        m_polls     = polls;
+        m_nrPolls  += 8;
+
+        for ( uint16_t j = i; j < m_nrPolls; j++ )
+            m_polls[j].state = PollFree;
+    }
+
+    Poll &p = m_polls[i];
+
+    p.uid.copy ( uid );
+    p.pid           = pid;
+    p.subDevice     = subDevice;
+    p.pdl           = pdl;
+    p.priority      = priority;
+    p.retries       = 0;
+    p.interval      = interval_ms;
+    p.dueAt         = m_port ? m_port->usart.micros () : 0;
+    p.respondedAt   = p.dueAt;
+
+    if ( pdl )
+        memcpy ( (void *)p.pd, (void *)pd, pdl );
+
+    // Due right away
+    p.state         = PollWait;
+
+    return i + 1;
+}
+
+void RDM_Controller::removePoll ( uint16_t poll )
+{
+    if ( !poll || poll > m_nrPolls )
+        return;
+
+    m_polls[poll - 1].state = PollFree;
+
+    // A response in flight is dropped
+    if ( m_pollActive == poll )
+        m_pollActive = 0;
+}
+
+uint32_t RDM_Controller::getPollAge ( uint16_t poll )
+{
+    if ( !poll || poll > m_nrPolls || !m_port )
+        return 0;
+
+    return ( m_port->usart.micros () - m_polls[poll - 1].respondedAt ) / 1000;
+}
+
+void RDM_Controller::onPollResponse ( void (*func)(uint16_t, const RDM_Message *) )
+{
+    event_onPollResponse = func;
+}
+
+const RDM_PollStats &RDM_Controller::getPollStats ( void )
+{
+    countPollTime ();
+    return m_pollStats;
+}
+
+void RDM_Controller::resetPollStats ( void )
+{
+    memset ( (void *)&m_pollStats, 0x0, sizeof ( m_pollStats ) );
+
+    if ( m_port )
+        m_pollStatsAt = m_port->usart.micros ();
+}
+
+uint16_t RDM_Controller::getPollRate ( void )
+{
+    countPollTime ();
+
+    if ( !m_pollStats.elapsed )
+        return 0;
+
+    return (uint64_t)m_pollStats.requests * 1000 / m_pollStats.elapsed;
+}
+
+//
+// Whole ms are moved into elapsed, called often enough to keep up
+// with the wrap of the µs clock
+//
+void RDM_Controller::countPollTime ( void )
+{
+    if ( !m_port )
+        return;
+
+    uint32_t ms = ( m_port->usart.micros () - m_pollStatsAt ) / 1000;
+
+    m_pollStats.elapsed += ms;
+    m_pollStatsAt       += ms * 1000;
+}
+
+//
+// The response of sendRequest is kept until it is read, applications
+// which do not read it hold the line for RDM_RESPONSE_HOLD_MS
+//
+bool RDM_Controller::holdResponse ( void )
+{
+    if ( m_userState == UserBusy )
+    {
+        m_userState = UserHeld;
+        m_heldAt    = m_port->usart.micros ();
+    }
+
+    if ( m_userState != UserIdle &&
+         m_port->usart.micros () - m_heldAt >= RDM_RESPONSE_HOLD_MS * 1000UL )
+        m_userState = UserIdle;
+
+    return m_userState != UserIdle;
+}
+
+//
+// A request refused because of a poll gets the line after it, the
+// plan waits for the next attempt (at most RDM_RESPONSE_HOLD_MS)
+//
+void RDM_Controller::deferPolls ( void )
+{
+    if ( m_pollActive && m_userState == UserIdle )
+    {
+        m_userState = UserWaiting;
+        m_heldAt    = m_port->usart.micros ();
+    }
+}
+
+//
+// Request the poll which is due, highest priority first and the one
+// waiting the longest among equals
+//
+void RDM_Controller::sendPoll ( void )
+{
+    uint32_t    now     = m_port->usart.micros ();
+    uint32_t    late    = 0;
+    Poll        *best   = NULL;
+
+    for ( uint16_t i = 0; i < m_nrPolls; i++ )
+    {
+        Poll &p = m_polls[i];
+
+        if ( p.state == PollFree || (int32_t)( now - p.dueAt ) < 0 )
+            continue;
+
+        if ( !best || p.priority > best->priority ||
+             ( p.priority == best->priority && now - p.dueAt > late ) )
+        {
+            best    = &p;
+            late    = now - p.dueAt;
+        }
+    }
+
+    if ( !best )
+        return;
+
+    countPollTime ();
+
+    m_pollActive = best - m_polls + 1;
+    m_pollStats.requests++;
+
+    if ( best->retries )
+        m_pollStats.retries++;
+
+    if ( best->state == PollQueued )
+    {
+        // Nothing queued is answered with the status messages, errors
+        // only keeps that short
+        uint8_t type = rdm::StatusError;
+
+        request ( best->uid, rdm::GetCommand, rdm::QueuedMessage, &type, 1, RDM_ROOT_DEVICE );
+    }
+    else
+    {
+        request ( best->uid, rdm::GetCommand, best->pid, best->pd, best->pdl, best->subDevice );
+    }
+}
+
+void RDM_Controller::pollAnswered ( void )
+{
+    uint16_t    poll    = m_pollActive;
+    Poll        &p      = m_polls[poll - 1];
+    RDM_Message *msg    = getResponse ();
+    uint32_t    now     = m_port->usart.micros ();
+
+    m_pollActive = 0;
+
+    if ( !msg )
+    {
+        m_pollStats.timeouts++;
+
+        // Retried right away, the next attempt follows the interval
+        if ( ++p.retries <= PollRetries )
+        {
+            p.dueAt = now;
+        }
+        else
+        {
+            m_pollStats.failures++;
+            pollDone ( poll, NULL, now );
+        }
+        return;
+    }
+
+    if ( msg->portId == rdm::ResponseTypeAckTimer )
+    {
+        uint16_t estimate = msg->PDL >= sizeof ( RDM_AckTimerPD ) ?
+                            msg->view<RDM_AckTimerPD> ().estimate : 0;
+
+        if ( estimate > PollMaxEstimate )
+            estimate = PollMaxEstimate;
+
+        // Fetched with QUEUED_MESSAGE once the estimate (100ms) passed
+        m_pollStats.ackTimers++;
+        p.state     = PollQueued;
+        p.retries   = 0;
+        p.dueAt     = now + estimate * 100000UL;
+        return;
+    }
+
+    if ( msg->portId == rdm::ResponseTypeNackReason )
+    {
+        m_pollStats.nacks++;
+        pollDone ( poll, msg, now );
+        return;
+    }
+
+    uint16_t pid = msg->PID;
+    uint16_t sub = msg->subDevice;
+
+    if ( p.state == PollQueued && ( pid != p.pid || sub != p.subDevice ) )
+    {
+        Poll *other = findQueued ( p.uid, pid, sub );
+
+        if ( other )
+        {
+            // Response of another poll of the responder, ours is next
+            p.dueAt = now;
+            m_pollStats.acks++;
+            pollDone ( other - m_polls + 1, msg, now );
+        }
+        else if ( ++p.retries <= PollRetries )
+        {
+            // Not queued yet, asked again after a while
+            p.dueAt = now + 100000UL;
+        }
+        else
+        {
+            m_pollStats.failures++;
+            pollDone ( poll, NULL, now );
+        }
+        return;
+    }
+
+    m_pollStats.acks++;
+
+    if ( msg->portId == rdm::ResponseTypeAckOverflow )
+    {
+        // The same request collects the rest of the data
+        p.retries       = 0;
+        p.dueAt         = now;
+        p.respondedAt   = now;
+
+        if ( event_onPollResponse )
+            event_onPollResponse ( poll, msg );
+        return;
+    }
+
+    pollDone ( poll, msg, now );
+}
+
+void RDM_Controller::pollDone ( uint16_t poll, const RDM_Message *msg, uint32_t now )
+{
+    Poll &p = m_polls[poll - 1];
+
+    p.state     = PollWait;
+    p.retries   = 0;
+    p.dueAt     = now + p.interval * 1000UL;
+
+    if ( msg )
+        p.respondedAt = now;
+
+    // May add or remove polls
+    if ( event_onPollResponse )
+        event_onPollResponse ( poll, msg );
+}
+
+RDM_Controller::Poll *RDM_Controller::findQueued ( const RDM_Uid &uid, uint16_t pid, 
+                                                   uint16_t subDevice )
+{
+    for ( uint16_t i = 0; i < m_nrPolls; i++ )
+    {
+        Poll &p = m_polls[i];
+
+        if ( p.state == PollQueued && p.pid == pid && p.subDevice == subDevice && 
+             p.uid == uid )
+            return &p;
+    }
+
+    return NULL;
+}
+
+
+void DMX_Port::setMode ( isr::isrMode mode )
+{
+    uint8_t readEnable = LOW;
+
+    usart.begin ();
+
+    switch ( mode )
+    {
+        case isr::Disabled:
+            #if defined(USE_DMX_BREAK_TIMER)
+            usart.stopTimer ();
+            #endif
+            usart.setMode ( usart::Disabled );
+            readEnable = LOW;
+            break;
+
+        case isr::Receive:
+            usart.setRate ( usart::DataRate );
+
+            // Prepare before kicking off ISR
+	        rxState         = isr::Idle;
+            readEnable      = LOW; 
+            usart.setMode ( usart::Receive );
+            break;
+
+        case isr::DMXTransmit:
+            usart.write ( 0x0 );
+            readEnable      = HIGH;
+
+            // The first frame starts with the break of the mode as well
+            if ( master && master->timedBreakEnabled () )
+                txState     = isr::DmxBreakTimed;
+            else
+                txState     = isr::DmxBreak;
+            usart.setMode ( usart::Transmit );
+            break;
+
+        case isr::DMXTransmitManual:
+            usart.setRate ( usart::DataRate );
+            usart.setMode ( usart::Disabled );
+            readEnable      = HIGH;
+            txState         = isr::DmxBreakManual;
+            txFlush         = false;
+            break;
+
+        case isr::RDMTransmit:
+            usart.setRate ( usart::BreakRate );
+            readEnable      = HIGH;
+            txState         = isr::RdmStartByte; 
+            usart.setMode ( usart::Transmit );
+            usart.write ( 0x0 );
+            break;
+
+        case isr::RDMTransmitNoInt:
+            usart.setRate ( usart::DataRate );
+            readEnable      = HIGH;
+            usart.setMode ( usart::TransmitPolled );
+            break;
+
+        case isr::RDMDiscTransmit:
+            usart.setRate ( usart::DataRate );
+            readEnable      = HIGH;
+            txState         = isr::RdmDiscData;
+            usart.setMode ( usart::Transmit );
+            usart.write ( *txPtr++ );
+            break;
+    }
+
+    usart.setReadEnable ( readEnable );
+}
+
+//
+// Take the next frame from the master, invoked at the break so the
+// slots can be put on the line without further lookups
+//
+void DMX_Port::prepareFrame ( void )
+{
+    uint32_t now = usart.micros ();
+
+    // Swap in committed changes, frame size is sampled once
+    // per frame, the buffer may be resized between frames
+    master->frameStarted ( now );
+
+    if ( controller )
+        controller->frameStarted ( now );
+
+    DMX_FrameBuffer &buffer = master->getTransmitBuffer ();
+    uint16_t        size    = buffer.getBufferSize ();
+
+    txPtr       = buffer.getData ();
+    txEnd       = txPtr + size;
+    txPadding   = master->getFrameSize () - size;
+    txBuffered  = ( master->getTransmitMode () == dmx::dmxDataRegisterEmpty );
+
+    if ( master->timedBreakEnabled () )
+        txNextBreak = isr::DmxBreakTimed;
+    else if ( master->autoBreakEnabled () )
+        txNextBreak = isr::DmxBreak;
+    else
+        txNextBreak = isr::DmxBreakManual;
+}
+
+//
+// Last slot of the frame is written
+//
+void DMX_Port::frameComplete ( void )
+{
+    // Wait for the last slot to leave the shift register
+    if ( txBuffered )
+        usart.setMode ( usart::Transmit );
+
+    // The request of the controller goes out in the gap
+    if ( controller && controller->requestReady () && 
+         controller->requestFits ( usart.micros (), false ) )
+        txState = isr::RdmRequestBreak;
+    else if ( txNextBreak == isr::DmxBreakManual )
+    {
+        setMode ( isr::DMXTransmitManual );
+        txFlush = true;
+    }
+    else
+        txState = txNextBreak;
+}
+
+//
+// TX complete (DMX Transmission ISR)
+//
+void DMX_Port::transmitComplete ( void )
+{
+    uint8_t                 val;
+    bool                    done;
+
+	switch ( txState )
+	{
+	case isr::DmxBreak:
+        usart.setRate ( usart::BreakRate );
+        usart.write ( 0x0 );
+        
+        // Set up the next frame while the break is on the line
+        prepareFrame ();
+        txState = isr::DmxStartByte;
+        break;
+
+	case isr::DmxStartByte:
+        usart.setRate ( usart::DataRate );
+        usart.write ( *txPtr++ );
+        txState = isr::DmxTransmitData;
+
+        // Keep the shift register fed from the data register empty
+        // interrupt, the TX complete interrupt is only used again
+        // after the last slot
+        if ( txBuffered )
+            usart.setMode ( usart::TransmitBuffered );
+		break;
+	
+
+	case isr::DmxTransmitData:
+        // NOTE: only the configured number of slots is send, a full frame
+        // of 513 bytes brings us close to 44 frames / sec, 24 channels
+        // run at ~800 frames / sec
+        #ifdef DMX_IBG
+            usart.delay_us (DMX_IBG);
+        #endif
+
+        usart.write ( *txPtr++ );
+
+        if ( txPtr == txEnd )
+        {
+            if ( txPadding )
+                txState = isr::DmxTransmitPadding;
+            else
+                frameComplete ();
+        }
+		break;
+
+    case isr::DmxTransmitPadding:
+        usart.write ( 0x0 );
+
+        if ( --txPadding == 0 )
+            frameComplete ();
+        break;
+
+#if defined(USE_DMX_BREAK_TIMER)
+    case isr::DmxBreakTimed:
+        // Last slot has left the shift register, hold the
+        // line low and let the timer end the break
+        usart.beginBreak ();
+        usart.startTimer ( master->getBreakLength () );
+        txState = isr::DmxTimerBreak;
+
+        prepareFrame ();
+        break;
+#endif
+
+    case isr::RdmStartByte:
+        usart.setRate ( usart::DataRate );
+
+        // Write start byte
+        rdmSource->fetchOutgoing ( &val, true );
+        usart.write ( val );
+        txState = isr::RdmTransmitData;
+
+        break;
+
+    case isr::RdmTransmitData:
+        // Write rest of data
+        done = rdmSource->fetchOutgoing ( &val );
+        usart.write ( val );
+
+        if ( done )
+            txState = isr::RdmTransmitEnd;
+        break;
+
+    case isr::RdmDiscData:
+        usart.write ( *txPtr++ );
+
+        if ( txPtr == txEnd )
+            txState = isr::RdmTransmitEnd;
+        break;
+
+    case isr::RdmTransmitEnd:
+        // Last byte has left the shift register
+        if ( controller && rdmSource == controller )
+        {
+            requestSent ();
+            break;
+        }
+
+        setMode ( isr::Receive );    // Start waitin for new data
+        txState = isr::Idle;      // No tx state
+        break;
+
+    case isr::RdmRequestBreak:
+        // Last slot of the frame has left the shift register
+        startRequest ();
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+
+//
+// Break timer expired (DMX Transmission break / MAB)
+//
+void DMX_Port::timer ( void )
+{
+#if defined(USE_DMX_BREAK_TIMER)
+    switch ( txState )
+    {
+    case isr::DmxTimerBreak:
+        usart.endBreak ();
+        usart.startTimer ( master->getMabLength () );
+        txState = isr::DmxTimerMab;
+        break;
+
+    case isr::DmxTimerMab:
+        // Line is ready, transmit the start byte directly
+        usart.setMode ( usart::Transmit );
+        txState = isr::DmxStartByte;
+        transmitComplete ();
+        break;
+
+    case isr::RdmTurnaround:
+        setMode ( isr::RDMTransmit );
+        break;
+
+    case isr::RdmDiscTurnaround:
+        setMode ( isr::RDMDiscTransmit );
+        break;
+
+    case isr::RdmResponseWait:
+        requestDone ( controller->windowSpacing () );
+        break;
+
+    case isr::RdmRequestSpacing:
+        resumeTransmit ();
+        break;
+
+    default:
+        break;
+    }
+#endif
+}
+
+bool DMX_Port::respond ( uint32_t requestEnd, const uint8_t *discovery, uint8_t len )
+{
+    uint32_t    elapsed = usart.micros () - requestEnd;
+    uint16_t    wait    = 0;
+
+    // Too late (deferred responder), stay on receive
+    if ( elapsed > MAX_RESPONDER_PACKET_SPACING_USEC )
+        return false;
+
+    if ( elapsed < MIN_RESPONDER_PACKET_SPACING_USEC )
+        wait = MIN_RESPONDER_PACKET_SPACING_USEC - elapsed;
+
+    if ( discovery )
+    {
+        txPtr = discovery;
+        txEnd = discovery + len;
+    }
+
+    rdmSource = responder;
+
+#if defined(USE_DMX_BREAK_TIMER)
+    if ( wait && usart.hasTimer () )
+    {
+        // Nothing is received until the response is out
+        usart.setMode ( usart::Disabled );
+        txState = discovery ? isr::RdmDiscTurnaround : isr::RdmTurnaround;
+        usart.startTimer ( wait );
+        return true;
+    }
+#endif
+
+    // Only wait for what is left of the turnaround
+    if ( wait )
+        usart.delay_us ( wait );
+
+    setMode ( discovery ? isr::RDMDiscTransmit : isr::RDMTransmit );
+
+    return true;
+}
+
+void DMX_Port::startRequest ( void )
+{
+    controller->requestStarted ();
+    rdmSource = controller;
+
+    setMode ( isr::RDMTransmit );
+}
+
+void DMX_Port::requestSent ( void )
+{
+    uint16_t window;
+
+    if ( controller->requestSent ( window ) )
+    {
+        setMode ( isr::Receive );
+        rxState = isr::RdmResponse;
+    }
+    else
+    {
+        setMode ( isr::Disabled );
+    }
+
+    txState = isr::RdmResponseWait;
+
+#if defined(USE_DMX_BREAK_TIMER)
+    // Without a timer the controller checks the window from service()
+    if ( usart.hasTimer () )
+        usart.startTimer ( window );
+#endif
+}
+
+void DMX_Port::requestDone ( uint16_t spacing )
+{
+#if defined(USE_DMX_BREAK_TIMER)
+    usart.stopTimer ();
+#endif
+
+    rxState = isr::Idle;
+    controller->requestDone ();
+
+#if defined(USE_DMX_BREAK_TIMER)
+    if ( spacing && usart.hasTimer () )
+    {
+        usart.setMode ( usart::Disabled );
+        txState = isr::RdmRequestSpacing;
+        usart.startTimer ( spacing );
+        return;
+    }
+#endif
+
+    if ( spacing )
+        usart.delay_us ( spacing );
+
+    resumeTransmit ();
+}
+
+void DMX_Port::resumeTransmit ( void )
+{
+    // Next request follows in the same gap when the frame rate allows
+    if ( controller->requestReady () && master &&
+         controller->requestFits ( usart.micros (), true ) )
+    {
+        startRequest ();
+        return;
+    }
+
+    if ( !master )
+    {
+        setMode ( isr::Disabled );
+        txState = isr::Idle;
+    }
+    else if ( txNextBreak == isr::DmxBreakManual )
+    {
+        setMode ( isr::DMXTransmitManual );
+    }
+    else
+    {
+        // Straight into the break of the next frame, the same kind
+        // of break frameComplete would have chosen
+        usart.setMode ( usart::Transmit );
+        usart.setReadEnable ( HIGH );
+        txState = txNextBreak;
+        transmitComplete ();
+    }
+}
+
+//
+// RX complete (DMX Reception ISR)
+//
+void DMX_Port::receive ( uint8_t usart_data, bool framingError )
+{
+    //
+    // A framing error most likely* indicates a break in our ocasion
+    //
+    if ( monitor )
+        monitor->processIncoming ( usart_data, framingError );
+
+    // Response to a request of the controller
+    if ( rxState == isr::RdmResponse )
+    {
+        if ( controller->processResponse ( usart_data, framingError ) )
+            requestDone ( RDM_CONTROLLER_SPACING_USEC );
+        return;
+    }
+
+    if ( framingError )
+	{
+        // Frames shorter than the started footprints end here
+        if ( rxState == isr::DmxRecordData )
+            for ( DMX_Slave *s = rxFirst; s != rxNext; s = s->getNextSlave () )
+                s->processBreak ();
+
+        rxState = isr::Break;
+        return;
+    }
+    
+    switch ( rxState )
+    {
+        case isr::Break:
+            if ( slave && usart_data == DMX_START_CODE )
+            {
+                for ( DMX_Slave *s = slave; s; s = s->getNextSlave () )
+                    s->processIncoming ( usart_data, true );
+
+                rxSlot  = 0;
+                rxFirst = slave;
+                rxNext  = slave;
+                rxState = isr::DmxRecordData;
+            }
+            else if ( responder && 
+                      usart_data == RDM_START_CODE && 
+                      responder->m_rdmStatus.enabled &&
+                      !responder->requestPending () )
+            {
+                // responder->clear ();
+                responder->processIncoming ( usart_data, true );
+                rxState = isr::RdmRecordData;
+            }
+            else
+            {
+                rxState = isr::Idle;
+            }
+            break;
+
+        // Process DMX Data
+        case isr::DmxRecordData:
+            rxSlot++;
+
+            // Footprints are sorted by start address, with footprints
+            // that do not overlap at most one of them is receiving
+            while ( rxNext && rxNext->getStartAddress () <= rxSlot )
+                rxNext = rxNext->getNextSlave ();
+
+            for ( DMX_Slave *s = rxFirst; s != rxNext; s = s->getNextSlave () )
+            {
+                // Filled footprints at the front are done for this frame
+                if ( s->processIncoming ( usart_data ) && s == rxFirst )
+                    rxFirst = s->getNextSlave ();
+            }
+
+            if ( !rxFirst )
+               rxState = isr::Idle;
+            break;
+
+        // Process RDM Data
+        case isr::RdmRecordData:
+            if ( responder->processIncoming ( usart_data ) )
+                rxState = isr::Idle;
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void DMX_Port::service ( void )
+{
+    DMX_Event event;
+
+    while ( events.pop ( event ) )
+    {
+        switch ( event.type )
+        {
+            case dmx::dmxEventFrame:
+                event.slave->frameServiced ( event.channels );
+                break;
+
+            case dmx::dmxEventRdmRequest:
+                if ( responder )
+                    responder->processRequest ();
+                break;
+        }
+    }
+
+    if ( responder )
+    {
+        responder->sampleSensors ();
+
+        if ( responder->getConfigStore () )
+            responder->getConfigStore ()->service ();
+    }
+}
+
+
+RDM_Message *DMX_Port::getRdmMessage ( void )
+{
+    if ( !rdmMsg )
+    {
+        rdmMsg = (RDM_Message *) malloc ( sizeof ( RDM_Message ) );
+        
+        if ( rdmMsg )
+            memset ( (void *)rdmMsg, 0x0, sizeof ( RDM_Message ) );
+    }
+
+    return rdmMsg;
+}
+
+
+//
+// Interrupt entry points, dispatched to the state of the port
+//
+void DMX_OnTransmitComplete ( uint8_t port )
+{
+    DMX_GetPort ( port )->transmitComplete ();
+}
+
+void DMX_OnReceive ( uint8_t port, uint8_t data, bool framingError )
+{
+    DMX_GetPort ( port )->receive ( data, framingError );
+}
+
+void DMX_OnTimer ( uint8_t port )
+{
+    DMX_GetPort ( port )->timer ();
+}
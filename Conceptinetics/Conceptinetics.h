@@ -1,379 +1,1538 @@
-/*
-  Conceptinetics.h - DMX library for Arduino
-  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
-
-  This library is free software; you can redistribute it and/or
-  modify it under the terms of the GNU Lesser General Public
-  License as published by the Free Software Foundation; either
-  version 3 of the License, or (at your option) any later version.
-
-  This library is distributed in the hope that it will be useful,
-  but WITHOUT ANY WARRANTY; without even the implied warranty of
-  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
-  Lesser General Public License for more details.
-
-  You should have received a copy of the GNU Lesser General Public
-  License along with this library; if not, write to the Free Software
-  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
-*/
-
-/*
-  This code has been tested using the following hardware:
-
-  - Arduino UNO R3 using a CTC-DRA-13-1 ISOLATED DMX-RDM SHIELD 
-  - Arduino MEGA2560 R3 using a CTC-DRA-13-1 ISOLATED DMX-RDM SHIELD 
-
-  - CTC-DRA-10-1 is the non-isolated cost-effective DMX-RDM shield
-*/
-
-
-#ifndef CONCEPTINETICS_H_
-#define CONCEPTINETICS_H_
-
-#include <Arduino.h>
-#include <inttypes.h>
-
-#include "Rdm_Uid.h"
-#include "Rdm_Defines.h"
-
-#define DMX_MAX_FRAMESIZE       513     // Startbyte + 512 Slots
-#define DMX_MIN_FRAMESIZE       2       // Startbyte + 1 Slot
-
-#define DMX_MAX_FRAMECHANNELS   512     // maximum number of channels per frame
-
-#define DMX_STARTCODE_SIZE      1       // Size of startcode in bytes
-
-#define DMX_START_CODE          0x0     // Start code for a DMX frame
-#define RDM_START_CODE          0xcc    // Start code for a RDM frame
-
-// Uncomment to enable Inter slot delay ) (avg < 76uSec) ... 
-// minimum is zero according to specification
-// #define DMX_IBG				    10      // Inter slot time
-
-// Speed your Arduino is running on in Hz.
-#define F_OSC 				    16000000UL
-
-// DMX baud rate, this should be 250000
-#define DMX_BAUD_RATE 		    250000
-
-// The baud rate used to automatically generate a break within
-// your ISR.. make it lower to generate longer breaks
-#define DMX_BREAK_RATE 	 	    99900       
-
-// Table 3-2 ANSI_E1-20-2010
-// Minimum time to allow the datalink to 'turn around'
-#define MIN_RESPONDER_PACKET_SPACING_USEC   170 /*176*/
-
-#if !defined(USE_DMX_SERIAL_0) && !defined(USE_DMX_SERIAL_1) && !defined(USE_DMX_SERIAL_2) && !defined(USE_DMX_SERIAL_3)
-    // Define which serial port to use as DMX port, only one can be 
-    // selected at the time by uncommenting one of the following
-    // lines
-    #define USE_DMX_SERIAL_0
-    //#define USE_DMX_SERIAL_1
-    //#define USE_DMX_SERIAL_2
-    //#define USE_DMX_SERIAL_3
-#endif
-
-namespace dmx 
-{
-    enum dmxState 
-	{
-        dmxUnknown,
-        dmxStartByte,
-        dmxWaitStartAddress,
-        dmxData,
-        dmxFrameReady,
-	};
-};
-
-namespace rdm
-{
-    enum rdmState
-    {
-        rdmUnknown,
-        rdmStartByte,
-        rdmSubStartCode,
-        rdmMessageLength,
-        rdmData,
-        rdmChecksumHigh,
-        rdmChecksumLow,
-        rdmFrameReady,
-    };
-};
-
-struct IFrameBuffer
-{
-    virtual uint16_t    getBufferSize   ( void ) = 0;        
-
-    virtual uint8_t     getSlotValue    ( uint16_t index ) = 0;
-    virtual void        setSlotValue    ( uint16_t index, uint8_t value ) = 0;
-};
-
-class DMX_FrameBuffer : IFrameBuffer
-{
-    public:
-        //
-        // Constructor buffersize = 1-513
-        //
-        DMX_FrameBuffer     ( uint16_t buffer_size );
-        DMX_FrameBuffer     ( DMX_FrameBuffer &buffer );
-        ~DMX_FrameBuffer    ( void );
-
-        uint16_t getBufferSize ( void );        
-
-        uint8_t getSlotValue ( uint16_t index );
-        void    setSlotValue ( uint16_t index, uint8_t value );
-        void    setSlotRange ( uint16_t start, uint16_t end, uint8_t value );
-        void    clear ( void );        
-
-        uint8_t &operator[] ( uint16_t index );
-
-    private:
-
-        uint8_t     *m_refcount;
-        uint16_t    m_bufferSize;
-        uint8_t     *m_buffer;      
-};
-
-
-//
-// DMX Master controller
-//
-class DMX_Master
-{
-    public:
-        // Run the DMX master from a pre allocated frame buffer which
-        // you have fully under your own control
-        DMX_Master ( DMX_FrameBuffer &buffer, int readEnablePin  );
-        
-        // Run the DMX master by giving a predefined maximum number of
-        // channels to support
-        DMX_Master ( uint16_t maxChannel, int readEnablePin );
-
-        ~DMX_Master ( void );
-    
-        void enable  ( void );              // Start transmitting
-        void disable ( void );              // Stop transmitting
-
-        // Get reference to the internal framebuffer
-        DMX_FrameBuffer &getBuffer ( void );
-
-        // Update channel values
-        void setChannelValue ( uint16_t channel, uint8_t value );
-        void setChannelRange ( uint16_t start, uint16_t end, uint8_t value );
-
-    public:
-        //
-        // Manual control over the break period
-        //
-        void setAutoBreakMode ( void );     // Generated from ISR
-        void setManualBreakMode ( void );   // Generate manually
-
-        uint8_t autoBreakEnabled ( void );
-
-        // We are waiting for a manual break to be generated 
-        uint8_t waitingBreak ( void );
-        
-        // Generate break and start transmission of frame
-        void breakAndContinue ( uint8_t breakLength_us = 100 );
-
-
-    protected:
-        void setStartCode ( uint8_t value ); 
-
-
-    private:
-        DMX_FrameBuffer m_frameBuffer;
-        uint8_t         m_autoBreak;
-};
-
-
-//
-// DMX Slave controller
-//
-class DMX_Slave : public DMX_FrameBuffer
-{
-    public:
-        DMX_Slave ( DMX_FrameBuffer &buffer, int readEnablePin = -1 );
-
-        // nrChannels is the consecutive DMX512 slots required
-        // to operate this slave device
-        DMX_Slave ( uint16_t nrChannels, int readEnablePin = -1 );
-
-        ~DMX_Slave ( void );
-
-        void enable     ( void );           // Enable receiver
-        void disable    ( void );           // Disable receiver
-
- 
-        // Get reference to the internal framebuffer
-        DMX_FrameBuffer &getBuffer ( void );
-
-        uint8_t  getChannelValue ( uint16_t channel );
-
-        uint16_t getStartAddress ( void );
-        void     setStartAddress ( uint16_t );
-
-
-        // Process incoming byte from USART
-        bool processIncoming   ( uint8_t val, bool first = false );
-
-        // Register on receive complete callback in case
-        // of time critical applications
-        void onReceiveComplete ( void (*func)(unsigned short) );
-
-    protected:
-
-
-    private:
-        uint16_t        m_startAddress;     // Slave start address
-        dmx::dmxState   m_state;
-
-        static void (*event_onFrameReceived)(unsigned short channelsReceived);
-};
-
-
-class RDM_FrameBuffer : public IFrameBuffer
-{
-    public:
-        //
-        // Constructor
-        //
-        RDM_FrameBuffer     ( void ) {};
-        ~RDM_FrameBuffer    ( void ) {};
-
-        uint16_t getBufferSize ( void );        
-
-        uint8_t getSlotValue ( uint16_t index );
-        void    setSlotValue ( uint16_t index, uint8_t value );
-        void    clear ( void );        
-
-        uint8_t &operator[] ( uint16_t index );
-
-    public: // functions to provide access from USART       
-        // Process incoming byte from USART, 
-        // returns false when no more data is accepted
-        bool processIncoming ( uint8_t val, bool first = false );
-
-        // Process outgoing byte to USART
-        // returns false when no more data is available
-        bool fetchOutgoing ( volatile uint8_t *udr, bool first = false );
-
-    protected:
-        // Process received frame
-        virtual void processFrame ( void ) = 0;
-
-    //private:
-    protected:
-        rdm::rdmState   m_state;       // State for pushing the message in
-        RDM_Message     m_msg;
-        RDM_Checksum    m_csRecv;      // Checksum received in rdm message
-        RDM_Checksum    m_csCalc;      // Calculared checksum
-};
-
-//
-// RDM_Responder 
-//
-class RDM_Responder : public RDM_FrameBuffer
-{
-    public:
-        //
-        // m        = manufacturer id (16bits)
-        // d1-d4    = device id (32bits)
-        //
-        RDM_Responder   ( uint16_t m, uint8_t d1, uint8_t d2, uint8_t d3, uint8_t d4, DMX_Slave &slave);
-        ~RDM_Responder  ( void );
-
-        void    setDeviceInfo 
-                ( 
-                    uint16_t deviceModelId, 
-                    rdm::RdmProductCategory productCategory,
-                    uint8_t personalities = 1,
-                    uint8_t personality = 1
-                )
-        {
-            m_DeviceModelId         = deviceModelId;
-            m_ProductCategory       = productCategory;
-            m_Personalities         = personalities;
-            m_Personality           = personality;
-        };
-
-        //
-        // Set vendor software version id
-        //
-        // v1 = MOST SIGNIFICANT
-        // v2... 
-        // v3...
-        // v4 = LEAST SIGNIFICANT
-        //
-        void    setSoftwareVersionId ( uint8_t v1, uint8_t v2, uint8_t v3, uint8_t v4 )
-        {
-            m_SoftwareVersionId[0] = v1;
-            m_SoftwareVersionId[1] = v2;
-            m_SoftwareVersionId[2] = v3;
-            m_SoftwareVersionId[3] = v4;
-        }
-
-        // Currently no sensors and subdevices supported
-        // void    AddSensor ( void );
-        // void    AddSubDevice ( void );
-
-        uint8_t getPersonality ( void ) { return m_Personality; };
-        void    setPersonality ( uint8_t personality ) { m_Personality = personality; };
-   
-        // Register on identify device event handler
-        void    onIdentifyDevice ( void (*func)(bool) );
-        void    onDeviceLabelChanged ( void (*func) (const char*, uint8_t) );
-        void    onDMXStartAddressChanged ( void (*func) (uint16_t) );
-        void    onDMXPersonalityChanged ( void (*func) (uint8_t) );
-
-
-        // Set the device label
-        void    setDeviceLabel ( const char *label, size_t len );
-
-        // Enable, Disable rdm responder
-        void enable ( void )    { m_rdmStatus.enabled = true; m_rdmStatus.mute = false; };
-        void disable ( void )   { m_rdmStatus.enabled = false; };
-
-        union
-        {
-            uint8_t  raw;
-            struct
-            {
-                uint8_t mute:1; 
-                uint8_t ident:1;
-                uint8_t enabled:1;  // Rdm responder enable/disable
-            };
-        } m_rdmStatus;
-
-
-    protected:  
-        virtual void processFrame ( void );
-
-        // Discovery to unque brach packets only requires
-        // the data part of the packet to be transmitted
-        // without breaks or header
-        void repondDiscUniqueBranch ( void );
-
-        // Helpers for generating response packets which 
-        // have larger datafields
-        void populateDeviceInfo ( void );
-
-    private:
-        RDM_Uid                     m_devid;            // Holds our unique device ID
-        uint8_t                     m_Personalities;    // The total number of supported personalities
-        uint8_t                     m_Personality;      // The currently active personality
-        uint16_t                    m_DeviceModelId;
-        uint8_t                     m_SoftwareVersionId[4]; // 32 bit Software version
-        rdm::RdmProductCategory     m_ProductCategory;
- 
-        char                        m_deviceLabel[32];  // Device label
-
-        static void (*event_onIdentifyDevice)(bool);
-        static void (*event_onDeviceLabelChanged)(const char*, uint8_t);
-        static void (*event_onDMXStartAddressChanged)(uint16_t);
-        static void (*event_onDMXPersonalityChanged)(uint8_t);
-};
-
-
-#endif /* CONCEPTINETICS_H_ */
+/*
+  Conceptinetics.h - DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  This code has been tested using the following hardware:
+
+  - Arduino UNO R3 using a CTC-DRA-13-1 ISOLATED DMX-RDM SHIELD 
+  - Arduino MEGA2560 R3 using a CTC-DRA-13-1 ISOLATED DMX-RDM SHIELD 
+
+  - CTC-DRA-10-1 is the non-isolated cost-effective DMX-RDM shield
+*/
+
+
+#ifndef CONCEPTINETICS_H_
+#define CONCEPTINETICS_H_
+
+#include "Dmx_Transport.h"
+#include "Dmx_Queue.h"
+#include "Dmx_Eeprom.h"
+
+#if !defined(DMX_SIMULATED_USART)
+#include <Arduino.h>
+#endif
+#include <inttypes.h>
+
+#include "Rdm_Uid.h"
+#include "Rdm_Defines.h"
+
+#define DMX_MAX_FRAMESIZE       513     // Startbyte + 512 Slots
+#define DMX_MIN_FRAMESIZE       2       // Startbyte + 1 Slot
+
+#define DMX_MAX_FRAMECHANNELS   512     // maximum number of channels per frame
+
+#define DMX_STARTCODE_SIZE      1       // Size of startcode in bytes
+
+#define DMX_START_CODE          0x0     // Start code for a DMX frame
+#define RDM_START_CODE          0xcc    // Start code for a RDM frame
+
+// Uncomment to enable Inter slot delay ) (avg < 76uSec) ... 
+// minimum is zero according to specification
+// #define DMX_IBG				    10      // Inter slot time
+
+// Speed your Arduino is running on in Hz.
+#define F_OSC 				    16000000UL
+
+// DMX baud rate, this should be 250000
+#define DMX_BAUD_RATE 		    250000
+
+// The baud rate used to automatically generate a break within
+// your ISR.. make it lower to generate longer breaks. The break is the
+// start bit and 8 data bits of a 0x00 (180 us), the 2 stop bits form
+// the MAB (40 us). This also meets the RDM request break of E1.20
+#define DMX_BREAK_RATE 	 	    50000       
+
+// Uncomment to time breaks and MAB's with hardware timer 1 instead of the
+// baud rate trick (auto break) or busy waiting (manual break), see
+// DMX_Master::setTimedBreakMode. The RDM responder times its turnaround
+// with it as well, without it the turnaround is busy waited (inside the
+// receive interrupt unless the responder is deferred). Always available
+// on the simulated USART
+// NOTE: timer 1 is also used by the Servo library and PWM on pin 9 and 10
+// #define USE_DMX_BREAK_TIMER
+
+// Transmitter break and MAB limits ANSI E1.11 table 6
+#define DMX_MIN_BREAK_USEC                  92
+#define DMX_MIN_MAB_USEC                    12
+#define DMX_DEFAULT_BREAK_USEC              176
+#define DMX_DEFAULT_MAB_USEC                12
+
+#if ( 9 * 1000000UL ) / DMX_BREAK_RATE < DMX_MIN_BREAK_USEC
+    #error "DMX_BREAK_RATE generates breaks shorter than DMX_MIN_BREAK_USEC"
+#endif
+
+// Minimum time between two consecutive breaks ANSI E1.11
+#define DMX_MIN_BREAK_TO_BREAK_USEC         1204
+
+// Time it takes to put a break (incl. MAB) and a single slot on the line
+#define DMX_BREAK_USEC          ((11 * 1000000UL) / DMX_BREAK_RATE)
+#define DMX_SLOT_USEC           ((11 * 1000000UL) / DMX_BAUD_RATE)
+
+// Smallest frame (startbyte included) which still respects the minimum
+// break to break time, short frames are padded up to this size
+#define DMX_MIN_PADDED_FRAMESIZE  \
+    ((DMX_MIN_BREAK_TO_BREAK_USEC - DMX_BREAK_USEC + DMX_SLOT_USEC - 1) / DMX_SLOT_USEC)
+
+// Table 3-2 ANSI_E1-20-2010
+// Minimum time to allow the datalink to 'turn around'
+#define MIN_RESPONDER_PACKET_SPACING_USEC   170 /*176*/
+// The controller has given up on responses later than this
+#define MAX_RESPONDER_PACKET_SPACING_USEC   2000
+
+// Controller packet timing ANSI_E1-20-2010
+#define RDM_RESPONSE_TIMEOUT_USEC           2800    // Response (or its next slot) lost
+#define RDM_DISCOVERY_WINDOW_USEC           5800    // DISC_UNIQUE_BRANCH to next packet
+#define RDM_BROADCAST_SPACING_USEC          176     // Broadcast to next packet
+#define RDM_CONTROLLER_SPACING_USEC         176     // Response to next packet
+#define RDM_LOST_RESPONSE_USEC              3000    // Unanswered request to next packet
+
+// Response of RDM_Controller::sendRequest kept from polls and sweeps
+// when the application does not read it
+#define RDM_RESPONSE_HOLD_MS                100
+
+// Events a port can hold for service() (power of two, max 128)
+#define DMX_EVENT_QUEUE_SIZE                8
+
+#if !defined(USE_DMX_SERIAL_0) && !defined(USE_DMX_SERIAL_1) && !defined(USE_DMX_SERIAL_2) && !defined(USE_DMX_SERIAL_3)
+  #if defined(DMX_SIMULATED_USART)
+    // The simulated wire provides all four ports
+    #define USE_DMX_SERIAL_0
+    #define USE_DMX_SERIAL_1
+    #define USE_DMX_SERIAL_2
+    #define USE_DMX_SERIAL_3
+  #else
+    // Define which serial ports to use as DMX ports, any combination of
+    // the USARTs your board has can be enabled by uncommenting the lines
+    // below (port 1-3 are only available on the MEGA). Every enabled port
+    // claims the interrupt vectors of its USART, the matching Serial
+    // object can not be used anymore
+    #define USE_DMX_SERIAL_0
+    //#define USE_DMX_SERIAL_1
+    //#define USE_DMX_SERIAL_2
+    //#define USE_DMX_SERIAL_3
+  #endif
+#endif
+
+// Port used by objects which are constructed without a port number
+#if defined(USE_DMX_SERIAL_0)
+    #define DMX_DEFAULT_PORT    0
+#elif defined(USE_DMX_SERIAL_1)
+    #define DMX_DEFAULT_PORT    1
+#elif defined(USE_DMX_SERIAL_2)
+    #define DMX_DEFAULT_PORT    2
+#else
+    #define DMX_DEFAULT_PORT    3
+#endif
+
+// Ports are numbered 0-3, this is the highest enabled port + 1
+#if defined(USE_DMX_SERIAL_3)
+    #define DMX_NR_PORTS        4
+#elif defined(USE_DMX_SERIAL_2)
+    #define DMX_NR_PORTS        3
+#elif defined(USE_DMX_SERIAL_1)
+    #define DMX_NR_PORTS        2
+#else
+    #define DMX_NR_PORTS        1
+#endif
+
+namespace dmx 
+{
+    enum dmxState 
+	{
+        dmxUnknown,
+        dmxStartByte,
+        dmxWaitStartAddress,
+        dmxData,
+        dmxFrameReady,
+	};
+
+    enum dmxFramePadding
+    {
+        dmxPadNone,             // Transmit the configured frame size only
+        dmxPadMinimumFrame,     // Pad short frames with zero slots up to
+                                // the minimum break to break time
+    };
+
+    enum dmxSignalLoss
+    {
+        dmxHoldLastLook,        // Keep the last received values
+        dmxFadeToZero,          // Fade the last received values out
+        dmxPresetScene,         // Jump to a preset scene
+    };
+
+    enum dmxSignalState
+    {
+        dmxSignalNone,          // Nothing received since enable
+        dmxSignalPresent,       // Frames arrive within the timeout
+        dmxSignalLost,          // No frame within the timeout
+    };
+
+    enum dmxEventType
+    {
+        dmxEventFrame,          // Slave received a frame
+        dmxEventRdmRequest,     // Responder received a request
+    };
+
+    enum dmxTransmitMode
+    {
+        dmxTransmitComplete,    // One slot per TX complete interrupt
+        dmxDataRegisterEmpty,   // Slots are fed from the data register empty
+                                // interrupt, no gaps between slots
+    };
+};
+
+namespace rdm
+{
+    enum rdmState
+    {
+        rdmUnknown,
+        rdmStartByte,
+        rdmSubStartCode,
+        rdmMessageLength,
+        rdmData,
+        rdmChecksumHigh,
+        rdmChecksumLow,
+        rdmFrameReady,
+    };
+};
+
+namespace isr
+{
+    enum isrState
+    {
+        Idle,
+        Break,
+        DmxBreak,
+        DmxBreakManual,
+        DmxBreakTimed,      /* Waiting for the last slot to leave */
+        DmxTimerBreak,      /* Break timer running */
+        DmxTimerMab,        /* MAB timer running */
+        DmxStartByte,   
+        DmxRecordData,
+        DmxTransmitData,
+        DmxTransmitPadding, /* Zero slots after the buffer */
+        RdmStartByte,
+        RdmRecordData,
+        RdmTransmitData,
+        RdmTransmitEnd,     /* Last byte of a response on the line */
+        RdmTurnaround,      /* Timer running before the response */
+        RdmDiscTurnaround,  /* Timer running before the discovery response */
+        RdmDiscData,        /* Discovery response, no break */
+        RdmRequestBreak,    /* Last slot leaving, RDM request of the controller follows */
+        RdmResponse,        /* Controller receiving a response */
+        RdmResponseWait,    /* Timer running for the response */
+        RdmRequestSpacing,  /* Timer running before the next packet */
+    };
+
+    enum isrMode
+    {
+        Disabled,
+        Receive,
+        DMXTransmit,
+        DMXTransmitManual,  /* Manual break... */
+        RDMTransmit,
+        RDMTransmitNoInt,   /* Setup uart but leave interrupt disabled */
+        RDMDiscTransmit,    /* Discovery response from txPtr / txEnd */
+    };
+};
+
+struct IFrameBuffer
+{
+    // Buffers are polymorphic and deleted by the masters and slaves
+    // which allocated them
+    virtual ~IFrameBuffer ( void ) {};
+
+    virtual uint16_t    getBufferSize   ( void ) = 0;        
+
+    virtual uint8_t     getSlotValue    ( uint16_t index ) = 0;
+    virtual void        setSlotValue    ( uint16_t index, uint8_t value ) = 0;
+};
+
+class DMX_FrameBuffer : IFrameBuffer
+{
+    public:
+        //
+        // Constructor buffersize = 1-513
+        //
+        DMX_FrameBuffer     ( uint16_t buffer_size );
+        DMX_FrameBuffer     ( DMX_FrameBuffer &buffer );
+        ~DMX_FrameBuffer    ( void );
+
+        uint16_t getBufferSize ( void );        
+
+        uint8_t getSlotValue ( uint16_t index );
+        void    setSlotValue ( uint16_t index, uint8_t value );
+        void    setSlotRange ( uint16_t start, uint16_t end, uint8_t value );
+        void    clear ( void );        
+
+        // Copy len values into the buffer starting at index start, values
+        // which do not fit in the buffer are ignored
+        void    setSlots ( uint16_t start, const uint8_t *src, uint16_t len );
+
+        uint8_t &operator[] ( uint16_t index );
+
+        // Direct access to the slots (startbyte first), NULL when the
+        // buffer could not be allocated
+        uint8_t *getData ( void ) { return m_buffer; };
+
+        // Exchange the underlying storage with another buffer
+        void    swap ( DMX_FrameBuffer &buffer );
+
+        //
+        // Dirty tracking, every write through the functions above widens
+        // the dirty range and marks the blocks of 64 slots it touched.
+        // Writes through operator[] are not tracked.
+        //
+        bool     isDirty ( void )       { return m_dirtyMin <= m_dirtyMax; };
+        uint16_t getDirtyMin ( void )   { return m_dirtyMin; };
+        uint16_t getDirtyMax ( void )   { return m_dirtyMax; };
+
+        // Bit n set means slots n*64 ... n*64+63 have been written
+        uint16_t getDirtyBlocks ( void ) { return m_dirtyBlocks; };
+
+        void     clearDirty ( void );
+
+    protected:
+        void     markDirty ( uint16_t first, uint16_t last );
+
+    private:
+
+        uint8_t     *m_refcount;
+        uint16_t    m_bufferSize;
+        uint8_t     *m_buffer;      
+
+        uint16_t    m_dirtyMin;         // First written slot
+        uint16_t    m_dirtyMax;         // Last written slot
+        uint16_t    m_dirtyBlocks;      // Bitmap of written 64 slot blocks
+};
+
+
+class DMX_Master;
+class DMX_Slave;
+class DMX_Monitor;
+class RDM_FrameBuffer;
+class RDM_Responder;
+class RDM_Controller;
+class RDM_ConfigStore;
+
+//
+// Event handed from the interrupt handlers to service()
+//
+struct DMX_Event
+{
+    dmx::dmxEventType   type;
+    DMX_Slave           *slave;             // Slave of dmxEventFrame
+    uint16_t            channels;           // Channels received
+};
+
+//
+// State of a single DMX port (USART), every port has its own interrupt
+// vectors and state machines so masters and slaves on different ports
+// run independently. At most one master or a set of slaves (and a
+// responder) can be active on a port at the time
+//
+struct DMX_Port
+{
+    constexpr DMX_Port ( uint8_t nr )
+    : usart ( nr ), txState ( isr::Idle ), rxState ( isr::Idle ),
+      txPtr ( NULL ), txEnd ( NULL ), txPadding ( 0 ),
+      txBuffered ( false ), txNextBreak ( isr::DmxBreak ), txFlush ( false ),
+      rxSlot ( 0 ), rxFirst ( NULL ), rxNext ( NULL ),
+      master ( NULL ), slave ( NULL ), monitor ( NULL ), responder ( NULL ),
+      controller ( NULL ), rdmSource ( NULL ), events (), rdmMsg ( NULL )
+    {};
+
+    void    setMode ( isr::isrMode mode );
+
+    // Set up the cursors for the next frame of the master, done
+    // while the break is on the line
+    void    prepareFrame ( void );
+    void    frameComplete ( void );
+
+    // Invoked from the USART and timer interrupts of this port
+    void    transmitComplete ( void );
+    void    receive ( uint8_t data, bool framingError );
+    void    timer ( void );
+
+    // Handle the events queued by the interrupts, from loop()
+    void    service ( void );
+
+    // Send the RDM response of the responder, or the discovery
+    // response given, once the turnaround time after the end of the
+    // request (µs) has passed. The break timer times the turnaround
+    // when available, the receiver is off until the response is out.
+    // Responses past the responder window are dropped, they would run
+    // into the next packet of the controller (false)
+    bool    respond ( uint32_t requestEnd, const uint8_t *discovery = NULL, 
+                      uint8_t len = 0 );
+
+    // Put the request of the controller on the line, invoked in the
+    // gap after a DMX frame (or right away without a master)
+    void    startRequest ( void );
+
+    // Request is out, wait for the response (or the broadcast spacing)
+    void    requestSent ( void );
+
+    // Response received (or timed out), DMX continues after spacing µs
+    void    requestDone ( uint16_t spacing );
+
+    // Continue with the next frame of the master after an RDM request,
+    // or with the next request when the minimum frame rate allows
+    void    resumeTransmit ( void );
+
+    // Message buffer shared by the RDM objects of the port, allocated
+    // when first asked for (NULL when out of memory)
+    RDM_Message *getRdmMessage ( void );
+
+    DMX_Transport   usart;
+
+    isr::isrState   txState;                // TX ISR state
+    isr::isrState   rxState;                // RX ISR state
+    const uint8_t   *txPtr;                 // Next slot to transmit
+    const uint8_t   *txEnd;                 // End of the transmit buffer
+    uint16_t        txPadding;              // Zero slots to send after txEnd
+    bool            txBuffered;             // Fed from data register empty
+    isr::isrState   txNextBreak;            // Break state after the frame
+    bool            txFlush;                // Last slots still on the line (manual break)
+
+    uint16_t        rxSlot;                 // Slot number being received
+    DMX_Slave       *rxFirst;               // First footprint still receiving
+    DMX_Slave       *rxNext;                // First footprint not yet started
+
+    DMX_Master      *master;                // Active master
+    DMX_Slave       *slave;                 // Slaves sorted by start address
+    DMX_Monitor     *monitor;               // Sees every byte when enabled
+    RDM_Responder   *responder;
+    RDM_Controller  *controller;
+    RDM_FrameBuffer *rdmSource;             // Message being transmitted
+
+    DMX_Queue<DMX_Event, DMX_EVENT_QUEUE_SIZE> events;
+
+    RDM_Message     *rdmMsg;
+};
+
+// Get a port by number, returns NULL when the port is not enabled
+// (see USE_DMX_SERIAL_0 ... USE_DMX_SERIAL_3). Host builds have more
+// ports on the simulated wire (see DMX_SIM_MAX_PORTS)
+DMX_Port *DMX_GetPort ( uint8_t nr );
+
+
+//
+// DMX Master controller
+//
+class DMX_Master
+{
+    public:
+        // Run the DMX master from a pre allocated frame buffer which
+        // you have fully under your own control
+        DMX_Master ( DMX_FrameBuffer &buffer, int readEnablePin,
+                     uint8_t port = DMX_DEFAULT_PORT );
+        
+        // Run the DMX master by giving a predefined maximum number of
+        // channels to support
+        DMX_Master ( uint16_t maxChannel, int readEnablePin,
+                     uint8_t port = DMX_DEFAULT_PORT );
+
+        ~DMX_Master ( void );
+    
+        void enable  ( void );              // Start transmitting
+        void disable ( void );              // Stop transmitting
+
+        // Get reference to the internal framebuffer
+        DMX_FrameBuffer &getBuffer ( void );
+
+        // Update channel values
+        void setChannelValue ( uint16_t channel, uint8_t value );
+        void setChannelRange ( uint16_t start, uint16_t end, uint8_t value );
+        void setChannels ( uint16_t start, const uint8_t *values, uint16_t len );
+
+    public:
+        //
+        // Manual control over the break period
+        //
+        void setAutoBreakMode ( void );     // Generated from ISR
+        void setManualBreakMode ( void );   // Generate manually
+
+        uint8_t autoBreakEnabled ( void );
+
+        // We are waiting for a manual break to be generated 
+        uint8_t waitingBreak ( void );
+        
+        // Generate break and start transmission of frame, with
+        // USE_DMX_BREAK_TIMER the break runs in the background
+        void breakAndContinue ( uint8_t breakLength_us = 100 );
+
+        // Generate breaks automatically from a hardware timer with the given
+        // break and mark after break lengths, the CPU is free during the
+        // break. Returns false when the lengths violate E1.11 or no break
+        // timer is available (see USE_DMX_BREAK_TIMER)
+        bool setTimedBreakMode ( uint16_t breakLength_us = DMX_DEFAULT_BREAK_USEC,
+                                 uint16_t mabLength_us = DMX_DEFAULT_MAB_USEC );
+
+        uint8_t timedBreakEnabled ( void );
+
+    public:
+        //
+        // Frame length and refresh rate, only the configured number of
+        // channels is transmitted, short frames are padded by default
+        //
+        void setFramePadding ( dmx::dmxFramePadding padding );
+
+        // Achieved number of frames per second (0 when not transmitting)
+        uint16_t getFrameRate ( void );
+
+        // Feed slots from the TX complete (default) or the data register
+        // empty interrupt. The latter keeps the shift register busy and
+        // removes the interrupt latency between slots, takes effect at
+        // the next break
+        void setTransmitMode ( dmx::dmxTransmitMode mode );
+        dmx::dmxTransmitMode getTransmitMode ( void ) { return m_txMode; };
+
+    public:
+        //
+        // Double buffered (tear free) operation, channel updates land in
+        // a back buffer which is swapped in at the first break after
+        // commit(). Only updates made through the master object (not
+        // through a shared DMX_FrameBuffer) are double buffered.
+        //
+        // Enable before starting transmission, returns false when the
+        // second buffer could not be allocated
+        bool setDoubleBuffered ( bool enable );
+
+        // Publish all changes made since the last commit
+        void commit ( void );
+
+        // A commit is waiting for the next break, updates made
+        // now will wait until the swap took place
+        bool commitPending ( void );
+
+    public: // functions to provide access from USART
+        DMX_Port *getPort ( void )          { return m_port; };
+
+        uint16_t getBreakLength ( void )    { return m_breakLength; };
+        uint16_t getMabLength ( void )      { return m_mabLength; };
+
+        // Buffer which is being put on the line
+        DMX_FrameBuffer &getTransmitBuffer ( void );
+
+        // Number of bytes (startbyte included) transmitted per frame
+        uint16_t getFrameSize ( void );
+
+        // Invoked at the break of every frame to measure the frame
+        // rate and swap in committed changes
+        void     frameStarted ( uint32_t now_us );
+
+
+    protected:
+        void setStartCode ( uint8_t value ); 
+
+        // Bring the back buffer up to date with the transmitted frame
+        void syncBackBuffer ( void );
+
+
+    private:
+        DMX_Port        *m_port;
+        DMX_FrameBuffer m_frameBuffer;
+        uint8_t         m_autoBreak;
+        uint8_t         m_timedBreak;
+        uint16_t        m_breakLength;      // Timed break length in µs
+        uint16_t        m_mabLength;        // Timed MAB length in µs
+
+        DMX_FrameBuffer     *m_frontBuffer;     // Transmitted frame when double buffered
+        volatile uint8_t    m_commitPending;
+        volatile uint8_t    m_backStale;        // Back buffer holds an older frame
+
+        dmx::dmxFramePadding m_padding;
+        dmx::dmxTransmitMode m_txMode;
+        uint32_t            m_lastFrameStart;   // Start of previous frame in µs
+        volatile uint32_t   m_framePeriod;      // Break to break time in µs
+};
+
+
+//
+// DMX Slave controller, receives a footprint of consecutive channels
+// from its start address on. Several slaves can share a port (e.g. the
+// heads of a LED bar with independent addresses), every incoming frame
+// is dispatched into all of their footprints in a single pass
+//
+class DMX_Slave : public DMX_FrameBuffer
+{
+    public:
+        DMX_Slave ( DMX_FrameBuffer &buffer, int readEnablePin = -1,
+                    uint8_t port = DMX_DEFAULT_PORT );
+
+        // nrChannels is the consecutive DMX512 slots required
+        // to operate this slave device
+        DMX_Slave ( uint16_t nrChannels, int readEnablePin = -1,
+                    uint8_t port = DMX_DEFAULT_PORT );
+
+        ~DMX_Slave ( void );
+
+        // The receiver of the port keeps running while any
+        // slave on it is enabled
+        void enable     ( void );           // Enable receiver
+        void disable    ( void );           // Disable receiver
+
+ 
+        // Get reference to the internal framebuffer
+        DMX_FrameBuffer &getBuffer ( void );
+
+        uint8_t  getChannelValue ( uint16_t channel );
+
+        // Copy len channel values starting at slot start (1 = first
+        // channel of the footprint), when double buffered the copy
+        // always holds a single frame
+        void     getChannels ( uint16_t start, uint8_t *dst, uint16_t len );
+
+        uint16_t getStartAddress ( void );
+        void     setStartAddress ( uint16_t );
+
+
+        //
+        // Double buffered (tear free) reception, slots are received in a
+        // shadow buffer which is published when the footprint is filled
+        // or at the break ending a shorter frame (missing slots read as
+        // zero). Read through the slave object only, not through a
+        // shared DMX_FrameBuffer. Returns false when the shadow buffer
+        // could not be allocated
+        //
+        bool     setDoubleBuffered ( bool enable );
+
+        // Incremented for every frame received, compare with an earlier
+        // value to see whether a new frame arrived
+        uint16_t getFrameSequence ( void );
+
+        //
+        // Signal loss handling, when no frame arrived for timeout_ms the
+        // channel values read through getChannelValue and getChannels
+        // follow the policy (hold last look by default). The received
+        // values are left untouched and take over again with the next
+        // frame. Nothing received since enable counts as lost.
+        //
+        // fade_ms is the time to fade from the last look to zero
+        //
+        void     setSignalLoss ( dmx::dmxSignalLoss policy, 
+                                 uint16_t timeout_ms = 1000, uint16_t fade_ms = 0 );
+
+        // Channel values (footprint relative, first value is channel 1)
+        // shown by dmxPresetScene, the array is not copied and must
+        // stay valid. Channels beyond len read as zero
+        void     setLossScene ( const uint8_t *values, uint16_t len );
+
+        dmx::dmxSignalState getSignalState ( void );
+
+        // Received frames per second (0 when the signal is lost)
+        uint16_t getFrameRate ( void );
+
+        // Process incoming byte from USART, the port only passes
+        // the start code (first) and the slots of our footprint.
+        // returns true when no more data is accepted
+        bool processIncoming   ( uint8_t val, bool first = false );
+
+        // Break received by the USART
+        void processBreak      ( void );
+
+        // Frame event taken from the queue by service()
+        void frameServiced     ( uint16_t channels );
+
+        // Register on receive complete callback in case
+        // of time critical applications, it is invoked from
+        // the receive interrupt
+        void onReceiveComplete ( void (*func)(unsigned short) );
+
+        // Register a callback invoked from service() for every
+        // frame received, outside of the interrupt
+        void onFrameReceived ( void (*func)(unsigned short) );
+
+        // Handle the events of the port, call this from loop(). Also
+        // services the other slaves and the responder on the port
+        void service ( void );
+
+        DMX_Port *getPort ( void ) { return m_port; };
+
+        bool isEnabled ( void ) { return m_enabled; };
+
+        // Next slave on the port in start address order
+        DMX_Slave *getNextSlave ( void ) { return m_nextSlave; };
+
+    protected:
+        // Publish the received frame
+        void frameComplete ( void );
+
+        // Insert into / remove from the sorted slave list of the port
+        void attach ( void );
+        void detach ( void );
+
+        // Scale applied to received values (256 = unchanged) or
+        // LossLevelScene when the scene is shown
+        uint16_t lossLevel ( void );
+        uint8_t  applyLoss ( uint16_t channel, uint8_t value, uint16_t level );
+
+        enum { LossLevelFull = 256, LossLevelScene = 0xffff };
+
+    private:
+        DMX_Port        *m_port;
+        uint16_t        m_startAddress;     // Slave start address
+        dmx::dmxState   m_state;
+        bool            m_enabled;
+        DMX_Slave       *m_nextSlave;       // Next footprint on the port
+        uint8_t         *m_rxBase;          // Buffer receiving the frame
+        uint8_t         *m_rxPtr;           // Receive cursor
+        uint8_t         *m_rxEnd;
+
+        DMX_FrameBuffer     *m_shadow;          // Receive buffer when double buffered
+        volatile uint16_t   m_frameSequence;
+
+        dmx::dmxSignalLoss  m_lossPolicy;
+        uint32_t            m_lossTimeout;      // Timeout in µs
+        uint16_t            m_lossFade;         // Fade time in ms
+        const uint8_t       *m_lossScene;
+        uint16_t            m_lossSceneLen;
+        uint32_t            m_enableTime;       // Start of reception in µs
+        volatile uint32_t   m_lastFrameTime;    // End of last frame in µs (from ISR)
+        volatile uint32_t   m_framePeriod;      // Time between last two frames in µs
+
+        void (*event_onFrameReceived)(unsigned short channelsReceived);
+        void (*event_onFrameServiced)(unsigned short channelsReceived);
+};
+
+
+//
+// Frame recorded by DMX_Monitor, all times in µs
+//
+struct DMX_MonitorFrame
+{
+    uint32_t    timestamp;          // Start code received
+    uint32_t    breakToStart;       // Break + mark after break
+    uint32_t    dataTime;           // Start code to the last slot
+    uint32_t    framePeriod;        // Break of this frame to the next break
+    uint16_t    slots;              // Slots received, start code included
+    uint16_t    recorded;           // Slots held in data (up to maxSlots)
+    uint8_t     *data;              // data[0] holds the start code
+
+    uint8_t     getStartCode ( void ) const { return data[0]; };
+
+    // Average time between the start of two slots
+    uint16_t    getSlotTime ( void ) const
+    { return slots > 1 ? dataTime / (slots - 1) : 0; };
+};
+
+
+//
+// Monitor (sniffer) recording whole frames of any start code (DMX,
+// RDM, text packets, SIP, manufacturer codes) into a ring of frames
+// for on-site diagnostics. It runs next to the slaves of a port, or on
+// its own.
+//
+// Times are taken when the USART reports the break (framing error) and
+// each slot. Both lag the line by the same byte time so breakToStart
+// is the break and mark after break together, the USART does not
+// tell where the break ends. A frame is recorded once the break 
+// following it has been received.
+//
+class DMX_Monitor
+{
+    public:
+        // Keep nrFrames frames of at most maxSlots slots (start code
+        // included) each
+        DMX_Monitor ( uint8_t nrFrames = 2, uint16_t maxSlots = DMX_MAX_FRAMESIZE,
+                      int readEnablePin = -1, uint8_t port = DMX_DEFAULT_PORT );
+        ~DMX_Monitor ( void );
+
+        void enable     ( void );           // Start recording
+        void disable    ( void );           // Stop recording
+
+        // Number of recorded frames waiting to be released
+        uint8_t available ( void );
+
+        // Oldest recorded frame (NULL when none), it stays valid and
+        // unchanged until released
+        const DMX_MonitorFrame *getFrame ( void );
+        void    release ( void );
+
+        // Frames lost because no free frame was left
+        uint16_t getDroppedFrames ( void );
+
+    public: // functions to provide access from USART
+        void processIncoming ( uint8_t val, bool framingError );
+
+        DMX_Port *getPort ( void ) { return m_port; };
+
+    private:
+        DMX_Port            *m_port;
+        DMX_MonitorFrame    *m_frames;
+        uint8_t             *m_data;
+        uint8_t             m_nrFrames;
+        uint16_t            m_maxSlots;
+
+        volatile uint8_t    m_first;        // Oldest recorded frame
+        volatile uint8_t    m_count;        // Recorded frames
+        volatile uint16_t   m_dropped;
+
+        DMX_MonitorFrame    *m_frame;       // Frame being recorded
+        bool                m_breakSeen;    // Waiting for a start code
+        uint32_t            m_breakAt;
+        uint32_t            m_lastSlotAt;
+};
+
+
+class RDM_FrameBuffer : public IFrameBuffer
+{
+    public:
+        //
+        // Constructor
+        //
+        // The message buffer is shared with the other RDM objects 
+        // of the port (see DMX_Port::getRdmMessage)
+        RDM_FrameBuffer     ( RDM_Message *msg ) 
+        : m_state ( rdm::rdmUnknown ), m_msg ( msg ), m_idx ( 0 ) {};
+        ~RDM_FrameBuffer    ( void ) {};
+
+        uint16_t getBufferSize ( void );        
+
+        uint8_t getSlotValue ( uint16_t index );
+        void    setSlotValue ( uint16_t index, uint8_t value );
+        void    clear ( void );        
+
+        uint8_t &operator[] ( uint16_t index );
+
+    public: // functions to provide access from USART       
+        // Process incoming byte from USART, 
+        // returns false when no more data is accepted
+        bool processIncoming ( uint8_t val, bool first = false );
+
+        // Process outgoing byte to USART
+        // returns false when no more data is available
+        bool fetchOutgoing ( uint8_t *val, bool first = false );
+
+    protected:
+        // Process received frame
+        virtual void processFrame ( void ) = 0;
+
+    //private:
+    protected:
+        rdm::rdmState   m_state;       // State for pushing the message in
+        RDM_Message     *m_msg;
+        uint16_t        m_csRecv;      // Checksum received in rdm message
+        uint16_t        m_csCalc;      // Calculared checksum
+        uint16_t        m_idx;         // Receive / transmit cursor
+};
+
+//
+// Handler of a parameter, invoked with the request in msg. The response
+// parameter data is written through pd, which overwrites the request
+// data. Returns RDM_ACK, a NACK reason (enum rdm::RdmNackReasons) or
+// RDM_NO_RESPONSE
+//
+typedef uint8_t (*RDM_ParameterHandler) ( RDM_Responder &responder, RDM_Message *msg,
+                                          RDM_ParameterWriter &pd );
+
+//
+// Entry of a parameter table, tables are kept in PROGMEM sorted by PID.
+// Requests with a command class or parameter data length the entry does 
+// not accept are NACK'ed without invoking the handler
+//
+struct RDM_Parameter
+{
+    uint16_t                pid;
+    uint8_t                 flags;      // enum rdm::RdmParameterFlags
+    uint8_t                 getPdl;     // Parameter data length of GET requests
+    uint8_t                 minPdl;     // Parameter data length range of SET
+    uint8_t                 maxPdl;     // and DISCOVERY requests
+    RDM_ParameterHandler    handler;
+};
+
+//
+// Cached state of a registered sensor, requests are answered from here
+//
+struct RDM_Sensor
+{
+    const RDM_SensorDefinition  *def;       // PROGMEM
+    int16_t                     (*sample)(uint8_t sensor);
+    int16_t                     value;      // Present value
+    int16_t                     lowest;     // Since the last reset
+    int16_t                     highest;
+    int16_t                     recorded;   // Snapshot of RECORD_SENSORS
+};
+
+//
+// Sub-device of a responder (e.g. a module of a dimmer rack) with its 
+// own start address, footprint, personality and label. Its footprint
+// is received by its own DMX_Slave on the port of the responder
+// (see DMX_Slave::setStartAddress), the responder manages it through
+// the sub-device field of RDM requests
+//
+class RDM_SubDevice
+{
+    public:
+        RDM_SubDevice ( DMX_Slave &slave, uint16_t deviceModelId = 0, uint8_t personalities = 1 );
+
+        DMX_Slave   *getSlave ( void )              { return m_slave; };
+        uint16_t    getDeviceModelId ( void )       { return m_deviceModelId; };
+
+        uint8_t     getPersonality ( void )         { return m_personality; };
+        void        setPersonality ( uint8_t personality ) { m_personality = personality; };
+
+        bool        isIdentifying ( void )          { return m_identify; };
+
+        // Label of RDM_MAX_DEVICELABEL_LENGTH characters, padded with spaces
+        const char  *getDeviceLabel ( void )        { return m_deviceLabel; };
+        void        setDeviceLabel ( const char *label, size_t len );
+
+    private:
+        friend class RDM_Responder;
+
+        DMX_Slave   *m_slave;
+        uint16_t    m_deviceModelId;
+        uint8_t     m_personalities;
+        uint8_t     m_personality;
+        bool        m_identify;
+        char        m_deviceLabel[RDM_MAX_DEVICELABEL_LENGTH];
+};
+
+//
+// RDM_Responder 
+//
+class RDM_Responder : public RDM_FrameBuffer
+{
+    public:
+        //
+        // m        = manufacturer id (16bits)
+        // d1-d4    = device id (32bits)
+        //
+        RDM_Responder   ( uint16_t m, uint8_t d1, uint8_t d2, uint8_t d3, uint8_t d4, DMX_Slave &slave);
+        ~RDM_Responder  ( void );
+
+        void    setDeviceInfo 
+                ( 
+                    uint16_t deviceModelId, 
+                    rdm::RdmProductCategory productCategory,
+                    uint8_t personalities = 1,
+                    uint8_t personality = 1
+                )
+        {
+            m_DeviceModelId         = deviceModelId;
+            m_ProductCategory       = productCategory;
+            m_Personalities         = personalities;
+            m_Personality           = personality;
+        };
+
+        //
+        // Set vendor software version id
+        //
+        // v1 = MOST SIGNIFICANT
+        // v2... 
+        // v3...
+        // v4 = LEAST SIGNIFICANT
+        //
+        void    setSoftwareVersionId ( uint8_t v1, uint8_t v2, uint8_t v3, uint8_t v4 )
+        {
+            m_SoftwareVersionId[0] = v1;
+            m_SoftwareVersionId[1] = v2;
+            m_SoftwareVersionId[2] = v3;
+            m_SoftwareVersionId[3] = v4;
+        }
+
+        //
+        // Register a sensor from setup(), returns its number or
+        // RDM_ALL_SENSORS when out of memory. The sample function is
+        // called from service() and its value cached, requests are
+        // answered from the cache so the application is never called 
+        // from the receive interrupt. Without a sample function the
+        // value is set with setSensorValue
+        //
+        uint8_t addSensor ( const RDM_SensorDefinition *def, 
+                            int16_t (*sample)(uint8_t sensor) = NULL );
+        uint8_t getSensorCount ( void ) { return m_nrSensors; };
+
+        void    setSensorValue ( uint8_t sensor, int16_t value );
+        int16_t getSensorValue ( uint8_t sensor );
+
+        // Time between two samples of the sensors (default 100ms)
+        void    setSensorInterval ( uint16_t ms ) { m_sensorInterval = ms; };
+
+        // Sample the sensors when the interval expired, invoked by service()
+        void    sampleSensors ( void );
+
+        //
+        // Add a sub-device from setup(), sub-devices are numbered from 1
+        // in the order they are added. Returns the number or 0 when out
+        // of memory
+        //
+        uint16_t addSubDevice ( RDM_SubDevice &sub );
+        uint16_t getSubDeviceCount ( void ) { return m_nrSubDevices; };
+
+        // Sub-device by number (1 - count), NULL for the root device
+        RDM_SubDevice *getSubDevice ( uint16_t nr );
+
+        // Sub-device of a request, NULL for the root device
+        RDM_SubDevice *getSubDevice ( RDM_Message *msg );
+
+        // Invoked when a controller changed a parameter (PID) of a sub-device
+        void    onSubDeviceChanged ( void (*func) (uint16_t subDevice, uint16_t pid) );
+
+        //
+        // Messages for the controller, collected with GET QUEUED_MESSAGE
+        // and STATUS_MESSAGES. The message count of every response tells
+        // the controller whether polling is needed. Both can be called 
+        // from any context and return false when full
+        //
+        // queueMessage reports a parameter the device changed by itself,
+        // the controller receives the GET response of it. Parameters
+        // without a GET, or with GET data, are refused (false). Status
+        // messages are reported in bulk
+        //
+        bool    queueMessage ( uint16_t pid, uint16_t subDevice = RDM_ROOT_DEVICE );
+        bool    addStatusMessage ( rdm::RdmStatusTypes type, uint16_t id, 
+                                   int16_t value1 = 0, int16_t value2 = 0, 
+                                   uint16_t subDevice = RDM_ROOT_DEVICE );
+
+        // Number of GET QUEUED_MESSAGE requests needed to collect all
+        uint8_t getMessageCount ( void );
+
+        uint8_t getPersonality ( void ) { return m_Personality; };
+        void    setPersonality ( uint8_t personality ) { m_Personality = personality; };
+   
+        // Register on identify device event handler
+        void    onIdentifyDevice ( void (*func)(bool) );
+        void    onDeviceLabelChanged ( void (*func) (const char*, uint8_t) );
+        void    onDMXStartAddressChanged ( void (*func) (uint16_t) );
+        void    onDMXPersonalityChanged ( void (*func) (uint8_t) );
+
+
+        // Set the device label
+        void    setDeviceLabel ( const char *label, size_t len );
+        const char *getDeviceLabel ( void ) { return m_deviceLabel; };
+
+        //
+        // Manufacturer specific parameters (0x8000 - 0xffdf) next to the
+        // standard ones, table is a PROGMEM array of count entries sorted 
+        // by PID. They are listed in SUPPORTED_PARAMETERS
+        //
+        void    setParameters ( const RDM_Parameter *table, uint8_t count );
+
+        DMX_Slave *getSlave ( void ) { return m_slave; };
+
+        // Store keeping our configuration (see RDM_ConfigStore)
+        RDM_ConfigStore *getConfigStore ( void ) { return m_config; };
+
+        // Enable, Disable rdm responder
+        void enable ( void )    { m_rdmStatus.enabled = true; m_rdmStatus.mute = false; };
+        void disable ( void )   { m_rdmStatus.enabled = false; };
+
+        //
+        // Deferred processing, the receive interrupt only validates
+        // requests for us and queues them, they are processed and
+        // responded to by service() which has to be called from loop()
+        // often enough to respond in time (2ms), later requests are
+        // processed without a response. No other request is received
+        // until the queued one has been processed
+        //
+        void setDeferred ( bool deferred )  { m_deferred = deferred; };
+        bool isDeferred ( void )            { return m_deferred; };
+
+        // Handle the events of the port (see DMX_Slave::service)
+        void service ( void );
+
+        // A queued request waits for service()
+        bool requestPending ( void )        { return m_requestPending; };
+
+        union
+        {
+            uint8_t  raw;
+            struct
+            {
+                uint8_t mute:1; 
+                uint8_t ident:1;
+                uint8_t enabled:1;  // Rdm responder enable/disable
+            };
+        } m_rdmStatus;
+
+
+    protected:  
+        virtual void processFrame ( void );
+
+    public: // functions to provide access from the port
+        // Process a request in m_msg and respond to it
+        void processRequest ( void );
+
+    protected:
+
+        // Discovery to unque brach packets only requires
+        // the data part of the packet to be transmitted
+        // without breaks or header (built in m_msg)
+        void repondDiscUniqueBranch ( void );
+
+        // Helpers for generating response packets which 
+        // have larger datafields
+        void populateDeviceInfo ( RDM_ParameterWriter &pd, RDM_SubDevice *sub );
+
+    private:
+        // Look up a parameter in the standard and manufacturer tables
+        bool findParameter ( uint16_t pid, RDM_Parameter &param );
+
+        static const RDM_Parameter *getStandardParameters ( uint8_t &count );
+
+        // Handlers of the standard parameters
+        static uint8_t discUniqueBranch     ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t discMute             ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t discUnMute           ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t supportedParameters  ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t deviceInfo           ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t manufacturerLabel    ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t deviceLabel          ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t dmxPersonality       ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t dmxStartAddress      ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t identifyDevice       ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t queuedMessage        ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t statusMessages       ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t sensorDefinition     ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t sensorValue          ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+        static uint8_t recordSensors        ( RDM_Responder &r, RDM_Message *msg, RDM_ParameterWriter &pd );
+
+        void putSensorValue ( RDM_ParameterWriter &pd, uint8_t sensor );
+
+        void subDeviceChanged ( RDM_Message *msg );
+        void configChanged ( void );
+
+        // Status messages of at least type into pd
+        uint8_t putStatusMessages ( RDM_ParameterWriter &pd, uint8_t type );
+
+    private:
+        friend class RDM_ConfigStore;
+
+        DMX_Port                    *m_port;            // Port of our slave
+        DMX_Slave                   *m_slave;
+        RDM_Uid                     m_devid;            // Holds our unique device ID
+        uint8_t                     m_Personalities;    // The total number of supported personalities
+        uint8_t                     m_Personality;      // The currently active personality
+        uint16_t                    m_DeviceModelId;
+        uint8_t                     m_SoftwareVersionId[4]; // 32 bit Software version
+        rdm::RdmProductCategory     m_ProductCategory;
+ 
+        char                        m_deviceLabel[32];  // Device label
+
+        void (*event_onIdentifyDevice)(bool);
+        void (*event_onDeviceLabelChanged)(const char*, uint8_t);
+        void (*event_onDMXStartAddressChanged)(uint16_t);
+        void (*event_onDMXPersonalityChanged)(uint8_t);
+        void (*event_onSubDeviceChanged)(uint16_t, uint16_t);
+
+        bool                        m_deferred;
+        volatile bool               m_requestPending;
+        uint32_t                    m_requestEnd;       // Last byte of the request in µs
+
+        // Response being send in pages (ACK_OVERFLOW)
+        uint16_t                    m_overflowPid;
+        uint16_t                    m_overflowOffset;   // Parameter data send so far
+        RDM_Uid                     m_overflowSrc;      // Controller reading it
+
+        const RDM_Parameter         *m_parameters;      // Manufacturer specific
+        uint8_t                     m_nrParameters;
+
+        RDM_Sensor                  *m_sensors;
+        uint8_t                     m_nrSensors;
+        uint16_t                    m_sensorInterval;   // ms
+        uint32_t                    m_sensorSampledAt;  // µs
+
+        RDM_SubDevice               **m_subDevices;
+        uint16_t                    m_nrSubDevices;
+
+        RDM_ConfigStore             *m_config;
+
+        DMX_Queue<RDM_QueuedMessage, RDM_QUEUED_MESSAGES> m_queued;
+        RDM_QueuedMessage           m_lastQueued;       // For STATUS_GET_LAST_MESSAGE
+
+        // Status messages which were reported are kept until the next
+        // request for STATUS_GET_LAST_MESSAGE
+        RDM_StatusMessage           m_status[RDM_STATUS_MESSAGES];
+        uint8_t                     m_nrStatus;
+        uint8_t                     m_statusReported;   // Bit per m_status entry
+};
+
+
+//
+// Keeps the start address, personality and device label of a responder
+// in EEPROM. Every save writes a complete record (sequence number and
+// CRC) into the next slot of the region so wear is spread over the
+// whole region, an interrupted write leaves the previous record valid.
+//
+// Changes made over RDM are tracked by the responder. Bursts of them 
+// (e.g. an address sweep from a console) are coalesced, the record is
+// written once no change arrived for the write delay. It is written a
+// byte per service() call, loop() never waits for the EEPROM.
+//
+// The configuration is restored at construction, declare the store
+// after its responder
+//
+class RDM_ConfigStore
+{
+    public:
+        // EEPROM region of size bytes starting at base
+        RDM_ConfigStore ( RDM_Responder &responder, uint16_t base = 0, uint16_t size = 256 );
+        ~RDM_ConfigStore ( void );
+
+        // Apply the newest valid record, returns false when there is none
+        bool    restore ( void );
+
+        // Configuration was changed by the application
+        void    changed ( void );
+
+        // Time without changes before a record is written (default 2000ms)
+        void    setWriteDelay ( uint16_t ms ) { m_writeDelay = ms; };
+
+        // Write a pending change without waiting for the write delay
+        void    flush ( void );
+
+        // A change is waiting or being written
+        bool    pending ( void );
+
+        // Write the record, invoked by service() of the port
+        void    service ( void );
+
+    private:
+        // Sequence 2, address 2, personality 1, label 32, crc 2
+        enum { RecordSize = 39 };
+
+        uint16_t slotAddress ( uint8_t slot ) { return m_base + slot * RecordSize; };
+        uint32_t micros ( void );
+        void     prepare ( void );
+
+        RDM_Responder   *m_responder;
+        uint16_t        m_base;
+        uint8_t         m_slots;
+        uint8_t         m_slot;             // Slot of the newest record
+        uint16_t        m_seq;              // Sequence of the newest record
+
+        volatile bool   m_dirty;
+        uint32_t        m_changedAt;        // µs
+        uint16_t        m_writeDelay;       // ms
+
+        uint8_t         m_record[RecordSize];   // Record being written
+        uint8_t         m_writeSlot;
+        uint8_t         m_writePos;         // RecordSize when idle
+};
+
+
+//
+// Counters of the last discovery
+//
+struct RDM_DiscoveryStats
+{
+    uint16_t    branches;           // DISC_UNIQUE_BRANCH requests
+    uint16_t    collisions;         // Branches answered by several responders
+    uint16_t    mutes;              // DISC_MUTE requests
+    uint16_t    dropped;            // Responders found but not stored (out of memory)
+};
+
+//
+// Counters of the poll plan since resetPollStats
+//
+struct RDM_PollStats
+{
+    uint32_t    requests;           // GET requests send, retries included
+    uint32_t    acks;               // Responses with parameter data
+    uint32_t    ackTimers;          // Responses postponed by the responder
+    uint32_t    nacks;
+    uint32_t    timeouts;           // Responses lost or garbled
+    uint32_t    retries;            // Requests repeated after a timeout
+    uint32_t    failures;           // Polls given up after the retries
+    uint32_t    elapsed;            // ms covered by the counters
+};
+
+//
+// RDM controller on the port of a DMX master. Requests are put on the
+// line in the gap after a DMX frame, the next frame follows once the
+// response arrived or its time has passed. Without an enabled master
+// requests are send right away. A port runs either a controller or a 
+// responder.
+//
+// Discovery finds every responder on the line. All of them are unmuted,
+// a branch of the UID space which answers DISC_UNIQUE_BRANCH with a 
+// collision is split in two halves, a clean answer is muted and the
+// branch is asked again until it stays silent. Branches are walked in
+// order, so no stack is needed.
+//
+// The devices found are kept in UID order. Background discovery keeps
+// them up to date without unmuting the line, a sweep of the whole UID
+// space is only answered by new (or power cycled) responders and only
+// the branches that answer are split. Every sweep also mutes one known
+// device to see whether it is still there. Changes are reported through
+// onDeviceFound and onDeviceLost.
+//
+// The poll plan GETs parameters of many responders, every poll at its
+// own interval and priority. The next poll is put in place by the same
+// service() call that handles a response, so requests follow each
+// other as closely as the frame rate allows. A responder answering 
+// ACK_TIMER is asked for the response with QUEUED_MESSAGE once its 
+// estimate passed, lost responses are retried a couple of times.
+//
+// Everything runs from service(), call it from loop()
+//
+class RDM_Controller : public RDM_FrameBuffer
+{
+    public:
+        //
+        // m        = manufacturer id (16bits)
+        // d1-d4    = device id (32bits) of the controller
+        //
+        RDM_Controller  ( DMX_Master &master, uint16_t m, uint8_t d1, uint8_t d2, 
+                          uint8_t d3, uint8_t d4 );
+        ~RDM_Controller ( void );
+
+        //
+        // Send a request, returns false while another request (or poll)
+        // or a discovery is busy. Broadcasts are not responded to. A 
+        // refused request goes ahead of the polls when it is tried again
+        //
+        bool    sendRequest ( const RDM_Uid &dst, rdm::RdmCommandClass cc, uint16_t pid,
+                              const uint8_t *pd = NULL, uint8_t pdl = 0,
+                              uint16_t subDevice = RDM_ROOT_DEVICE );
+        bool    isBusy ( void );
+
+        // Response of the last request, NULL while busy or when it was
+        // lost. It stays valid until the next request, polls and sweeps
+        // wait until it is read (or for RDM_RESPONSE_HOLD_MS)
+        RDM_Message *getResponse ( void );
+
+        //
+        // Full discovery, devices which do not answer anymore are 
+        // removed from the table. Returns false when busy or there is 
+        // no message buffer
+        //
+        bool    startDiscovery ( void );
+        bool    isDiscovering ( void )          { return m_discState != DiscIdle && m_fullDiscovery; };
+
+        // Run a sweep every interval_ms while no request or discovery is 
+        // busy, a request postpones the next sweep by an interval. 0 
+        // (default) disables background discovery
+        void    setBackgroundDiscovery ( uint16_t interval_ms ) { m_sweepInterval = interval_ms; };
+
+        // Device table in UID order
+        uint16_t getDeviceCount ( void )        { return m_nrDevices; };
+        const RDM_Uid &getDevice ( uint16_t index ) { return m_devices[index].uid; };
+
+        // Duration of the last complete discovery in ms
+        uint32_t getDiscoveryTime ( void )      { return m_discTime; };
+        const RDM_DiscoveryStats &getDiscoveryStats ( void ) { return m_stats; };
+
+        // Invoked from service() when a responder is added to or removed
+        // from the table
+        void    onDeviceFound ( void (*func)(const RDM_Uid &uid) );
+        void    onDeviceLost ( void (*func)(const RDM_Uid &uid) );
+
+        //
+        // Frames per second the master keeps up while requests are
+        // interleaved, requests wait for gaps until the frames send
+        // make up for the time they take. Several requests can share a
+        // gap as long as the rate allows. With 0 (default) every gap
+        // takes a single request
+        //
+        void    setMinFrameRate ( uint16_t fps );
+
+        //
+        // Poll plan, pid is read (GET) from the responder every 
+        // interval_ms. When several polls are due the highest priority
+        // goes first, pd holds up to 2 bytes of GET parameter data
+        // (sensor number, status type). Polls are numbered from 1, 
+        // returns 0 when out of memory
+        //
+        uint16_t addPoll ( const RDM_Uid &uid, uint16_t pid, uint16_t interval_ms,
+                           uint8_t priority = 0, const uint8_t *pd = NULL, 
+                           uint8_t pdl = 0, uint16_t subDevice = RDM_ROOT_DEVICE );
+        void    removePoll ( uint16_t poll );
+
+        // ms since the last response (ACK or NACK) of the poll
+        uint32_t getPollAge ( uint16_t poll );
+
+        //
+        // Invoked from service() with the response of a poll (ACK, 
+        // ACK_OVERFLOW or NACK), msg is NULL when the poll was given up 
+        // after the retries. The next attempt follows after the interval,
+        // msg is only valid during the call
+        //
+        void    onPollResponse ( void (*func)(uint16_t poll, const RDM_Message *msg) );
+
+        const RDM_PollStats &getPollStats ( void );
+        void    resetPollStats ( void );
+
+        // GET requests per second since resetPollStats
+        uint16_t getPollRate ( void );
+
+        void    service ( void );
+
+    public: // functions to provide access from the port
+        bool    requestReady ( void )           { return m_reqState == RequestReady; };
+        void    requestStarted ( void )         { m_reqState = RequestBusy; };
+
+        // Break of a DMX frame
+        void    frameStarted ( uint32_t now_us );
+
+        // The request fits the minimum frame rate, a further request in
+        // the same gap only when a rate is set
+        bool    requestFits ( uint32_t now_us, bool sameGap );
+
+        // Request is out, returns whether a response is expected and
+        // the time to wait for it (or before the next packet)
+        bool    requestSent ( uint16_t &window );
+
+        // Spacing before the next packet once the window passed
+        uint16_t windowSpacing ( void );
+
+        // Byte of the response, returns true when it is complete
+        bool    processResponse ( uint8_t val, bool framingError );
+        void    requestDone ( void )            { m_reqState = RequestDone; };
+
+    protected:
+        virtual void processFrame ( void );
+
+    private:
+        enum { RequestIdle, RequestReady, RequestBusy, RequestDone };
+        enum { DiscIdle, DiscUnMute, DiscBranch, DiscMute, DiscCheck };
+
+        // Discovery response of a single responder (preamble included)
+        enum { DiscResponseSize = 24 };
+
+        // Known devices which miss this many mutes in a row are lost,
+        // Unconfirmed marks devices not found yet by a full discovery
+        enum { MissedLimit = 3, Unconfirmed = 0xff };
+
+        enum { PollFree, PollWait, PollQueued };
+        enum { UserIdle, UserBusy, UserHeld, UserWaiting };
+
+        // Lost responses retried before a poll is given up, longest
+        // ACK_TIMER estimate followed (in 100ms)
+        enum { PollRetries = 2, PollDataSize = 2, PollMaxEstimate = 600 };
+
+        struct Poll
+        {
+            RDM_Uid     uid;
+            uint16_t    pid;
+            uint16_t    subDevice;
+            uint8_t     pd[PollDataSize];
+            uint8_t     pdl;
+            uint8_t     priority;
+            uint8_t     state;              // PollWait, or PollQueued for ACK_TIMER
+            uint8_t     retries;            // Lost responses in a row
+            uint16_t    interval;           // ms
+            uint32_t    dueAt;              // µs
+            uint32_t    respondedAt;        // µs
+        };
+
+        struct Device
+        {
+            RDM_Uid     uid;
+            uint8_t     missed;             // Mutes not answered
+        };
+
+        void    request ( const RDM_Uid &dst, uint8_t cc, uint16_t pid, 
+                          const uint8_t *pd, uint8_t pdl, uint16_t subDevice );
+        bool    responseValid ( void );
+
+        // Discovery steps
+        void    sendBranch ( void );
+        void    splitBranch ( void );
+        void    nextBranch ( void );
+        void    branchAnswered ( void );
+        void    muteAnswered ( void );
+        void    checkAnswered ( void );
+        void    sweepDone ( void );
+        bool    decodeDiscovery ( RDM_Uid &uid );
+
+        // Poll plan steps
+        bool    holdResponse ( void );
+        void    deferPolls ( void );
+        void    sendPoll ( void );
+        void    pollAnswered ( void );
+        void    pollDone ( uint16_t poll, const RDM_Message *msg, uint32_t now );
+        Poll   *findQueued ( const RDM_Uid &uid, uint16_t pid, uint16_t subDevice );
+        void    countPollTime ( void );
+
+        // Position of uid in the table, or where it belongs
+        bool    findDevice ( const RDM_Uid &uid, uint16_t &index );
+        void    addDevice ( const RDM_Uid &uid );
+        void    removeDevice ( uint16_t index );
+
+        DMX_Port            *m_port;
+        RDM_Uid             m_uid;
+        uint8_t             m_tn;               // Transaction number
+
+        volatile uint8_t    m_reqState;
+        uint8_t             m_reqCC;            // Request in flight
+        uint16_t            m_reqPid;
+        RDM_Uid             m_reqDst;
+        bool                m_expectResponse;
+        bool                m_discovery;        // DISC_UNIQUE_BRANCH in flight
+        uint16_t            m_window;           // µs
+        volatile uint32_t   m_windowStart;      // µs
+        uint16_t            m_cost;             // Estimated line time of the request in µs
+
+        uint32_t            m_floorPeriod;      // Longest average frame period in µs, 0 = none
+        int32_t             m_budget;           // Line time left for requests in µs
+        uint32_t            m_lastBreak;        // µs
+
+        // Receive state of the response
+        uint8_t             m_rxStage;          // 0 break, 1 start code, 2 data
+        volatile bool       m_rxValid;          // Checksum correct
+        uint8_t             m_disc[DiscResponseSize];
+        volatile uint8_t    m_discLen;
+        volatile bool       m_discCollision;
+
+        uint8_t             m_discState;
+        uint64_t            m_branchLo;         // Branch is m_branchLo + 2^(48-depth) - 1
+        uint8_t             m_branchDepth;
+        RDM_Uid             m_found;            // Being muted
+        bool                m_foundMuted;       // And acknowledged
+        bool                m_fullDiscovery;    // Else a background sweep
+        uint16_t            m_sweepInterval;    // ms
+        uint32_t            m_sweepAt;          // End of the last sweep in µs
+        uint16_t            m_checkNext;        // Device muted by the next sweep
+        uint32_t            m_discStart;        // µs
+        uint32_t            m_discTime;         // ms
+        RDM_DiscoveryStats  m_stats;
+
+        Device              *m_devices;         // Sorted by UID
+        uint16_t            m_nrDevices;
+        uint16_t            m_maxDevices;       // Allocated
+
+        Poll                *m_polls;
+        uint16_t            m_nrPolls;          // Allocated
+        uint16_t            m_pollActive;       // Poll in flight, 0 = none
+        uint8_t             m_userState;        // Request of sendRequest
+        uint32_t            m_heldAt;           // µs
+        RDM_PollStats       m_pollStats;
+        uint32_t            m_pollStatsAt;      // µs counted in elapsed
+
+        void (*event_onDeviceFound)(const RDM_Uid &);
+        void (*event_onDeviceLost)(const RDM_Uid &);
+        void (*event_onPollResponse)(uint16_t, const RDM_Message *);
+};
+
+
+#endif /* CONCEPTINETICS_H_ */
@@ -0,0 +1,117 @@
+/*
+  Dmx_Eeprom.cpp - DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "Dmx_Eeprom.h"
+
+#include <inttypes.h>
+
+
+#if !defined(DMX_SIMULATED_USART)
+
+#include <avr/eeprom.h>
+
+
+void DMX_EepromRead ( uint16_t addr, void *data, uint16_t len )
+{
+    eeprom_read_block ( data, (const void *)addr, len );
+}
+
+bool DMX_EepromReady ( void )
+{
+    return eeprom_is_ready ();
+}
+
+// Only the bytes which differ are written (and wear the cell)
+void DMX_EepromWrite ( uint16_t addr, uint8_t data )
+{
+    if ( eeprom_read_byte ( (const uint8_t *)addr ) != data )
+        eeprom_write_byte ( (uint8_t *)addr, data );
+}
+
+
+#else /* DMX_SIMULATED_USART */
+
+#include <stdio.h>
+#include <string.h>
+
+
+static uint8_t      __eeprom[DMX_EEPROM_SIZE];
+static const char   *__eeprom_file   = "dmx_eeprom.bin";
+static bool         __eeprom_loaded  = false;
+
+void DMX_EepromSetFile ( const char *path )
+{
+    __eeprom_file   = path;
+    __eeprom_loaded = false;
+}
+
+// Erased EEPROM reads 0xff
+static void load ( void )
+{
+    if ( __eeprom_loaded )
+        return;
+
+    memset ( __eeprom, 0xff, sizeof ( __eeprom ) );
+
+    FILE *f = fopen ( __eeprom_file, "rb" );
+
+    if ( f )
+    {
+        size_t len = fread ( __eeprom, 1, sizeof ( __eeprom ), f );
+        (void)len;  // A short image leaves the rest erased
+        fclose ( f );
+    }
+
+    __eeprom_loaded = true;
+}
+
+void DMX_EepromRead ( uint16_t addr, void *data, uint16_t len )
+{
+    load ();
+
+    for ( uint16_t i = 0; i < len; i++ )
+        ((uint8_t *)data)[i] = __eeprom[(addr + i) % DMX_EEPROM_SIZE];
+}
+
+bool DMX_EepromReady ( void )
+{
+    return true;
+}
+
+void DMX_EepromWrite ( uint16_t addr, uint8_t data )
+{
+    load ();
+
+    if ( __eeprom[addr % DMX_EEPROM_SIZE] == data )
+        return;
+
+    __eeprom[addr % DMX_EEPROM_SIZE] = data;
+
+    // Image is written through so an aborted run keeps what was written
+    FILE *f = fopen ( __eeprom_file, "wb" );
+
+    if ( f )
+    {
+        fwrite ( __eeprom, 1, sizeof ( __eeprom ), f );
+        fclose ( f );
+    }
+}
+
+#endif /* DMX_SIMULATED_USART */
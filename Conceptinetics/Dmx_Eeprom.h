@@ -0,0 +1,56 @@
+/*
+  Dmx_Eeprom.h - DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  Byte access to the non volatile memory used by RDM_ConfigStore,
+  selected at compile time like the transport:
+
+  - AVR internal EEPROM (default when building for an AVR target)
+  - RAM image backed by a file (DMX_SIMULATED_USART), so host builds
+    keep their configuration between runs
+
+  Writes never wait, DMX_EepromReady tells when the previous write
+  has finished and the next byte can be written.
+*/
+
+
+#ifndef DMX_EEPROM_H_
+#define DMX_EEPROM_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "Dmx_Transport.h"
+
+#if defined(DMX_SIMULATED_USART)
+    // Size of the simulated EEPROM (as on the MEGA)
+    #define DMX_EEPROM_SIZE     4096
+
+    // File holding the simulated EEPROM, loaded on first access
+    void    DMX_EepromSetFile ( const char *path );
+#endif
+
+void    DMX_EepromRead ( uint16_t addr, void *data, uint16_t len );
+
+// A write is only started when DMX_EepromReady returned true
+bool    DMX_EepromReady ( void );
+void    DMX_EepromWrite ( uint16_t addr, uint8_t data );
+
+
+#endif /* DMX_EEPROM_H_ */
@@ -0,0 +1,95 @@
+/*
+  Dmx_Queue.h - DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  Single producer / single consumer queue used to hand events from the
+  interrupt handlers (producer) to the application (consumer) without
+  disabling interrupts.
+
+  Both sides only write their own index, the indexes are single bytes
+  so they are read and written atomically on the AVR. Size must be a
+  power of two and at most 128.
+*/
+
+
+#ifndef DMX_QUEUE_H_
+#define DMX_QUEUE_H_
+
+#include <inttypes.h>
+
+// Keeps the compiler from moving memory accesses across it
+#define DMX_MEMORY_BARRIER()    __asm__ __volatile__ ( "" ::: "memory" )
+
+
+template <class T, uint8_t Size>
+class DMX_Queue
+{
+    public:
+        constexpr DMX_Queue ( void ) : m_items (), m_head ( 0 ), m_tail ( 0 ) {};
+
+        // Producer side, returns false when the queue is full
+        bool push ( const T &item )
+        {
+            uint8_t head = m_head;
+
+            if ( (uint8_t)( head - m_tail ) >= Size )
+                return false;
+
+            m_items[head & ( Size - 1 )] = item;
+            
+            // Item must be complete before it is published
+            DMX_MEMORY_BARRIER ();
+            m_head = head + 1;
+
+            return true;
+        }
+
+        // Consumer side, returns false when the queue is empty
+        bool pop ( T &item )
+        {
+            uint8_t tail = m_tail;
+
+            if ( tail == m_head )
+                return false;
+
+            DMX_MEMORY_BARRIER ();
+            item = m_items[tail & ( Size - 1 )];
+
+            // Item must be copied before its slot is handed back
+            DMX_MEMORY_BARRIER ();
+            m_tail = tail + 1;
+
+            return true;
+        }
+
+        bool    empty ( void ) { return m_head == m_tail; };
+        uint8_t count ( void ) { return (uint8_t)( m_head - m_tail ); };
+
+    private:
+        // Indexes run freely, the difference is the number of items
+        T                   m_items[Size];
+        volatile uint8_t    m_head;         // Written by the producer
+        volatile uint8_t    m_tail;         // Written by the consumer
+
+        static_assert ( Size && Size <= 128 && !( Size & ( Size - 1 ) ),
+                        "DMX_Queue size must be a power of two up to 128" );
+};
+
+
+#endif /* DMX_QUEUE_H_ */
@@ -0,0 +1,943 @@
+/*
+  Dmx_Transport.cpp - DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "Conceptinetics.h"
+#include "Dmx_Transport.h"
+
+#include <inttypes.h>
+
+
+#if !defined(DMX_SIMULATED_USART)
+
+#include "pins_arduino.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+
+//
+// Register and vector names of USART 0 differ between devices,
+// USART 1-3 are only found on the larger devices (MEGA)
+//
+#if defined (USE_DMX_SERIAL_0)
+
+    #if defined (USART__TXC_vect)
+      #define USART0_TX USART__TXC_vect
+    #elif defined(USART_TX_vect)
+      #define USART0_TX  USART_TX_vect
+    #elif defined(USART0_TX_vect)
+      #define USART0_TX USART0_TX_vect
+    #endif 
+
+    #if defined (USART__UDRE_vect)
+      #define USART0_UDRE USART__UDRE_vect
+    #elif defined(USART_UDRE_vect)
+      #define USART0_UDRE  USART_UDRE_vect
+    #elif defined(USART0_UDRE_vect)
+      #define USART0_UDRE USART0_UDRE_vect
+    #endif 
+
+    #if defined (USART__RXC_vect)
+      #define USART0_RX USART__RXC_vect
+    #elif defined(USART_RX_vect)
+      #define USART0_RX  USART_RX_vect
+    #elif defined(USART0_RX_vect)
+      #define USART0_RX USART0_RX_vect
+    #endif 
+
+    #if defined UDR
+      #define DMX_UDR0   UDR
+      #define DMX_UBRR0H UBRRH
+      #define DMX_UBRR0L UBRRL
+      #define DMX_UCSR0A UCSRA
+      #define DMX_UCSR0B UCSRB
+      #define DMX_UCSR0C UCSRC
+    #elif defined UDR0
+      #define DMX_UDR0   UDR0
+      #define DMX_UBRR0H UBRR0H
+      #define DMX_UBRR0L UBRR0L
+      #define DMX_UCSR0A UCSR0A
+      #define DMX_UCSR0B UCSR0B
+      #define DMX_UCSR0C UCSR0C
+    #endif
+
+#endif
+
+//
+// Bit positions are the same for all USARTs of a device
+//
+#if defined(TXEN0)
+    #define DMX_TXEN    TXEN0
+    #define DMX_TXCIE   TXCIE0
+    #define DMX_RXEN    RXEN0
+    #define DMX_RXCIE   RXCIE0
+    #define DMX_FE      FE0
+    #define DMX_UDRE    UDRE0
+    #define DMX_TXC     TXC0
+    #define DMX_UDRIE   UDRIE0
+    #define DMX_UCSZ0   UCSZ00
+    #define DMX_USBS    USBS0
+#else
+    #define DMX_TXEN    TXEN
+    #define DMX_TXCIE   TXCIE
+    #define DMX_RXEN    RXEN
+    #define DMX_RXCIE   RXCIE
+    #define DMX_FE      FE
+    #define DMX_UDRE    UDRE
+    #define DMX_TXC     TXC
+    #define DMX_UDRIE   UDRIE
+    #define DMX_UCSZ0   UCSZ0
+    #define DMX_USBS    USBS
+#endif
+
+// 8 databits, no parity, 2 stopbits. UCSRC shares its address with
+// UBRRH on older devices and needs URSEL to be written
+#if defined(URSEL)
+    #define DMX_UCSRC_8N2   ((1<<URSEL)|(3<<DMX_UCSZ0)|(1<<DMX_USBS))
+#else
+    #define DMX_UCSRC_8N2   ((3<<DMX_UCSZ0)|(1<<DMX_USBS))
+#endif
+
+
+#define DMX_UBRR(rate)  ((F_CPU + (rate) * 8L) / ((rate) * 16L) - 1)
+
+
+#if defined(USE_DMX_BREAK_TIMER)
+
+#if !defined(TIMSK1)
+  #define TIMSK1 TIMSK
+  #define TIFR1  TIFR
+#endif
+
+//
+// Every port times its breaks with its own 16 bit timer:
+//
+// port 0 = timer 1, port 1 = timer 3, port 2 = timer 4, port 3 = timer 5
+//
+// All of them are wired to PWM pins and timer 1 is also used by the
+// Servo library, only the timers of enabled ports are claimed
+//
+#define DMX_TIMER_REGS(t)   , &TCCR##t##A, &TCCR##t##B, &TIMSK##t, &TIFR##t, &TCNT##t, &OCR##t##A
+#define DMX_NO_TIMER        , NULL, NULL, NULL, NULL, NULL, NULL
+
+#define DMX_TIMER_0         DMX_TIMER_REGS(1)
+
+#if defined(TCCR3A)
+  #define DMX_TIMER_1       DMX_TIMER_REGS(3)
+#else
+  #define DMX_TIMER_1       DMX_NO_TIMER
+#endif
+
+#if defined(TCCR4A)
+  #define DMX_TIMER_2       DMX_TIMER_REGS(4)
+#else
+  #define DMX_TIMER_2       DMX_NO_TIMER
+#endif
+
+#if defined(TCCR5A)
+  #define DMX_TIMER_3       DMX_TIMER_REGS(5)
+#else
+  #define DMX_TIMER_3       DMX_NO_TIMER
+#endif
+
+#else
+
+#define DMX_TIMER_0
+#define DMX_TIMER_1
+#define DMX_TIMER_2
+#define DMX_TIMER_3
+
+#endif /* USE_DMX_BREAK_TIMER */
+
+
+struct DMX_UsartRegs
+{
+    volatile uint8_t    *udr;
+    volatile uint8_t    *ucsra;
+    volatile uint8_t    *ucsrb;
+    volatile uint8_t    *ucsrc;
+    volatile uint8_t    *ubrrh;
+    volatile uint8_t    *ubrrl;
+    uint8_t             txPin;
+#if defined(USE_DMX_BREAK_TIMER)
+    volatile uint8_t    *tccra;
+    volatile uint8_t    *tccrb;
+    volatile uint8_t    *timsk;
+    volatile uint8_t    *tifr;
+    volatile uint16_t   *tcnt;
+    volatile uint16_t   *ocra;
+#endif
+};
+
+//
+// Indexed by port number, ports which are not enabled are left empty
+//
+static const DMX_UsartRegs s_usartRegs[DMX_NR_PORTS] =
+{
+#if defined(USE_DMX_SERIAL_0)
+    { &DMX_UDR0, &DMX_UCSR0A, &DMX_UCSR0B, &DMX_UCSR0C, &DMX_UBRR0H, &DMX_UBRR0L, 1 DMX_TIMER_0 },
+#else
+    { },
+#endif
+
+#if DMX_NR_PORTS > 1
+  #if defined(USE_DMX_SERIAL_1)
+    { &UDR1, &UCSR1A, &UCSR1B, &UCSR1C, &UBRR1H, &UBRR1L, 18 DMX_TIMER_1 },
+  #else
+    { },
+  #endif
+#endif
+
+#if DMX_NR_PORTS > 2
+  #if defined(USE_DMX_SERIAL_2)
+    { &UDR2, &UCSR2A, &UCSR2B, &UCSR2C, &UBRR2H, &UBRR2L, 16 DMX_TIMER_2 },
+  #else
+    { },
+  #endif
+#endif
+
+#if DMX_NR_PORTS > 3
+    { &UDR3, &UCSR3A, &UCSR3B, &UCSR3C, &UBRR3H, &UBRR3L, 14 DMX_TIMER_3 },
+#endif
+};
+
+
+void DMX_Transport::begin ( void )
+{
+    *s_usartRegs[m_port].ucsrc = DMX_UCSRC_8N2;
+}
+
+void DMX_Transport::setMode ( usart::usartMode mode )
+{
+    const DMX_UsartRegs &r = s_usartRegs[m_port];
+
+    switch ( mode )
+    {
+        case usart::Disabled:
+            *r.ucsrb = 0x0;
+            break;
+
+        case usart::Receive:
+            *r.ucsrb = (1<<DMX_RXCIE) | (1<<DMX_RXEN);
+            break;
+
+        case usart::Transmit:
+            // Bytes in the data or shift register keep TXC low
+            *r.ucsra |= (1<<DMX_TXC);
+            *r.ucsrb = (1<<DMX_TXEN) | (1<<DMX_TXCIE);
+            break;
+
+        case usart::TransmitPolled:
+            *r.ucsrb = (1<<DMX_TXEN);
+            break;
+
+        case usart::TransmitBuffered:
+            *r.ucsrb = (1<<DMX_TXEN) | (1<<DMX_UDRIE);
+            break;
+    }
+}
+
+void DMX_Transport::setRate ( usart::usartRate rate )
+{
+    const DMX_UsartRegs &r = s_usartRegs[m_port];
+
+    if ( rate == usart::BreakRate )
+    {
+        *r.ubrrh = (unsigned char)(DMX_UBRR(DMX_BREAK_RATE)>>8);
+        *r.ubrrl = (unsigned char) DMX_UBRR(DMX_BREAK_RATE);
+    }
+    else
+    {
+        *r.ubrrh = (unsigned char)(DMX_UBRR(DMX_BAUD_RATE)>>8);
+        *r.ubrrl = (unsigned char) DMX_UBRR(DMX_BAUD_RATE);
+    }
+}
+
+void DMX_Transport::write ( uint8_t data )
+{
+    *s_usartRegs[m_port].udr = data;
+}
+
+void DMX_Transport::writePolled ( uint8_t data )
+{
+    const DMX_UsartRegs &r = s_usartRegs[m_port];
+
+    // Wait until data register is empty
+    while ( (*r.ucsra & (1<<DMX_UDRE)) == 0 );
+
+    // Clear transmit complete so flush can wait for it
+    *r.ucsra |= (1<<DMX_TXC);
+    *r.udr = data;
+}
+
+void DMX_Transport::flush ( void )
+{
+    const DMX_UsartRegs &r = s_usartRegs[m_port];
+
+    // Wait until last byte is send
+    while ( (*r.ucsra & (1<<DMX_UDRE)) == 0 );
+    while ( (*r.ucsra & (1<<DMX_TXC)) == 0 );
+}
+
+void DMX_Transport::beginBreak ( void )
+{
+    const DMX_UsartRegs &r = s_usartRegs[m_port];
+
+    // Hand the pin back to the port and discard the TX complete
+    // of the last byte
+    *r.ucsrb &= ~((1<<DMX_TXEN) | (1<<DMX_TXCIE));
+    *r.ucsra |= (1<<DMX_TXC);
+
+    pinMode ( r.txPin, OUTPUT );
+    digitalWrite ( r.txPin, LOW );
+}
+
+void DMX_Transport::endBreak ( void )
+{
+    digitalWrite ( s_usartRegs[m_port].txPin, HIGH );
+}
+
+void DMX_Transport::setReadEnablePin ( int8_t pin )
+{
+    m_rePin = pin;
+
+    if ( m_rePin > -1 )
+        pinMode ( m_rePin, OUTPUT );
+}
+
+void DMX_Transport::setReadEnable ( uint8_t level )
+{
+    // If read enable pin is assigned
+    if ( m_rePin > -1 )
+        digitalWrite ( m_rePin, level );
+}
+
+void DMX_Transport::delay_us ( uint16_t us )
+{
+    delayMicroseconds ( us );
+}
+
+uint32_t DMX_Transport::micros ( void )
+{
+    return ::micros ();
+}
+
+#if defined(USE_DMX_BREAK_TIMER)
+
+// Timers run at clk/8
+#define DMX_TIMER_TICKS_PER_USEC    (F_CPU / 8000000UL)
+
+// WGMn2, CSn1, OCIEnA and OCFnA are at the same position for all timers
+void DMX_Transport::startTimer ( uint16_t us )
+{
+    const DMX_UsartRegs &r = s_usartRegs[m_port];
+    uint32_t ticks = (uint32_t)us * DMX_TIMER_TICKS_PER_USEC;
+
+    if ( !r.tccrb )
+        return;
+
+    if ( ticks > 0xffff )
+        ticks = 0xffff;
+    else if ( ticks == 0 )
+        ticks = 1;
+
+    *r.tccra  = 0x0;
+    *r.tccrb  = (1<<WGM12);                 // CTC mode, stopped
+    *r.tcnt   = 0x0;
+    *r.ocra   = (uint16_t)(ticks - 1);
+    *r.tifr   = (1<<OCF1A);                 // Clear pending compare match
+    *r.timsk |= (1<<OCIE1A);
+    *r.tccrb |= (1<<CS11);                  // Start at clk/8
+}
+
+void DMX_Transport::stopTimer ( void )
+{
+    const DMX_UsartRegs &r = s_usartRegs[m_port];
+
+    if ( !r.tccrb )
+        return;
+
+    *r.tccrb  = 0x0;
+    *r.timsk &= ~(1<<OCIE1A);
+}
+
+bool DMX_Transport::hasTimer ( void )
+{
+    return s_usartRegs[m_port].tccrb != NULL;
+}
+
+//
+// Break timer compare match, one shot
+//
+#define DMX_TIMER_ISR(t, port)                  \
+ISR (TIMER##t##_COMPA_vect)                     \
+{                                               \
+    TCCR##t##B  = 0x0;                          \
+    TIMSK##t   &= ~(1<<OCIE1A);                 \
+                                                \
+    DMX_OnTimer ( port );                       \
+}
+
+#if defined(USE_DMX_SERIAL_0)
+DMX_TIMER_ISR(1, 0)
+#endif
+#if defined(USE_DMX_SERIAL_1) && defined(TCCR3A)
+DMX_TIMER_ISR(3, 1)
+#endif
+#if defined(USE_DMX_SERIAL_2) && defined(TCCR4A)
+DMX_TIMER_ISR(4, 2)
+#endif
+#if defined(USE_DMX_SERIAL_3) && defined(TCCR5A)
+DMX_TIMER_ISR(5, 3)
+#endif
+
+#endif /* USE_DMX_BREAK_TIMER */
+
+
+//
+// TX UART (DMX Transmission ISR), data register empty (buffered DMX
+// transmission) and RX UART (DMX Reception ISR)
+//
+// A framing error most likely* indicates a break in our ocasion
+//
+#define DMX_USART_ISR(port, tx_vect, udre_vect, rx_vect, ucsra, udr) \
+ISR (tx_vect)                                                   \
+{                                                               \
+    DMX_OnTransmitComplete ( port );                            \
+}                                                               \
+                                                                \
+ISR (udre_vect)                                                 \
+{                                                               \
+    DMX_OnTransmitComplete ( port );                            \
+}                                                               \
+                                                                \
+ISR (rx_vect)                                                   \
+{                                                               \
+    uint8_t usart_state    = ucsra;                             \
+    uint8_t usart_data     = udr;                               \
+                                                                \
+    if ( usart_state & (1<<DMX_FE) )                            \
+        ucsra &= ~(1<<DMX_FE);                                  \
+                                                                \
+    DMX_OnReceive ( port, usart_data, usart_state & (1<<DMX_FE) ); \
+}
+
+#if defined(USE_DMX_SERIAL_0)
+DMX_USART_ISR(0, USART0_TX, USART0_UDRE, USART0_RX, DMX_UCSR0A, DMX_UDR0)
+#endif
+#if defined(USE_DMX_SERIAL_1)
+DMX_USART_ISR(1, USART1_TX_vect, USART1_UDRE_vect, USART1_RX_vect, UCSR1A, UDR1)
+#endif
+#if defined(USE_DMX_SERIAL_2)
+DMX_USART_ISR(2, USART2_TX_vect, USART2_UDRE_vect, USART2_RX_vect, UCSR2A, UDR2)
+#endif
+#if defined(USE_DMX_SERIAL_3)
+DMX_USART_ISR(3, USART3_TX_vect, USART3_UDRE_vect, USART3_RX_vect, UCSR3A, UDR3)
+#endif
+
+
+#else /* DMX_SIMULATED_USART */
+
+#include <time.h>
+
+//
+// The simulated wire keeps one clock shared by all transports, expressed
+// in cycles of F_OSC. Bytes take 11 bit times (start, 8 data, 2 stop)
+// at the currently selected rate, interrupts are dispatched when they
+// become due and never nest, just like on the AVR.
+//
+
+#define SIM_MAX_TRANSPORTS  DMX_SIM_MAX_PORTS
+#define SIM_MAX_WIRES       ( 2 * DMX_SIM_MAX_PORTS )
+
+// Transmit line of one port wired to the receive line of another
+struct SimWire
+{
+    DMX_Transport   *from;
+    DMX_Transport   *to;
+};
+
+static uint64_t         s_cycles;
+static uint8_t          s_isrDepth;
+static DMX_Transport    *s_transports[SIM_MAX_TRANSPORTS];
+static uint16_t         s_nrTransports;
+static SimWire          s_wires[SIM_MAX_WIRES];
+static uint16_t         s_nrWires;
+
+static uint64_t simNanos ( void )
+{
+    struct timespec ts;
+    clock_gettime ( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t simByteCycles ( uint32_t baud )
+{
+    return (uint32_t)( (11ULL * F_OSC + baud / 2) / baud );
+}
+
+
+void DMX_Transport::attach ( void )
+{
+    if ( m_attached || s_nrTransports >= SIM_MAX_TRANSPORTS )
+        return;
+
+    s_transports[s_nrTransports++] = this;
+    m_attached = true;
+}
+
+uint64_t DMX_Transport::cycles ( void )
+{
+    return s_cycles;
+}
+
+void DMX_Transport::run ( uint64_t cycles )
+{
+    advanceTo ( s_cycles + cycles );
+}
+
+void DMX_Transport::advanceTo ( uint64_t target )
+{
+    for (;;)
+    {
+        uint16_t        first = s_nrTransports;
+        uint64_t        nextAt = 0;
+
+        for ( uint16_t i = 0; i < s_nrTransports; i++ )
+        {
+            uint64_t at;
+
+            if ( s_transports[i]->nextEvent ( at ) && at <= target &&
+                 ( first == s_nrTransports || at < nextAt ) )
+            {
+                first   = i;
+                nextAt  = at;
+            }
+        }
+
+        if ( first == s_nrTransports )
+            break;
+
+        if ( nextAt > s_cycles )
+            s_cycles = nextAt;
+
+        // Every transport due at this cycle gets its event in one pass,
+        // a byte on a bus reaches all of its receivers at once
+        s_transports[first]->processEvent ();
+
+        for ( uint16_t i = first + 1; i < s_nrTransports; i++ )
+        {
+            uint64_t at;
+
+            if ( s_transports[i]->nextEvent ( at ) && at <= s_cycles )
+                s_transports[i]->processEvent ();
+        }
+    }
+
+    if ( target > s_cycles )
+        s_cycles = target;
+}
+
+void DMX_Transport::waitUntil ( uint64_t at )
+{
+    if ( at <= s_cycles )
+        return;
+
+    m_stats.busyWaitCycles += at - s_cycles;
+    advanceTo ( at );
+}
+
+bool DMX_Transport::nextEvent ( uint64_t &at )
+{
+    bool found = false;
+
+    // Interrupts are held off while another handler is running
+    bool interrupts = ( s_isrDepth == 0 );
+    uint64_t rxAt   = m_rxAt[m_rxHead];
+
+    if ( interrupts && m_txc && m_mode == usart::Transmit )
+    {
+        at      = s_cycles;
+        found   = true;
+    }
+
+    // Data register empty is pending for as long as it is empty
+    if ( interrupts && !m_udrFull && m_mode == usart::TransmitBuffered )
+    {
+        at      = s_cycles;
+        found   = true;
+    }
+
+    if ( m_shifting && ( !found || m_shiftDoneAt < at ) )
+    {
+        at      = m_shiftDoneAt;
+        found   = true;
+    }
+
+    if ( interrupts && m_rxCount && ( !found || rxAt < at ) )
+    {
+        at      = rxAt;
+        found   = true;
+    }
+
+    if ( interrupts && m_timerActive && ( !found || m_timerAt < at ) )
+    {
+        at      = m_timerAt;
+        found   = true;
+    }
+
+    return found;
+}
+
+void DMX_Transport::processEvent ( void )
+{
+    if ( m_shifting && m_shiftDoneAt <= s_cycles )
+    {
+        bool isBreak = ( m_rate == usart::BreakRate && m_shift == 0x0 );
+
+        m_shifting = false;
+        m_stats.bytesSent++;
+
+        if ( isBreak )
+        {
+            // Start bit and data bits are low, the stop bits form the MAB
+            uint32_t bit = byteCycles () / 11;
+
+            m_stats.breaksSent++;
+            m_stats.lastBreakCycles = 9 * bit;
+
+            m_mabActive = true;
+            m_mabStart  = s_cycles - 2 * bit;
+        }
+
+        if ( m_onLine )
+            m_onLine ( m_shift, isBreak, s_cycles );
+
+        // Breaks reach the receiver from shiftOut
+        if ( !isBreak )
+            deliverPeers ( m_shift, false, s_cycles );
+
+        // A buffered byte moves into the shift register, else
+        // the transmission is complete
+        if ( m_udrFull )
+            shiftOut ();
+        else
+            m_txc = true;
+
+        return;
+    }
+
+    if ( m_txc && m_mode == usart::Transmit && s_isrDepth == 0 )
+    {
+        m_txc = false;
+        dispatchTx ();
+        return;
+    }
+
+    if ( !m_udrFull && m_mode == usart::TransmitBuffered && s_isrDepth == 0 )
+    {
+        dispatchTx ();
+        return;
+    }
+
+    if ( m_timerActive && m_timerAt <= s_cycles && s_isrDepth == 0 )
+    {
+        m_timerActive = false;
+        dispatchTimer ();
+        return;
+    }
+
+    if ( m_rxCount && m_rxAt[m_rxHead] <= s_cycles && s_isrDepth == 0 )
+    {
+        uint8_t data    = m_rxData[m_rxHead];
+        bool    fe      = m_rxFe[m_rxHead];
+
+        m_rxHead = (m_rxHead + 1) % RxQueueSize;
+        m_rxCount--;
+
+        // Bytes arriving while the receiver is off are lost
+        if ( m_mode == usart::Receive )
+            dispatchRx ( data, fe );
+    }
+}
+
+void DMX_Transport::shiftOut ( void )
+{
+    if ( m_mabActive )
+    {
+        m_stats.lastMabCycles   = (uint32_t)( s_cycles - m_mabStart );
+        m_mabActive             = false;
+    }
+
+    m_shift         = m_udr;
+    m_udrFull       = false;
+    m_shifting      = true;
+    m_shiftDoneAt   = s_cycles + byteCycles ();
+
+    // A 0x00 at the break rate is received as a framing error
+    // one byte time (at the data rate) after its start bit
+    if ( m_rate == usart::BreakRate && m_shift == 0x0 )
+        deliverPeers ( 0x0, true, s_cycles + simByteCycles ( DMX_BAUD_RATE ) );
+}
+
+bool DMX_Transport::txEnabled ( void )
+{
+    return m_mode == usart::Transmit || m_mode == usart::TransmitPolled ||
+           m_mode == usart::TransmitBuffered;
+}
+
+uint32_t DMX_Transport::byteCycles ( void )
+{
+    return simByteCycles ( m_rate == usart::BreakRate ? DMX_BREAK_RATE : DMX_BAUD_RATE );
+}
+
+void DMX_Transport::dispatchTx ( void )
+{
+    uint64_t t0 = simNanos ();
+
+    m_stats.txInterrupts++;
+    s_isrDepth++;
+    DMX_OnTransmitComplete ( m_port );
+    s_isrDepth--;
+
+    m_stats.isrNanos += simNanos () - t0;
+}
+
+void DMX_Transport::dispatchRx ( uint8_t data, bool framingError )
+{
+    uint64_t t0 = simNanos ();
+
+    m_stats.rxInterrupts++;
+    m_stats.bytesReceived++;
+    m_stats.registerAccesses += 2;      // Status and data register reads
+
+    s_isrDepth++;
+    DMX_OnReceive ( m_port, data, framingError );
+    s_isrDepth--;
+
+    m_stats.isrNanos += simNanos () - t0;
+}
+
+void DMX_Transport::dispatchTimer ( void )
+{
+    uint64_t t0 = simNanos ();
+
+    m_stats.timerInterrupts++;
+    s_isrDepth++;
+    DMX_OnTimer ( m_port );
+    s_isrDepth--;
+
+    m_stats.isrNanos += simNanos () - t0;
+}
+
+void DMX_Transport::begin ( void )
+{
+    attach ();
+    m_stats.registerAccesses++;
+}
+
+void DMX_Transport::setMode ( usart::usartMode mode )
+{
+    m_stats.registerAccesses++;
+    m_mode = mode;
+
+    if ( mode == usart::Transmit )
+    {
+        m_stats.registerAccesses++;
+        m_txc = false;
+    }
+
+    // The transmitter takes the pin back from a break that was never
+    // ended (e.g. the port was disabled during a timed break)
+    if ( txEnabled () )
+        m_breakActive = false;
+
+    if ( txEnabled () && m_udrFull && !m_shifting )
+        shiftOut ();
+}
+
+void DMX_Transport::setRate ( usart::usartRate rate )
+{
+    m_stats.registerAccesses += 2;      // UBRRH and UBRRL
+    m_rate = rate;
+}
+
+void DMX_Transport::write ( uint8_t data )
+{
+    m_stats.registerAccesses++;
+    m_udr       = data;
+    m_udrFull   = true;
+
+    if ( txEnabled () && !m_shifting && !m_breakActive )
+        shiftOut ();
+}
+
+void DMX_Transport::writePolled ( uint8_t data )
+{
+    // Wait until data register is empty
+    while ( m_udrFull )
+        waitUntil ( m_shiftDoneAt );
+
+    m_txc = false;
+    write ( data );
+}
+
+void DMX_Transport::flush ( void )
+{
+    // Wait until last byte is send, the way the AVR waits for TXC
+    while ( m_udrFull || m_shifting )
+        waitUntil ( m_shiftDoneAt );
+
+    // Without a byte on its way TXC never comes
+    if ( !m_txc )
+        m_stats.flushHangs++;
+}
+
+void DMX_Transport::beginBreak ( void )
+{
+    m_stats.registerAccesses += 2;
+    m_mode          = usart::Disabled;
+    m_txc           = false;
+    m_breakActive   = true;
+    m_breakStart    = s_cycles;
+
+    // The receiver flags the break once a byte time of low
+    // level has passed
+    deliverPeers ( 0x0, true, s_cycles + simByteCycles ( DMX_BAUD_RATE ) );
+}
+
+void DMX_Transport::endBreak ( void )
+{
+    m_breakActive = false;
+    m_stats.breaksSent++;
+    m_stats.lastBreakCycles = (uint32_t)( s_cycles - m_breakStart );
+
+    m_mabActive = true;
+    m_mabStart  = s_cycles;
+
+    if ( m_onLine )
+        m_onLine ( 0x0, true, s_cycles );
+}
+
+void DMX_Transport::setReadEnablePin ( int8_t pin )
+{
+    m_rePin = pin;
+}
+
+void DMX_Transport::setReadEnable ( uint8_t level )
+{
+    m_reLevel = level;
+}
+
+void DMX_Transport::delay_us ( uint16_t us )
+{
+    waitUntil ( s_cycles + (uint64_t)us * (F_OSC / 1000000UL) );
+}
+
+uint32_t DMX_Transport::micros ( void )
+{
+    return (uint32_t)( s_cycles / (F_OSC / 1000000UL) );
+}
+
+void DMX_Transport::startTimer ( uint16_t us )
+{
+    m_stats.registerAccesses += 5;
+    m_timerActive   = true;
+    m_timerAt       = s_cycles + (uint64_t)us * (F_OSC / 1000000UL);
+}
+
+void DMX_Transport::stopTimer ( void )
+{
+    m_stats.registerAccesses += 2;
+    m_timerActive   = false;
+}
+
+bool DMX_Transport::hasTimer ( void )
+{
+    return true;
+}
+
+void DMX_Transport::inject ( uint8_t data, bool framingError )
+{
+    uint64_t at = m_rxCount && m_rxLastAt > s_cycles ? m_rxLastAt : s_cycles;
+
+    deliver ( data, framingError, 
+              at + simByteCycles ( framingError ? DMX_BREAK_RATE : DMX_BAUD_RATE ) );
+}
+
+void DMX_Transport::deliver ( uint8_t data, bool framingError, uint64_t at )
+{
+    attach ();
+
+    // Bytes of several transmitters on the line at the same moment
+    // collide, the line only stays high where all of them are high
+    if ( m_rxCount && m_rxLastAt == at )
+    {
+        uint16_t last = (m_rxHead + m_rxCount - 1) % RxQueueSize;
+
+        m_rxData[last]  &= data;
+        m_rxFe[last]    |= framingError;
+        return;
+    }
+
+    if ( m_rxCount >= RxQueueSize )
+        return;
+
+    uint16_t tail = (m_rxHead + m_rxCount) % RxQueueSize;
+
+    m_rxData[tail]  = data;
+    m_rxFe[tail]    = framingError;
+    m_rxAt[tail]    = at;
+    m_rxLastAt      = at;
+    m_rxCount++;
+}
+
+void DMX_Transport::deliverPeers ( uint8_t data, bool framingError, uint64_t at )
+{
+    for ( uint16_t i = 0; i < s_nrWires; i++ )
+        if ( s_wires[i].from == this )
+            s_wires[i].to->deliver ( data, framingError, at );
+}
+
+void DMX_Transport::connect ( DMX_Transport &peer )
+{
+    attach ();
+    peer.attach ();
+
+    if ( s_nrWires >= SIM_MAX_WIRES )
+        return;
+
+    s_wires[s_nrWires].from = this;
+    s_wires[s_nrWires].to   = &peer;
+    s_nrWires++;
+}
+
+void DMX_Transport::onLine ( void (*func)(uint8_t, bool, uint64_t) )
+{
+    attach ();
+    m_onLine = func;
+}
+
+void DMX_Transport::resetStats ( void )
+{
+    memset ( (void *)&m_stats, 0x0, sizeof ( m_stats ) );
+}
+
+#endif /* DMX_SIMULATED_USART */
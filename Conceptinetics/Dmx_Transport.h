@@ -0,0 +1,306 @@
+/*
+  Dmx_Transport.h - DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  Hardware abstraction between the DMX / RDM state machines and the
+  serial line. The state machines in Conceptinetics.cpp never touch
+  USART registers directly, they drive a DMX_Transport instead and are
+  driven back through DMX_OnTransmitComplete and DMX_OnReceive.
+
+  Every DMX port (USART) has its own transport, the port number is
+  passed back into the state machines so each port runs independently.
+
+  Two implementations exist, selected at compile time so the interrupt
+  paths stay free of indirect calls:
+
+  - AVR USART (default when building for an AVR target)
+  - Simulated wire with cycle accounting (DMX_SIMULATED_USART), used
+    when building on a host PC to profile and reproduce timing issues
+*/
+
+
+#ifndef DMX_TRANSPORT_H_
+#define DMX_TRANSPORT_H_
+
+#include <inttypes.h>
+
+#if !defined(__AVR__) && !defined(DMX_SIMULATED_USART)
+    #define DMX_SIMULATED_USART
+#endif
+
+// The simulated wire has a break timer which does not collide with
+// anything else
+#if defined(DMX_SIMULATED_USART) && !defined(USE_DMX_BREAK_TIMER)
+    #define USE_DMX_BREAK_TIMER
+#endif
+
+// Besides the four USARTs the simulated wire creates ports 4 and up the
+// first time they are used, so a population of responders can be put
+// on one line (see DMX_Transport::connect)
+#if defined(DMX_SIMULATED_USART)
+    #define DMX_SIM_MAX_PORTS   256
+#endif
+
+#if defined(DMX_SIMULATED_USART)
+    //
+    // Minimal set of Arduino definitions used by the library
+    // when building on a host PC
+    //
+    #include <stddef.h>
+    #include <string.h>
+
+    #ifndef HIGH
+    #define HIGH                0x1
+    #define LOW                 0x0
+    #endif
+
+    #ifndef F_CPU
+    #define F_CPU               F_OSC
+    #endif
+
+    #define PROGMEM
+    #define memcpy_P            memcpy
+    #define pgm_read_byte(p)    (*(const uint8_t *)(p))
+    #define pgm_read_word(p)    (*(const uint16_t *)(p))
+
+    // Interrupts never preempt application code on the simulated wire
+    #define ATOMIC_BLOCK(type)  for ( uint8_t __todo = 1; __todo; __todo = 0 )
+    #define ATOMIC_RESTORESTATE
+#else
+    #include <util/atomic.h>
+#endif
+
+namespace usart
+{
+    enum usartMode
+    {
+        Disabled,           // Transmitter and receiver off
+        Receive,            // Receiver with RX complete interrupt
+        Transmit,           // Transmitter with TX complete interrupt
+        TransmitPolled,     // Transmitter without interrupts (polled writes)
+        TransmitBuffered,   // Transmitter with data register empty interrupt
+    };
+
+    enum usartRate
+    {
+        DataRate,           // DMX_BAUD_RATE
+        BreakRate,          // DMX_BREAK_RATE, a 0x00 at this rate is a break
+    };
+};
+
+
+#if defined(DMX_SIMULATED_USART)
+//
+// Accounting gathered by the simulated wire, all durations are
+// expressed in cycles of the simulated F_OSC clock unless noted
+//
+struct DMX_TransportStats
+{
+    uint32_t    txInterrupts;       // TX complete interrupts dispatched
+    uint32_t    rxInterrupts;       // RX complete interrupts dispatched
+    uint32_t    bytesSent;          // Bytes shifted out on the line
+    uint32_t    bytesReceived;      // Bytes delivered to the receiver
+    uint32_t    breaksSent;         // Breaks put on the line
+    uint32_t    registerAccesses;   // USART register reads and writes
+    uint64_t    busyWaitCycles;     // Cycles spent in delay_us and polled writes
+    uint64_t    isrNanos;           // Host time spent inside interrupt handlers
+    uint32_t    timerInterrupts;    // Break timer interrupts dispatched
+    uint32_t    lastBreakCycles;    // Length of the last break on the line
+    uint32_t    lastMabCycles;      // Length of the last mark after break
+    uint32_t    flushHangs;         // Flushes that would never return on the AVR
+};
+#endif
+
+
+#if !defined(DMX_SIMULATED_USART)
+// Registers of a single USART (and its break timer), see Dmx_Transport.cpp
+struct DMX_UsartRegs;
+#endif
+
+
+class DMX_Transport
+{
+    public:
+        //
+        // Transports are constant initialized so they can be used from
+        // constructors of global objects regardless of link order
+        //
+#if defined(DMX_SIMULATED_USART)
+        constexpr DMX_Transport ( uint8_t port )
+        : m_port ( port ), m_attached ( false ),
+          m_mode ( usart::Disabled ), m_rate ( usart::DataRate ),
+          m_udr ( 0 ), m_udrFull ( false ), m_shift ( 0 ), m_shifting ( false ),
+          m_shiftDoneAt ( 0 ), m_txc ( false ), m_breakActive ( false ),
+          m_breakStart ( 0 ), m_mabActive ( false ), m_mabStart ( 0 ),
+          m_timerActive ( false ), m_timerAt ( 0 ),
+          m_rxData (), m_rxFe (), m_rxAt (), m_rxHead ( 0 ), m_rxCount ( 0 ),
+          m_rxLastAt ( 0 ), m_rePin ( -1 ), m_reLevel ( LOW ), m_stats (),
+          m_onLine ( NULL )
+        {};
+#else
+        constexpr DMX_Transport ( uint8_t port )
+        : m_port ( port ), m_rePin ( -1 )
+        {};
+#endif
+
+        uint8_t getPort ( void ) { return m_port; };
+
+        // Configure the USART for DMX512 frames (8N2)
+        void    begin ( void );
+
+        // Switching to Transmit discards a pending TX complete, the
+        // interrupt only fires for bytes written from then on
+        void    setMode ( usart::usartMode mode );
+        void    setRate ( usart::usartRate rate );
+
+        // Put a byte into the transmit data register
+        void    write ( uint8_t data );
+
+        // Wait until the data register is empty and write the byte,
+        // only to be used in TransmitPolled mode
+        void    writePolled ( uint8_t data );
+
+        // Wait until the last byte written has left the shift register
+        // (TXC). TXC is cleared by its interrupt, by Transmit mode and
+        // by beginBreak, without a byte on its way the wait never ends
+        void    flush ( void );
+
+        // Hold the TX line low as GPIO (break) and release it again (mark),
+        // the transmitter is disabled and a pending TX complete discarded
+        void    beginBreak ( void );
+        void    endBreak ( void );
+
+        // Pin that switches the line driver between read and write
+        void    setReadEnablePin ( int8_t pin );
+        void    setReadEnable ( uint8_t level );
+
+        // Busy wait, the CPU is stalled for the whole period
+        void    delay_us ( uint16_t us );
+
+        // Time base in microseconds, safe to call from interrupt context
+        uint32_t micros ( void );
+
+#if defined(USE_DMX_BREAK_TIMER)
+        // One shot hardware timer, DMX_OnTimer is invoked from the
+        // compare interrupt once the period expired
+        void    startTimer ( uint16_t us );
+        void    stopTimer ( void );
+
+        // Not every USART has a timer assigned (see Dmx_Transport.cpp)
+        bool    hasTimer ( void );
+#endif
+
+#if defined(DMX_SIMULATED_USART)
+    public:
+        //
+        // Simulation controls, only available in host builds
+        //
+
+        // Current simulated time in F_OSC cycles
+        static uint64_t cycles ( void );
+
+        // Let the simulated clock run, dispatching the TX / RX interrupts
+        // that become due in this period
+        static void     run ( uint64_t cycles );
+
+        // Queue a byte on our receive line, framingError marks a break
+        void            inject ( uint8_t data, bool framingError = false );
+
+        // Wire our transmit line to the receive line of another port,
+        // bytes and breaks arrive there the moment they leave us. A line
+        // can be wired to many ports (a bus), bytes several ports put on
+        // a line at the same moment arrive as their wired AND
+        void            connect ( DMX_Transport &peer );
+
+        // Observe every byte (or break) leaving the transmit line
+        void            onLine ( void (*func)(uint8_t data, bool isBreak, uint64_t cycle) );
+
+        const DMX_TransportStats &getStats ( void ) { return m_stats; };
+        void            resetStats ( void );
+
+    private:
+        static void     advanceTo ( uint64_t target );
+
+        void            attach ( void );
+        void            deliver ( uint8_t data, bool framingError, uint64_t at );
+        void            deliverPeers ( uint8_t data, bool framingError, uint64_t at );
+
+        bool            nextEvent ( uint64_t &at );
+        void            processEvent ( void );
+        void            waitUntil ( uint64_t at );
+        void            shiftOut ( void );
+        uint32_t        byteCycles ( void );
+        bool            txEnabled ( void );
+        void            dispatchTx ( void );
+        void            dispatchRx ( uint8_t data, bool framingError );
+        void            dispatchTimer ( void );
+
+        uint8_t             m_port;
+        bool                m_attached;     // Known to the simulation clock
+
+        usart::usartMode    m_mode;
+        usart::usartRate    m_rate;
+
+        uint8_t             m_udr;          // Transmit data register
+        bool                m_udrFull;
+        uint8_t             m_shift;        // Byte in the shift register
+        bool                m_shifting;
+        uint64_t            m_shiftDoneAt;
+        bool                m_txc;          // TX complete flag pending
+        bool                m_breakActive;  // TX line held low as GPIO
+        uint64_t            m_breakStart;
+        bool                m_mabActive;    // Line idle after a break
+        uint64_t            m_mabStart;
+
+        bool                m_timerActive;
+        uint64_t            m_timerAt;
+
+        enum { RxQueueSize = 1024 };  // Room for a couple of full frames
+        uint8_t             m_rxData[RxQueueSize];
+        bool                m_rxFe[RxQueueSize];
+        uint64_t            m_rxAt[RxQueueSize];    // Arrival of every byte
+        uint16_t            m_rxHead;
+        uint16_t            m_rxCount;
+        uint64_t            m_rxLastAt;
+
+        int8_t              m_rePin;
+        uint8_t             m_reLevel;
+
+        DMX_TransportStats  m_stats;
+        void                (*m_onLine)(uint8_t, bool, uint64_t);
+#else
+    private:
+        uint8_t             m_port;
+        int8_t              m_rePin;
+#endif
+};
+
+
+//
+// Entry points of the DMX / RDM state machines, invoked from the USART
+// interrupt vectors or the simulated wire of the given port. In
+// TransmitBuffered mode the data register empty interrupt invokes
+// DMX_OnTransmitComplete as well
+//
+void DMX_OnTransmitComplete ( uint8_t port );
+void DMX_OnReceive ( uint8_t port, uint8_t data, bool framingError );
+void DMX_OnTimer ( uint8_t port );
+
+
+#endif /* DMX_TRANSPORT_H_ */
@@ -21,9 +21,22 @@
 #ifndef RDM_DEFINES_H_
 #define RDM_DEFINES_H_
 
+#include <stddef.h>
 #include "Rdm_Uid.h"
 
 #define RDM_MAX_DEVICELABEL_LENGTH 32
+#define RDM_MAX_DESCRIPTION_LENGTH 32
+
+#define RDM_ALL_SENSORS         0xff    // Sensor number addressing all sensors
+
+#define RDM_ROOT_DEVICE         0x0000  // Sub-device field of the root device
+#define RDM_ALL_SUBDEVICES      0xffff  // Sub-device field addressing all sub-devices
+#define RDM_MAX_SUBDEVICES      512
+
+// Messages are laid out as on the wire, the fields are all made of bytes
+// so nothing is aligned. The attribute keeps it that way when a field
+// of another type slips in
+#define RDM_PACKED              __attribute__((packed))
 
 namespace rdm
 {
@@ -64,7 +77,7 @@ namespace rdm
         // Category - RDM Information
         // ** Only required if supporting parameters 
         //    beyond the minimum required set
-        SupportedParameters             = 0x0005,   // Get, **Required
+        SupportedParameters             = 0x0050,   // Get, **Required
         ParameterDescription            = 0x0051,   // Get, **Required
     
         // Category = Product Information
@@ -73,8 +86,8 @@ namespace rdm
         DeviceModelDescription          = 0x0080,   // Get
         ManufacturerLabel               = 0x0081,   // Get
         DeviceLabel                     = 0x0082,   // Get, Set
-        FactoryDefaults                 = 0x0009,   // Get, Set **
-        SoftwareVersionLabel            = 0x000c,   // Get
+        FactoryDefaults                 = 0x0090,   // Get, Set **
+        SoftwareVersionLabel            = 0x00c0,   // Get
       
         // Category - DMX512 Setup
         DmxPersonality                  = 0x00e0,   // Get, Set
@@ -85,6 +98,10 @@ namespace rdm
         DefaultSlotValue                = 0x0122,   // Get
 
         // Category - Sensors
+        SensorDefinition                = 0x0200,   // Get
+        SensorValue                     = 0x0201,   // Get, Set
+        RecordSensors                   = 0x0202,   // Set
+
         // Category - Dimmer Settings
         // Category - Power/Lamp Settings
         // Category - Display Settings
@@ -99,6 +116,115 @@ namespace rdm
     };
 
 
+    // Properties of a parameter in a parameter table (RDM_Parameter)
+    enum RdmParameterFlags
+    {
+        ParameterDiscovery          = 0x01,     // Accepts DISCOVERY_COMMAND
+        ParameterGet                = 0x02,     // Accepts GET_COMMAND
+        ParameterSet                = 0x04,     // Accepts SET_COMMAND
+        ParameterRequired           = 0x08,     // Required for every device, not 
+                                                // listed in SUPPORTED_PARAMETERS
+        ParameterSensor             = 0x10,     // Only when sensors are registered
+        ParameterSubDevice          = 0x20,     // Handled for sub-devices as well
+    };
+
+    enum RdmSensorTypes
+    {
+        SensorTemperature           = 0x00,
+        SensorVoltage,
+        SensorCurrent,
+        SensorFrequency,
+        SensorResistance,
+        SensorPower,
+        SensorMass,
+        SensorLength,
+        SensorArea,
+        SensorVolume,
+        SensorDensity,
+        SensorVelocity,
+        SensorAcceleration,
+        SensorForce,
+        SensorEnergy,
+        SensorPressure,
+        SensorTime,
+        SensorAngle,
+        SensorPositionX,
+        SensorPositionY,
+        SensorPositionZ,
+        SensorAngularVelocity,
+        SensorLuminousIntensity,
+        SensorLuminousFlux,
+        SensorIlluminance,
+        SensorChrominanceRed,
+        SensorChrominanceGreen,
+        SensorChrominanceBlue,
+        SensorContacts,
+        SensorMemory,
+        SensorItems,
+        SensorHumidity,
+        SensorCounter16Bit,
+        SensorOther                 = 0x7f,
+    };
+
+    enum RdmSensorUnits
+    {
+        UnitsNone                   = 0x00,
+        UnitsCentigrade,
+        UnitsVoltsDC,
+        UnitsVoltsACPeak,
+        UnitsVoltsACRms,
+        UnitsAmpereDC,
+        UnitsAmpereACPeak,
+        UnitsAmpereACRms,
+        UnitsHertz,
+        UnitsOhm,
+        UnitsWatt,
+        UnitsKilogram,
+        UnitsMeters,
+        UnitsMetersSquared,
+        UnitsMetersCubed,
+        UnitsKilogrammesPerMeterCubed,
+        UnitsMetersPerSecond,
+        UnitsMetersPerSecondSquared,
+        UnitsNewton,
+        UnitsJoule,
+        UnitsPascal,
+        UnitsSecond,
+        UnitsDegree,
+        UnitsSteradian,
+        UnitsCandela,
+        UnitsLumen,
+        UnitsLux,
+        UnitsIre,
+        UnitsByte,
+    };
+
+    enum RdmSensorPrefix
+    {
+        PrefixNone                  = 0x00,
+        PrefixDeci,
+        PrefixCenti,
+        PrefixMilli,
+        PrefixMicro,
+        PrefixNano,
+        PrefixPico,
+        PrefixFempto,
+        PrefixAtto,
+        PrefixZepto,
+        PrefixYocto,
+        PrefixDeca                  = 0x11,
+        PrefixHecto,
+        PrefixKilo,
+        PrefixMega,
+        PrefixGiga,
+        PrefixTera,
+        PrefixPeta,
+        PrefixExa,
+        PrefixZetta,
+        PrefixYotta,
+    };
+
+
     enum RdmStatusTypes
     {
         StatusNone              = 0x00,
@@ -110,6 +236,27 @@ namespace rdm
         StatusWarningCleared,
         StatusErrorCleared,
     };
+
+    // Status message ids (Table B-2), the data values of a status
+    // message give details
+    enum RdmStatusMessageIds
+    {
+        StsCalFail                  = 0x0001,   // Slot label failed calibration
+        StsSensNotFound             = 0x0002,   // Slot label sensor not found
+        StsSensAlwaysOn             = 0x0003,   // Slot label sensor always on
+        StsLampDoused               = 0x0011,   // Lamp doused
+        StsLampStrike               = 0x0012,   // Lamp failed to strike
+        StsOvertemp                 = 0x0021,   // Sensor value1 over temp at value2 degrees C
+        StsUndertemp                = 0x0022,   // Sensor value1 under temp at value2 degrees C
+        StsSensOutRange             = 0x0023,   // Sensor value1 out of range
+        StsOvercurrent              = 0x0033,   // Phase value1 over current at value2 A
+        StsUndercurrent             = 0x0034,   // Phase value1 under current at value2 A
+        StsBreakerTrip              = 0x0042,   // Module breaker trip
+        StsDimFailure               = 0x0044,   // Dimmer failure
+        StsReady                    = 0x0050,   // Slot label ready
+        StsNotReady                 = 0x0051,   // Slot label not ready
+        StsLowFluid                 = 0x0052,   // Slot label low fluid
+    };
    
     enum RdmProductCategory
     {
@@ -233,13 +380,68 @@ namespace rdm
 
 
 #define RDM_HDR_LEN             24      // RDM Message header length ** fixed
-#define RDM_PD_MAXLEN           32      // RDM Maximum parameter data length 1 - 231
 
+// Result of a parameter handler when the request is acknowledged, any
+// other result is a NACK reason (enum RdmNackReasons)
+#define RDM_ACK                 0xff
+
+// Result of a handler which took care of the response itself, the
+// request buffer is left alone (discovery responses are send from it)
+#define RDM_NO_RESPONSE         0xfe
+
+// RDM Maximum parameter data length 19 - 231, it can be lowered to save
+// RAM, longer responses are send in pages (ACK_OVERFLOW) of this size
+#ifndef RDM_PD_MAXLEN
+#define RDM_PD_MAXLEN           231
+#endif
+
+#if RDM_PD_MAXLEN < 19 || RDM_PD_MAXLEN > 231
+#error RDM_PD_MAXLEN must be in the range 19 - 231 (DEVICE_INFO needs 19)
+#endif
+
+// Queued messages a responder holds (power of two, max 128)
+#ifndef RDM_QUEUED_MESSAGES
+#define RDM_QUEUED_MESSAGES     8
+#endif
+
+// Status messages a responder holds (max 8)
+#ifndef RDM_STATUS_MESSAGES
+#define RDM_STATUS_MESSAGES     4
+#endif
+
+#if RDM_STATUS_MESSAGES < 1 || RDM_STATUS_MESSAGES > 8
+#error RDM_STATUS_MESSAGES must be in the range 1 - 8
+#endif
+
+#define RDM_STATUS_MESSAGE_LEN  9       // Size of a status message on the wire
+
+
+//
+// 16 bit field of a message, kept in network order (big endian) so a
+// message is read and written in place on any host. The value is
+// converted when it is read or assigned
+//
+struct RDM_Be16
+{
+    operator uint16_t ( void ) const
+    {
+        return ( (uint16_t)b[0] << 8 ) | b[1];
+    }
+
+    RDM_Be16 &operator = ( uint16_t v )
+    {
+        b[0] = (uint8_t)( v >> 8 );
+        b[1] = (uint8_t)v;
+        return *this;
+    }
+
+    uint8_t     b[2];
+};
 
 union RDM_Message
 {
     uint8_t         d[ RDM_HDR_LEN + RDM_PD_MAXLEN ];
-    struct
+    struct RDM_PACKED
     {
         uint8_t     startCode;        // 0        SC_RDM
         uint8_t     subStartCode;     // 1        SC_SUB_MESSAGE
@@ -249,25 +451,84 @@ union RDM_Message
         uint8_t     TN;               // 15       Transaction number
         uint8_t     portId;           // 16       Port ID / Response type
         uint8_t     msgCount;         // 17
-        uint16_t    subDevice;        // 18,19    0=root, 0xffff=all
+        RDM_Be16    subDevice;        // 18,19    0=root, 0xffff=all
         uint8_t     CC;               // 20       GET_COMMAND
-        uint16_t    PID;              // 21,22    Parameter ID
+        RDM_Be16    PID;              // 21,22    Parameter ID
         uint8_t     PDL;              // 23       Parameter Data length 1-231 
 
         uint8_t     PD[RDM_PD_MAXLEN];    // Parameter Data ... variable length 
     };
+
+    //
+    // Parameter data in place as one of the RDM_*PD layouts below,
+    // nothing is copied. The layouts are made of bytes (RDM_Uid,
+    // RDM_Be16) and fit any alignment
+    //
+    template <class T> T &view ( void )
+    {
+        static_assert ( alignof ( T ) == 1, "parameter data layouts are made of bytes" );
+        static_assert ( sizeof ( T ) <= RDM_PD_MAXLEN, "layout exceeds the parameter data" );
+
+        return *reinterpret_cast<T *>( PD );
+    }
 };
 
-union RDM_Checksum
+// Header as in table 6-1 ANSI_E1-20-2010
+static_assert ( offsetof ( RDM_Message, dstUid ) == 3 && offsetof ( RDM_Message, srcUid ) == 9 &&
+                offsetof ( RDM_Message, subDevice ) == 18 && offsetof ( RDM_Message, PID ) == 21 &&
+                offsetof ( RDM_Message, PD ) == RDM_HDR_LEN, "RDM message header layout" );
+
+// The message length is a byte, the longest message fits unless
+// RDM_PD_MAXLEN was lowered
+static_assert ( sizeof ( RDM_Message ) == RDM_HDR_LEN + RDM_PD_MAXLEN &&
+                sizeof ( RDM_Message ) <= 0xff, "RDM message size" );
+
+//
+// Writes the parameter data of a response. Handlers always write the
+// full data, the writer skips what was send in earlier pages and flags
+// an overflow when more data is left than fits the message
+//
+class RDM_ParameterWriter
 {
-    uint16_t checksum;
-    struct
-    {
-        uint8_t csl;
-        uint8_t csh;
-    };
+    public:
+        RDM_ParameterWriter ( uint8_t *pd, uint16_t skip = 0 )
+        : m_pd ( pd ), m_skip ( skip ), m_len ( 0 ), m_overflow ( false ) {};
+
+        void put ( uint8_t v )
+        {
+            if ( m_skip )
+                m_skip--;
+            else if ( m_len < RDM_PD_MAXLEN )
+                m_pd[m_len++] = v;
+            else
+                m_overflow = true;
+        }
+
+        void put16 ( uint16_t v )
+        {
+            put ( (uint8_t)( v >> 8 ) );
+            put ( (uint8_t)v );
+        }
+
+        void put ( const uint8_t *data, uint16_t len )
+        {
+            while ( len-- )
+                put ( *data++ );
+        }
+
+        uint8_t length ( void )     { return m_len; };
+        bool    overflow ( void )   { return m_overflow; };
+
+    private:
+        uint8_t     *m_pd;
+        uint16_t    m_skip;
+        uint8_t     m_len;
+        bool        m_overflow;
 };
 
+//
+// Parameter data layouts, see RDM_Message::view
+//
 struct RDM_DiscUniqueBranchPD
 {
     RDM_Uid lbound;
@@ -276,7 +537,7 @@ struct RDM_DiscUniqueBranchPD
 
 struct RDM_DiscMuteUnMutePD
 {
-    uint16_t    ctrlField;
+    RDM_Be16    ctrlField;
 
 // Only for multiple ports
 //    RDM_Uid     bindingUid;
@@ -286,17 +547,81 @@ struct RDM__DeviceInfoPD
 {
     uint8_t     protocolVersionMajor;
     uint8_t     protocolVersionMinor;
-    uint16_t    deviceModelId;
-    uint16_t    ProductCategory;        // enum RdmProductCategory
+    RDM_Be16    deviceModelId;
+    RDM_Be16    ProductCategory;        // enum RdmProductCategory
     uint8_t     SoftwareVersionId[4]; 
-    uint16_t    DMX512FootPrint;
+    RDM_Be16    DMX512FootPrint;
     uint8_t     DMX512CurrentPersonality;
     uint8_t     DMX512NumberPersonalities;
-    uint16_t    DMX512StartAddress;
-    uint16_t    SubDeviceCount;
+    RDM_Be16    DMX512StartAddress;
+    RDM_Be16    SubDeviceCount;
     uint8_t     SensorCount;
 };
 
+struct RDM_DmxStartAddressPD
+{
+    RDM_Be16    address;
+};
+
+struct RDM_SensorValuePD
+{
+    uint8_t     sensor;
+    RDM_Be16    present;                // int16_t
+    RDM_Be16    lowest;
+    RDM_Be16    highest;
+    RDM_Be16    recorded;
+};
+
+// Response type ACK_TIMER, estimate in 100ms units
+struct RDM_AckTimerPD
+{
+    RDM_Be16    estimate;
+};
+
+// Response type NACK_REASON, enum RdmNackReasons
+struct RDM_NackReasonPD
+{
+    RDM_Be16    reason;
+};
+
+static_assert ( sizeof ( RDM_DiscUniqueBranchPD ) == 12 && sizeof ( RDM__DeviceInfoPD ) == 19 &&
+                sizeof ( RDM_SensorValuePD ) == 9, "RDM parameter data layout" );
+
+//
+// Definition of a sensor as reported by SENSOR_DEFINITION, kept in
+// PROGMEM (see RDM_Responder::addSensor)
+//
+struct RDM_SensorDefinition
+{
+    uint8_t     type;           // enum RdmSensorTypes
+    uint8_t     unit;           // enum RdmSensorUnits
+    uint8_t     prefix;         // enum RdmSensorPrefix
+    int16_t     rangeMin;       // Range the sensor can measure
+    int16_t     rangeMax;
+    int16_t     normalMin;      // Range of normal operation
+    int16_t     normalMax;
+    const char  *description;   // PROGMEM string of at most 32 characters
+};
+
+//
+// Message queued for a controller, it receives the GET response
+// of the parameter
+//
+struct RDM_QueuedMessage
+{
+    uint16_t    pid;
+    uint16_t    subDevice;
+};
+
+struct RDM_StatusMessage
+{
+    uint16_t    subDevice;
+    uint8_t     type;           // enum RdmStatusTypes
+    uint16_t    id;             // enum RdmStatusMessageIds
+    int16_t     value1;
+    int16_t     value2;
+};
+
 struct RDM_DeviceGetPersonality_PD
 {
     uint8_t     DMX512CurrentPersonality;
@@ -26,8 +26,24 @@
 //
 //48 bit UID Representation to identify RDM transponders
 //
+// The bytes are kept in network order so the UID can be part of a
+// packed RDM message. Comparisons work on the UID as a single 48 bit
+// number, the manufacturer id makes up the upper 16 bits
+//
 struct RDM_Uid {
 
+    // UID of a 48 bit number, constant initializable
+    static constexpr RDM_Uid fromInt ( uint64_t v )
+    {
+        return RDM_Uid { { (uint8_t)( v >> 40 ), (uint8_t)( v >> 32 ), (uint8_t)( v >> 24 ),
+                           (uint8_t)( v >> 16 ), (uint8_t)( v >> 8 ),  (uint8_t)v } };
+    }
+
+    static constexpr RDM_Uid make ( uint16_t m, uint32_t d )
+    {
+        return fromInt ( ( (uint64_t)m << 32 ) | d );
+    }
+
     void Initialize ( uint16_t m, uint8_t d1, uint8_t d2, uint8_t d3, uint8_t d4 ) 
     {
 		m_id[0]  = ((uint8_t) (((uint16_t) (m)) >> 8));
@@ -44,13 +60,25 @@ struct RDM_Uid {
             m_id[i] = orig.m_id[i];
     }
 
+    constexpr uint16_t manufacturer ( void ) const
+    {
+        return ( (uint16_t)m_id[0] << 8 ) | m_id[1];
+    }
+
+    constexpr uint32_t device ( void ) const
+    {
+        return ( (uint32_t)m_id[2] << 24 ) | ( (uint32_t)m_id[3] << 16 ) |
+               ( (uint16_t)m_id[4] << 8 ) | m_id[5];
+    }
+
+    constexpr uint64_t toInt ( void ) const
+    {
+        return ( (uint64_t)manufacturer () << 32 ) | device ();
+    }
+
 	bool operator == ( const RDM_Uid & orig ) const
 	{
-		for ( uint8_t i = 0; i < 6; i++ )
-			if ( m_id[i] != orig.m_id[i] )
-				return false;
-
-        return true;
+        return toInt () == orig.toInt ();
 	}
 
 	bool operator != ( const RDM_Uid & orig ) const
@@ -60,35 +88,44 @@ struct RDM_Uid {
 
 	bool operator < ( const RDM_Uid & v ) const
 	{
-		for ( uint8_t i = 0; i < 6; i++ )
-			if ( m_id[i] != v.m_id[i] )
-				return ( m_id[i] < v.m_id[i] );
+        return toInt () < v.toInt ();
 	}
 
-	bool operator > ( const RDM_Uid & v ) 
+	bool operator > ( const RDM_Uid & v ) const
     {
-		for ( uint8_t i = 0; i < 6; i++ )
-			if ( m_id[i] != v.m_id[i] )
-				return ( m_id[i] > v.m_id[i] );
+        return toInt () > v.toInt ();
 	}
 
+    // Inside lo - hi (bounds included), never when lo is above hi
+    bool within ( const RDM_Uid &lo, const RDM_Uid &hi ) const
+    {
+        uint64_t v = toInt ();
+
+        return ( v >= lo.toInt () ) & ( v <= hi.toInt () );
+    }
+
+    //
+    // Hash for UID tables, the low bits can be used for any power of
+    // two table size. UIDs of a manufacturer mostly differ in the low 
+    // device bits, the multiply spreads them over the whole hash
+    //
+    uint16_t hash ( void ) const
+    {
+        uint32_t h = ( device () ^ ( (uint32_t)manufacturer () << 7 ) ) * 0x9e3779b1UL;
+
+        return (uint16_t)( h >> 16 );
+    }
+
     // 
     // match_mid = manufacturer id to match
     //
-    bool isBroadcast ( uint8_t match_mid[2] )
+    bool isBroadcast ( const uint8_t match_mid[2] ) const
     {
-        // Check for genuine broadcast on device part
-        for ( uint8_t i = 2; i < 6; i++ )
-            if ( m_id[i] != 0xff )
-                return false;
+        uint16_t mid = manufacturer ();
 
         // Broadcast or manufacturer designated broadcast
-        if ( (m_id[0] == 0xff && m_id[1] == 0xff) ||
-             (m_id[0] == match_mid[0] && m_id[1] == match_mid[1]) )
-             return true;
-        
-        // No broadcast    
-        return false;
+        return device () == 0xffffffffUL &&
+               ( mid == 0xffff || mid == ( ( (uint16_t)match_mid[0] << 8 ) | match_mid[1] ) );
     }
 
 	uint8_t   m_id[6];     //16bit manufacturer id + 32 bits device id
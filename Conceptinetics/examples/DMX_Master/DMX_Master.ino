@@ -65,6 +65,11 @@ void setup() {
   // Enable DMX master interface and start transmitting
   dmx_master.enable ();  
   
+  // Uncomment to time breaks (176 uSec) and mark after break (12 uSec)
+  // with hardware timer 1, this requires USE_DMX_BREAK_TIMER to be 
+  // defined in Conceptinetics.h
+  // dmx_master.setTimedBreakMode ( 176, 12 );
+  
   // Set channel 1 - 50 @ 50%
   dmx_master.setChannelRange ( 2, 25, 127 );
 }
@@ -0,0 +1,108 @@
+/*
+  DMX_Master_Benchmark.ino - Example code for using the Conceptinetics DMX library
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <Conceptinetics.h>
+
+//
+// MEGA2560 ONLY
+//
+// Measures the CPU cycles the transmit interrupt costs per slot for
+// both transmit modes. DMX is sent on serial port 1 and the results
+// are printed on Serial (port 0), so enable in Conceptinetics.h:
+//
+//   //#define USE_DMX_SERIAL_0
+//   #define USE_DMX_SERIAL_1
+//
+// The cycles taken by interrupts are missing from the main loop, an
+// idle run without DMX gives the cost of a single loop iteration and
+// the difference with a run while transmitting gives the cycles spent
+// in the interrupts. Timer 0 (millis) runs during both runs and drops
+// out of the result.
+//
+// tests/Makefile (make bench) builds the sketch on the PC against the
+// simulated serial port, the cycles are those of the PC counted at
+// F_CPU and only compare the two modes.
+//
+
+#define DMX_MASTER_CHANNELS   512
+#define RXEN_PIN              2
+#define DMX_PORT              1
+
+#define RUN_MS                2000
+
+DMX_Master dmx_master ( DMX_MASTER_CHANNELS, RXEN_PIN, DMX_PORT );
+
+//
+// Count loop iterations for RUN_MS milliseconds
+//
+uint32_t countIterations ( void )
+{
+  volatile uint32_t count = 0;
+  uint32_t start = millis ();
+
+  while ( millis () - start < RUN_MS )
+    count++;
+
+  return count;
+}
+
+void measure ( const char *name, uint32_t idle )
+{
+  uint32_t busy     = countIterations ();
+  uint32_t slots    = (uint32_t)dmx_master.getFrameRate () * dmx_master.getFrameSize ();
+
+  // Cycles per loop iteration and cycles taken by the interrupts per second
+  float    perIteration = (float)F_CPU * RUN_MS / 1000 / idle;
+  float    isrPerSecond = (float)(idle - busy) * perIteration * 1000 / RUN_MS;
+
+  Serial.print ( name );
+  Serial.print ( ": " );
+  Serial.print ( dmx_master.getFrameRate () );
+  Serial.print ( " frames/s, " );
+  Serial.print ( slots );
+  Serial.print ( " slots/s, " );
+  Serial.print ( isrPerSecond / slots, 1 );
+  Serial.print ( " cycles/slot, CPU load " );
+  Serial.print ( 100.0 * isrPerSecond / F_CPU, 1 );
+  Serial.println ( "%" );
+}
+
+void setup() {             
+  
+  Serial.begin ( 115200 );
+
+  uint32_t idle = countIterations ();
+
+  dmx_master.setTransmitMode ( dmx::dmxTransmitComplete );
+  dmx_master.enable ();
+  delay ( 100 );
+  measure ( "TX complete", idle );
+  dmx_master.disable ();
+
+  dmx_master.setTransmitMode ( dmx::dmxDataRegisterEmpty );
+  dmx_master.enable ();
+  delay ( 100 );
+  measure ( "Data register empty", idle );
+  dmx_master.disable ();
+}
+
+void loop() 
+{
+}
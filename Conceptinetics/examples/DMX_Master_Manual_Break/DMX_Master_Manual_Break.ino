@@ -100,7 +100,8 @@ void loop()
     // the break and then automaticly continue sending the
     // next frame.
     // Your application will block for a period 
-    // length of a break and mark after break
+    // length of a break and mark after break, unless
+    // USE_DMX_BREAK_TIMER is defined in Conceptinetics.h
     dmx_master.breakAndContinue ( break_usec );
   }  
   
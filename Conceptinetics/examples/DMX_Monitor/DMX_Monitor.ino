@@ -0,0 +1,91 @@
+/*
+  DMX_Monitor.ino - Example code for using the Conceptinetics DMX library
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <Conceptinetics.h>
+
+//
+// MEGA2560 ONLY
+//
+// On-site diagnostics, serial port 1 records every frame on the line
+// (any start code) and the timings are reported on Serial (port 0) 
+// at 115200 baud. 
+//
+// Enable port 1 in Conceptinetics.h by uncommenting:
+//
+//   #define USE_DMX_SERIAL_1
+//
+// and leave USE_DMX_SERIAL_0 disabled so Serial remains available
+//
+
+// Pin switching the transceiver of port 1 between read and write mode
+#define RXEN_PIN            2
+
+// Record up to 4 frames of up to 32 slots (start code included),
+// timings are measured over the full frame anyway
+DMX_Monitor dmx_monitor ( 4, 32, RXEN_PIN, 1 );
+
+// the setup routine runs once when you press reset:
+void setup() {             
+  
+  Serial.begin ( 115200 );
+
+  dmx_monitor.enable ();  
+}
+
+// the loop routine runs over and over again forever:
+void loop() 
+{
+  const DMX_MonitorFrame *frame = dmx_monitor.getFrame ();
+
+  if ( !frame )
+    return;
+
+  //
+  // EXAMPLE DESCRIPTION
+  //
+  // Print the start code, the number of slots and the timings of
+  // every frame followed by the first slots. Printing is slow so
+  // frames will be dropped when the ring is full
+  //
+  Serial.print ( "SC 0x" );
+  Serial.print ( frame->getStartCode (), HEX );
+  Serial.print ( " slots " );
+  Serial.print ( frame->slots );
+  Serial.print ( " break+MAB " );
+  Serial.print ( frame->breakToStart );
+  Serial.print ( "us slot " );
+  Serial.print ( frame->getSlotTime () );
+  Serial.print ( "us period " );
+  Serial.print ( frame->framePeriod );
+  Serial.print ( "us dropped " );
+  Serial.print ( dmx_monitor.getDroppedFrames () );
+  Serial.print ( " :" );
+
+  for ( uint16_t i = 1; i < frame->recorded; i++ )
+  {
+    Serial.print ( ' ' );
+    Serial.print ( frame->data[i] );
+  }
+
+  Serial.println ();
+
+  // Hand the frame back for recording
+  dmx_monitor.release ();
+}
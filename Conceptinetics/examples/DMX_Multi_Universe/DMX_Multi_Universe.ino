@@ -0,0 +1,73 @@
+/*
+  DMX_Multi_Universe.ino - Example code for using the Conceptinetics DMX library
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <Conceptinetics.h>
+
+//
+// MEGA2560 ONLY
+//
+// Every USART of the MEGA can run its own DMX universe. In this
+// example serial port 1 receives a universe and serial ports 2 and 3
+// transmit two universes built from it.
+//
+// Enable the ports in Conceptinetics.h by uncommenting:
+//
+//   #define USE_DMX_SERIAL_1
+//   #define USE_DMX_SERIAL_2
+//   #define USE_DMX_SERIAL_3
+//
+// (USE_DMX_SERIAL_0 can stay disabled so Serial remains available)
+//
+// Every port needs its own RS485 transceiver, the read enable
+// pins below switch them between read and write mode
+//
+
+#define DMX_CHANNELS        32
+
+// Configure a DMX slave on port 1 and two masters on port 2 and 3
+DMX_Slave  dmx_input   ( DMX_CHANNELS, 2, 1 );
+DMX_Master dmx_out_a   ( DMX_CHANNELS, 3, 2 );
+DMX_Master dmx_out_b   ( DMX_CHANNELS, 4, 3 );
+
+// the setup routine runs once when you press reset:
+void setup() {             
+  
+  dmx_input.enable ();  
+  dmx_out_a.enable ();
+  dmx_out_b.enable ();
+}
+
+// the loop routine runs over and over again forever:
+void loop() 
+{
+  //
+  // EXAMPLE DESCRIPTION
+  //
+  // Universe A is a copy of the incoming universe, universe B
+  // holds the inverted values
+  //
+  for ( int i = 1; i <= DMX_CHANNELS; i++ )
+  {
+    uint8_t value = dmx_input.getChannelValue ( i );
+
+    dmx_out_a.setChannelValue ( i, value );
+    dmx_out_b.setChannelValue ( i, 255 - value );
+  }
+}
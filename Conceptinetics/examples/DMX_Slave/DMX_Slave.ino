@@ -68,6 +68,10 @@ const int ledPin = 13;
 // the setup routine runs once when you press reset:
 void setup() {             
   
+  // Uncomment to only see complete frames, channel values
+  // change once a full frame has been received
+  // dmx_slave.setDoubleBuffered ( true );
+
   // Enable DMX slave interface and start recording
   // DMX data
   dmx_slave.enable ();  
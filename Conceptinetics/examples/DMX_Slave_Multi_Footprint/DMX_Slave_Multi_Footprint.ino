@@ -0,0 +1,96 @@
+/*
+  DMX_Slave_Multi_Footprint.ino - Example code for using the Conceptinetics DMX library
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <Conceptinetics.h>
+
+//
+// A 4 head LED bar where every head has its own RGB footprint and
+// start address. All heads share the same DMX input, every incoming
+// frame is dispatched into the footprints of all heads at once.
+//
+// Footprints may overlap, but the receiver is cheapest when they
+// don't (only one footprint is receiving at any time)
+//
+
+#define HEADS               4
+#define HEAD_CHANNELS       3
+
+//
+// Pin number to change read or write mode on the shield
+// Uncomment the following line if you choose to control 
+// read and write via a pin
+//
+///// #define RXEN_PIN                2
+
+// Configure a DMX slave for every head, they all run on the
+// default port. The read enable pin only needs to be passed once
+DMX_Slave dmx_head1 ( HEAD_CHANNELS );
+DMX_Slave dmx_head2 ( HEAD_CHANNELS );
+DMX_Slave dmx_head3 ( HEAD_CHANNELS );
+DMX_Slave dmx_head4 ( HEAD_CHANNELS );
+
+// If you are using an IO pin to control the shields RXEN
+// the use the following line instead for the first head
+///// DMX_Slave dmx_head1 ( HEAD_CHANNELS , RXEN_PIN );
+
+DMX_Slave *dmx_heads[HEADS] = { &dmx_head1, &dmx_head2, &dmx_head3, &dmx_head4 };
+
+// PWM pins driving the red, green and blue LED of every head
+// (MEGA2560 pin numbers)
+const int ledPins[HEADS][HEAD_CHANNELS] = 
+{
+    { 3, 5, 6 }, { 7, 8, 9 }, { 10, 11, 12 }, { 44, 45, 46 }
+};
+
+// the setup routine runs once when you press reset:
+void setup() {             
+  
+  for ( int h = 0; h < HEADS; h++ )
+  {
+    // Every head is addressed independently, here the heads 
+    // are placed 10 channels apart starting at address 1
+    dmx_heads[h]->setStartAddress ( 1 + h * 10 );
+    dmx_heads[h]->enable ();
+
+    for ( int c = 0; c < HEAD_CHANNELS; c++ )
+      pinMode ( ledPins[h][c], OUTPUT );
+  }
+}
+
+// the loop routine runs over and over again forever:
+void loop() 
+{
+  //
+  // EXAMPLE DESCRIPTION
+  //
+  // Every head shows the color of its own footprint
+  //
+  for ( int h = 0; h < HEADS; h++ )
+  {
+    uint8_t rgb[HEAD_CHANNELS];
+
+    // NOTE:
+    // getChannels is relative to the start address of the head
+    dmx_heads[h]->getChannels ( 1, rgb, HEAD_CHANNELS );
+
+    for ( int c = 0; c < HEAD_CHANNELS; c++ )
+      analogWrite ( ledPins[h][c], rgb[c] );
+  }
+}
@@ -65,8 +65,8 @@ DMX_Slave dmx_slave ( DMX_SLAVE_CHANNELS );
 
 const int ledPin = 13;
 
-unsigned long       lastFrameReceivedTime;
-const unsigned long dmxTimeoutMillis = 10000UL;
+const unsigned int  dmxTimeoutMillis = 10000U;
+const unsigned int  dmxFadeMillis    = 2000U;
 
 
 // the setup routine runs once when you press reset:
@@ -81,7 +81,15 @@ void setup() {
   dmx_slave.setStartAddress (1);
   
   //
-  // Register on frame complete event to determine signal timeout
+  // If we didn't receive a DMX frame within the timeout period 
+  // fade all dmx channels to zero. Other policies are 
+  // dmx::dmxHoldLastLook (default) and dmx::dmxPresetScene
+  // (see setLossScene)
+  //
+  dmx_slave.setSignalLoss ( dmx::dmxFadeToZero, dmxTimeoutMillis, dmxFadeMillis );
+
+  //
+  // Register on frame complete event
   //
   dmx_slave.onReceiveComplete ( OnFrameReceiveComplete );
   
@@ -92,13 +100,12 @@ void setup() {
 // the loop routine runs over and over again forever:
 void loop() 
 {
-   // Get current time
-   unsigned long now = millis();
- 
-   // If we didn't receive a DMX frame within the timeout period 
-   // clear all dmx channels
-   if ( now - lastFrameReceivedTime > dmxTimeoutMillis )
-       dmx_slave.getBuffer().clear();
+   // The signal state tells whether frames are arriving, 
+   // getFrameRate returns the received frames per second
+   if ( dmx_slave.getSignalState () != dmx::dmxSignalPresent )
+   {
+       // No signal, channel values follow the signal loss policy
+   }
  
   //
   // EXAMPLE DESCRIPTION
@@ -127,8 +134,5 @@ void OnFrameReceiveComplete (unsigned short channelsReceived)
     // waiting for, master might have transmitted less
     // channels
   }
-
-  // Update receive time to determine signal timeout
-  lastFrameReceivedTime = millis ();
 }
 
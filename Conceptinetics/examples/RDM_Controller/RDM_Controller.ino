@@ -0,0 +1,113 @@
+/*
+  RDM_Controller.ino - Example code for using the Conceptinetics DMX library
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <Conceptinetics.h>
+
+//
+// RDM controller next to a DMX master. All responders on the line are
+// discovered at startup, afterwards they are asked to identify
+// themselves one after the other for a couple of seconds each.
+//
+// RDM requests go out between the DMX frames, the master keeps
+// transmitting while the controller is busy. Discovery waits 5.8ms
+// for every branch of the UID space it asks, expect a couple of 
+// seconds per hundred responders.
+//
+// Afterwards the line is swept in the background, responders which
+// are plugged in (or power cycled) are found within a couple of 
+// sweeps and responders which disappear are dropped from the list.
+// The DMX frame rate is kept above MIN_FRAME_RATE meanwhile.
+//
+// The RXEN jumper of the shield has to be placed towards pin 2, the
+// controller switches the line driver to receive for the responses
+//
+
+#define DMX_MASTER_CHANNELS   24
+#define RXEN_PIN              2
+
+#define IDENTIFY_MS           3000
+#define SWEEP_INTERVAL_MS     100
+#define MIN_FRAME_RATE        30
+
+DMX_Master        dmx_master ( DMX_MASTER_CHANNELS, RXEN_PIN );
+RDM_Controller    rdm_controller ( dmx_master, 0x0707, 0x0, 0x0, 0x0, 0x1 );
+
+uint16_t          identifying = 0;
+unsigned long     identifySince = 0;
+
+
+void setup() {             
+
+  pinMode ( LED_BUILTIN, OUTPUT );
+
+  // Uncomment to time breaks with hardware timer 1, the controller
+  // uses the same timer for the RDM timing
+  // dmx_master.setTimedBreakMode ();
+
+  dmx_master.enable ();  
+  dmx_master.setChannelRange ( 1, DMX_MASTER_CHANNELS, 127 );
+
+  rdm_controller.onDeviceFound ( OnDeviceFound );
+  rdm_controller.onDeviceLost ( OnDeviceLost );
+  rdm_controller.setMinFrameRate ( MIN_FRAME_RATE );
+  rdm_controller.setBackgroundDiscovery ( SWEEP_INTERVAL_MS );
+  rdm_controller.startDiscovery ();
+}
+
+void loop() 
+{
+  // Sends the requests and runs the discovery
+  rdm_controller.service ();
+
+  if ( rdm_controller.isDiscovering () || !rdm_controller.getDeviceCount () )
+    return;
+
+  if ( identifying >= rdm_controller.getDeviceCount () )
+    identifying = 0;
+
+  // Next responder identifies itself
+  if ( millis () - identifySince >= IDENTIFY_MS && !rdm_controller.isBusy () )
+  {
+    static uint8_t on = 1;
+
+    if ( rdm_controller.sendRequest ( rdm_controller.getDevice ( identifying ),
+                                      rdm::SetCommand, rdm::IdentifyDevice, &on, 1 ) )
+    {
+      on ^= 1;
+
+      if ( on )
+        identifying = ( identifying + 1 ) % rdm_controller.getDeviceCount ();
+
+      identifySince = millis ();
+    }
+  }
+}
+
+void OnDeviceFound ( const RDM_Uid &uid )
+{
+  // Blink once for every responder found
+  digitalWrite ( LED_BUILTIN, !digitalRead ( LED_BUILTIN ) );
+}
+
+void OnDeviceLost ( const RDM_Uid &uid )
+{
+  // LED stays on while responders are missing
+  digitalWrite ( LED_BUILTIN, HIGH );
+}
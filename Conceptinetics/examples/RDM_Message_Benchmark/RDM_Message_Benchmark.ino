@@ -0,0 +1,125 @@
+/*
+  RDM_Message_Benchmark.ino - Example code for using the Conceptinetics DMX library
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <Conceptinetics.h>
+
+//
+// Measures decoding a SENSOR_VALUE response, the way an RDM_Controller
+// poll handler would. Results are printed on Serial:
+//
+// - Copy of the parameter data into a native struct, swapping every
+//   16 bit field (what was needed before the typed views)
+// - RDM_Message::view, the fields are read in place
+//
+// Both sum the values so the compiler can't drop the work
+//
+
+#define DECODES               20000
+
+// Native layout as a host would declare it
+struct SensorValue
+{
+  uint8_t     sensor;
+  int16_t     present;
+  int16_t     lowest;
+  int16_t     highest;
+  int16_t     recorded;
+};
+
+RDM_Message     msg;
+volatile int32_t sink;
+
+static uint16_t swap16 ( uint16_t v )
+{
+  return ( v << 8 ) | ( v >> 8 );
+}
+
+int32_t decodeCopy ( RDM_Message &m )
+{
+  struct { uint8_t sensor; uint8_t v[8]; } raw;
+  SensorValue sv;
+  uint16_t    w[4];
+
+  memcpy ( &raw, m.PD, sizeof ( raw ) );
+  memcpy ( w, raw.v, sizeof ( w ) );
+
+  sv.sensor   = raw.sensor;
+  sv.present  = swap16 ( w[0] );
+  sv.lowest   = swap16 ( w[1] );
+  sv.highest  = swap16 ( w[2] );
+  sv.recorded = swap16 ( w[3] );
+
+  return sv.sensor + sv.present + sv.lowest + sv.highest + sv.recorded;
+}
+
+int32_t decodeView ( RDM_Message &m )
+{
+  RDM_SensorValuePD &sv = m.view<RDM_SensorValuePD> ();
+
+  return sv.sensor + (int16_t)sv.present + (int16_t)sv.lowest +
+         (int16_t)sv.highest + (int16_t)sv.recorded;
+}
+
+void measure ( const char *name, int32_t (*decode)(RDM_Message &) )
+{
+  int32_t  sum   = 0;
+  uint32_t start = micros ();
+
+  for ( uint16_t i = 0; i < DECODES; i++ )
+  {
+    msg.PD[2] = (uint8_t)i;     // Present value changes every time
+    sum += decode ( msg );
+  }
+
+  uint32_t us = micros () - start;
+  sink = sum;
+
+  Serial.print ( name );
+  Serial.print ( ": " );
+  Serial.print ( (float)us * 1000 / DECODES, 1 );
+  Serial.print ( " ns/decode, sum " );
+  Serial.println ( sum );
+}
+
+void setup() {
+
+  Serial.begin ( 115200 );
+
+  // A SENSOR_VALUE response for sensor 1: 21.5, 18.0, 30.2, 0.0
+  msg.CC        = rdm::GetCommandResponse;
+  msg.PID       = rdm::SensorValue;
+  msg.subDevice = 0;
+  msg.PDL       = sizeof ( RDM_SensorValuePD );
+
+  RDM_SensorValuePD &sv = msg.view<RDM_SensorValuePD> ();
+
+  sv.sensor   = 1;
+  sv.present  = 215;
+  sv.lowest   = 180;
+  sv.highest  = 302;
+  sv.recorded = 0;
+
+  measure ( "Copy and swap", decodeCopy );
+  measure ( "Typed view", decodeView );
+}
+
+void loop()
+{
+}
@@ -71,6 +71,21 @@ RDM_Responder rdm_responder ( 0x0707, 0x1, 0x2, 0x3, 0x4, dmx_slave );
 // Led pin used for identification of this responder via RDM
 const int ledPin = 13;
 
+// Manufacturer specific parameter (0x8000 - 0xffdf) to get and set
+// the speed of our scenic drive (0 - 100%)
+#define PID_DRIVE_SPEED     0x8000
+
+uint8_t driveSpeed = 50;
+
+uint8_t OnDriveSpeed ( RDM_Responder &responder, RDM_Message *msg, RDM_ParameterWriter &pd );
+
+// Table of manufacturer specific parameters, sorted by PID
+const RDM_Parameter parameters[] PROGMEM =
+{
+  // PID              Command classes                      GET SET    Handler
+  { PID_DRIVE_SPEED,  rdm::ParameterGet | rdm::ParameterSet, 0, 1, 1,  OnDriveSpeed },
+};
+
 // the setup routine runs once when you press reset:
 void setup() {             
   
@@ -91,6 +106,9 @@ void setup() {
   
   // Register deveice identification event handler
   rdm_responder.onIdentifyDevice ( OnIdentifyDevice );
+
+  // Add our own parameters
+  rdm_responder.setParameters ( parameters, sizeof ( parameters ) / sizeof ( parameters[0] ) );
   
   // Enable DMX slave interface and start recording (without RDM won't work)
   dmx_slave.enable ();  
@@ -99,6 +117,10 @@ void setup() {
   // it is integrated into the DMX_Slave object)
   rdm_responder.enable ();
   
+  // Uncomment to process RDM requests from loop() (see dmx_slave.service)
+  // instead of the receive interrupt
+  ///// rdm_responder.setDeferred ( true );
+  
   
   // Set led pin as output pin
   pinMode ( ledPin, OUTPUT );
@@ -107,6 +129,9 @@ void setup() {
 // the loop routine runs over and over again forever:
 void loop() 
 {
+  // Handle deferred RDM requests and frame events
+  dmx_slave.service ();
+
   // Do stuff here
 }
 
@@ -117,3 +142,19 @@ void OnIdentifyDevice (bool identify)
 {
     digitalWrite ( ledPin, identify ? HIGH : LOW );
 }
+
+// Get or set the drive speed, returns RDM_ACK or a NACK reason
+uint8_t OnDriveSpeed ( RDM_Responder &responder, RDM_Message *msg, RDM_ParameterWriter &pd )
+{
+    if ( msg->CC == rdm::GetCommand )
+    {
+        pd.put ( driveSpeed );
+        return RDM_ACK;
+    }
+
+    if ( msg->PD[0] > 100 )
+        return rdm::DataOutOfRange;
+
+    driveSpeed = msg->PD[0];
+    return RDM_ACK;
+}
@@ -18,8 +18,6 @@
 */
 
 
-#include <avr/eeprom.h>
-
 #include <Conceptinetics.h>
 
 //
@@ -46,7 +44,6 @@
 //
 #define DMX_SLAVE_CHANNELS        10 
 #define DMX_NR_PERSONALITIES      2
-#define DMX_DEFAULT_PERSONALITY   1
 
 
 //
@@ -72,39 +69,24 @@ DMX_Slave       dmx_slave ( DMX_SLAVE_CHANNELS, RXEN_PIN );
 //
 RDM_Responder rdm_responder ( 0x0707, 0x1, 0x2, 0x3, 0x4, dmx_slave );
 
+// Keep start address, personality and device label in the first 256
+// bytes of the EEPROM. They are restored here and saved a few seconds
+// after a controller changed them
+RDM_ConfigStore rdm_config ( rdm_responder, 0, 256 );
+
 // Led pin used for identification of this responder via RDM
 const int ledPin = 13;
 
-uint8_t   EEMEM DmxPersonality_P  = DMX_DEFAULT_PERSONALITY;
-uint16_t  EEMEM DmxStartAddress_P = 1;
-char      EEMEM DeviceLabel_P [RDM_MAX_DEVICELABEL_LENGTH] = "";
-
 // the setup routine runs once when you press reset:
 void setup() {             
   
-  uint8_t  dmx_personality;
-  uint16_t dmx_startaddress;
-  char     device_label[RDM_MAX_DEVICELABEL_LENGTH];
-  
-  // Read stored information from EEPROM
-  dmx_personality  = eeprom_read_byte ( &DmxPersonality_P );
-  dmx_startaddress = eeprom_read_word ( &DmxStartAddress_P );
-  eeprom_read_block ( (void*)device_label, (const void*)DeviceLabel_P,  RDM_MAX_DEVICELABEL_LENGTH);
-  
-  // Arduino does not upload default EEPROM values, lets make sure they are valid
-  if ( dmx_startaddress > 512 ) dmx_startaddress = 1;
-  if ( dmx_personality > DMX_NR_PERSONALITIES ) dmx_personality = 1;
-  
-  // Set initial start address, this can be changed remotely via RDM
-  dmx_slave.setStartAddress ( dmx_startaddress );
-  
   // Setup device info to propagate
   rdm_responder.setDeviceInfo
     (
     0x1,                           // Device model ID (manufacturers unique model identifier
     rdm::CategoryFixture,          // We pretend to be a scenic drive controller
     DMX_NR_PERSONALITIES,          // Available personlities
-    dmx_personality                // Current personality
+    rdm_responder.getPersonality () // Current personality (restored from EEPROM)
     );
  
   // Set vendor software version id
@@ -112,12 +94,6 @@ void setup() {
   
   // Register event handlers
   rdm_responder.onIdentifyDevice ( OnIdentifyDevice );
-  rdm_responder.onDeviceLabelChanged ( OnDeviceLabelChanged );
-  rdm_responder.onDMXStartAddressChanged ( OnDMXStartAddressChanged );
-  rdm_responder.onDMXPersonalityChanged ( OnDMXPersonalityChanged );
-  
-  // Restore device label from eeprom
-  rdm_responder.setDeviceLabel ( device_label, RDM_MAX_DEVICELABEL_LENGTH );
   
   // Enable DMX slave interface and start recording (without RDM won't work)
   dmx_slave.enable ();  
@@ -133,10 +109,10 @@ void setup() {
 // the loop routine runs over and over again forever:
 void loop() 
 {
-  
-    // Do stuff here
-  
-  
+  // Handles RDM events and writes changes to the EEPROM
+  dmx_slave.service ();
+
+  // Do stuff here
 }
 
 //
@@ -146,29 +122,3 @@ void OnIdentifyDevice (bool identify)
 {
     digitalWrite ( ledPin, identify ? HIGH : LOW );
 }
-
-//
-// Save device label when changed to eeprom
-//
-void OnDeviceLabelChanged ( const char* label, uint8_t s )
-{
-    if ( s > RDM_MAX_DEVICELABEL_LENGTH) s = RDM_MAX_DEVICELABEL_LENGTH;
-    eeprom_write_block ( (void*)label, (void*)DeviceLabel_P,  RDM_MAX_DEVICELABEL_LENGTH);
-}
-
-//
-// Save new DMX address when remotely changed to eeprom
-//
-void OnDMXStartAddressChanged ( uint16_t address )
-{
-  eeprom_write_word ( &DmxStartAddress_P, address );  
-}
-
-//
-// Save new personality when changed remotely to eeprom
-//
-void OnDMXPersonalityChanged ( uint8_t personality )
-{
-  eeprom_write_byte ( &DmxPersonality_P, personality );
-}
-
@@ -0,0 +1,141 @@
+/*
+  RDM_Slave_Sensors.ino - Example code for using the Conceptinetics DMX library
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <Conceptinetics.h>
+
+//
+// RDM responder reporting a temperature and a fan speed to the
+// controller (SENSOR_DEFINITION, SENSOR_VALUE, RECORD_SENSORS). 
+//
+// The sensors are sampled from dmx_slave.service() in loop(), the 
+// controller polling them is answered from the sampled values
+//
+
+#define DMX_SLAVE_CHANNELS   4 
+#define RXEN_PIN             2
+
+// Analog input of a temperature sensor with 10mV / degree (LM35)
+#define TEMPERATURE_PIN      A0
+
+// Fan tachometer, two pulses per revolution
+#define FAN_TACHO_PIN        3
+
+
+DMX_Slave       dmx_slave ( DMX_SLAVE_CHANNELS, RXEN_PIN );
+RDM_Responder   rdm_responder ( 0x0707, 0x1, 0x2, 0x3, 0x5, dmx_slave );
+
+//
+// Sensor definitions are kept in flash
+//
+const char temperatureDescription[] PROGMEM = "LED temperature";
+const char fanDescription[] PROGMEM         = "Fan speed (rpm)";
+
+const RDM_SensorDefinition temperatureSensor PROGMEM =
+{
+  rdm::SensorTemperature, rdm::UnitsCentigrade, rdm::PrefixNone,
+  0, 150,       // Range the sensor can measure
+  10, 80,       // Normal operation
+  temperatureDescription
+};
+
+const RDM_SensorDefinition fanSensor PROGMEM =
+{
+  rdm::SensorOther, rdm::UnitsNone, rdm::PrefixNone,
+  0, 10000,
+  1000, 4000,
+  fanDescription
+};
+
+volatile uint16_t tachoPulses = 0;
+unsigned long     tachoSince  = 0;
+
+int16_t SampleTemperature ( uint8_t sensor );
+int16_t SampleFan ( uint8_t sensor );
+
+
+void setup() {             
+
+  dmx_slave.setStartAddress (1);
+
+  rdm_responder.setDeviceInfo ( 0x2, rdm::CategoryDimmer_CS_LED );
+
+  // Sensor 0 and 1, sampled every 500ms
+  rdm_responder.addSensor ( &temperatureSensor, SampleTemperature );
+  rdm_responder.addSensor ( &fanSensor, SampleFan );
+  rdm_responder.setSensorInterval ( 500 );
+
+  pinMode ( FAN_TACHO_PIN, INPUT_PULLUP );
+  attachInterrupt ( digitalPinToInterrupt ( FAN_TACHO_PIN ), OnTachoPulse, FALLING );
+
+  dmx_slave.enable ();  
+  rdm_responder.enable ();
+}
+
+void loop() 
+{
+  // Samples the sensors and handles the events of the port
+  dmx_slave.service ();
+
+  // Do stuff here
+}
+
+
+int16_t SampleTemperature ( uint8_t sensor )
+{
+  static bool overtemp = false;
+
+  // 5V reference, 10mV per degree
+  int16_t t = (int16_t)( analogRead ( TEMPERATURE_PIN ) * 500L / 1024 );
+
+  // Tell the controller (QUEUED_MESSAGE / STATUS_MESSAGES) when the 
+  // temperature leaves or returns to the normal range
+  if ( t > 80 && !overtemp )
+    overtemp = rdm_responder.addStatusMessage ( rdm::StatusWarning, rdm::StsOvertemp, sensor, t );
+  else if ( t < 75 && overtemp )
+    overtemp = !rdm_responder.addStatusMessage ( rdm::StatusWarningCleared, rdm::StsOvertemp, sensor, t );
+
+  return t;
+}
+
+int16_t SampleFan ( uint8_t sensor )
+{
+  unsigned long now = millis ();
+  uint16_t      pulses;
+
+  // First sample is taken by addSensor
+  if ( now == tachoSince )
+    return 0;
+
+  noInterrupts ();
+  pulses      = tachoPulses;
+  tachoPulses = 0;
+  interrupts ();
+
+  // Two pulses per revolution
+  int16_t rpm = (int16_t)( pulses * 30000UL / ( now - tachoSince ) );
+  tachoSince  = now;
+
+  return rpm;
+}
+
+void OnTachoPulse ( void )
+{
+  tachoPulses++;
+}
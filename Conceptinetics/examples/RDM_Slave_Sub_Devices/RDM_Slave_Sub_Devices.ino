@@ -0,0 +1,95 @@
+/*
+  RDM_Slave_Sub_Devices.ino - Example code for using the Conceptinetics DMX library
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <Conceptinetics.h>
+
+//
+// Dimmer rack with one RDM sub-device per dimmer module. Every module
+// has its own start address, personality and label which can be set 
+// remotely, the root device holds the rack's master intensity.
+//
+// Each sub-device receives its channels with its own DMX_Slave on the
+// same port
+//
+
+#define RXEN_PIN                2
+
+#define MODULE_CHANNELS         2     // Intensity and curve
+#define MODULE_PERSONALITIES    2     // Dimmer or non-dim
+
+
+DMX_Slave       rack ( 1, RXEN_PIN );
+DMX_Slave       module1 ( MODULE_CHANNELS );
+DMX_Slave       module2 ( MODULE_CHANNELS );
+DMX_Slave       module3 ( MODULE_CHANNELS );
+
+RDM_Responder   rdm_responder ( 0x0707, 0x1, 0x2, 0x3, 0x6, rack );
+
+// Sub-devices 1 - 3 with device model id 0x10
+RDM_SubDevice   sub1 ( module1, 0x10, MODULE_PERSONALITIES );
+RDM_SubDevice   sub2 ( module2, 0x10, MODULE_PERSONALITIES );
+RDM_SubDevice   sub3 ( module3, 0x10, MODULE_PERSONALITIES );
+
+
+void setup() {             
+
+  // Default patch, each module can be moved via RDM
+  rack.setStartAddress ( 1 );
+  module1.setStartAddress ( 2 );
+  module2.setStartAddress ( 4 );
+  module3.setStartAddress ( 6 );
+
+  rdm_responder.setDeviceInfo ( 0x3, rdm::CategoryDimmer );
+
+  rdm_responder.addSubDevice ( sub1 );
+  rdm_responder.addSubDevice ( sub2 );
+  rdm_responder.addSubDevice ( sub3 );
+
+  rdm_responder.onSubDeviceChanged ( OnSubDeviceChanged );
+
+  rack.enable ();
+  module1.enable ();
+  module2.enable ();
+  module3.enable ();
+
+  rdm_responder.enable ();
+}
+
+void loop() 
+{
+  rack.service ();
+
+  // Drive the modules here, e.g. 
+  // module1.getChannelValue ( 1 ) * rack.getChannelValue ( 1 ) / 255
+}
+
+
+// A controller changed the start address, personality, label or 
+// identification of a module
+void OnSubDeviceChanged ( uint16_t subDevice, uint16_t pid )
+{
+  RDM_SubDevice *sub = rdm_responder.getSubDevice ( subDevice );
+
+  if ( pid == rdm::DmxPersonality )
+  {
+    // Switch the module between dimmer and non-dim
+    // sub->getPersonality ()
+  }
+}
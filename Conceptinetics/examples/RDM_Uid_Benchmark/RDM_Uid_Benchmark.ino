@@ -0,0 +1,189 @@
+/*
+  RDM_Uid_Benchmark.ino - Example code for using the Conceptinetics DMX library
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <Conceptinetics.h>
+
+//
+// Measures lookups in a sorted table of UIDs, the way RDM_Controller
+// keeps the responders it discovered. Results are printed on Serial:
+//
+// - Binary search comparing the UIDs byte by byte
+// - Binary search with the RDM_Uid operators (single 48 bit compare)
+// - Binary search in a table of the 48 bit numbers (RDM_Uid::toInt)
+// - Hash table on RDM_Uid::hash
+//
+// Half of the lookups are for UIDs which are not in the table. The
+// table size is limited by RAM, UID_COUNT fits a MEGA2560. On the PC
+// (make -C tests bench) 10000 UIDs are used.
+//
+
+#if defined(DMX_SIMULATED_USART)
+  #define UID_COUNT           10000
+  #define HASH_SIZE           16384   // Power of two, above UID_COUNT
+#else
+  #define UID_COUNT           300
+  #define HASH_SIZE           512
+#endif
+
+#define LOOKUPS               20000
+
+RDM_Uid         uids[UID_COUNT];
+uint64_t        keys[UID_COUNT];
+uint16_t        slots[HASH_SIZE];       // Index + 1, 0 = empty
+RDM_Uid         probes[64];
+
+// The compare RDM_Uid used before the 48 bit view
+int compareBytes ( const RDM_Uid &a, const RDM_Uid &b )
+{
+  for ( uint8_t i = 0; i < 6; i++ )
+    if ( a.m_id[i] != b.m_id[i] )
+      return a.m_id[i] < b.m_id[i] ? -1 : 1;
+
+  return 0;
+}
+
+int compareUid ( const void *a, const void *b )
+{
+  return compareBytes ( *(const RDM_Uid *)a, *(const RDM_Uid *)b );
+}
+
+bool findBytes ( const RDM_Uid &uid )
+{
+  uint16_t lo = 0, hi = UID_COUNT;
+
+  while ( lo < hi )
+  {
+    uint16_t mid = ( lo + hi ) / 2;
+    int      c   = compareBytes ( uids[mid], uid );
+
+    if ( !c )
+      return true;
+
+    if ( c < 0 )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return false;
+}
+
+bool findPacked ( const RDM_Uid &uid )
+{
+  uint16_t lo = 0, hi = UID_COUNT;
+
+  while ( lo < hi )
+  {
+    uint16_t mid = ( lo + hi ) / 2;
+
+    if ( uids[mid] < uid )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo < UID_COUNT && uids[lo] == uid;
+}
+
+bool findKey ( const RDM_Uid &uid )
+{
+  uint64_t key = uid.toInt ();
+  uint16_t lo = 0, hi = UID_COUNT;
+
+  while ( lo < hi )
+  {
+    uint16_t mid = ( lo + hi ) / 2;
+
+    if ( keys[mid] < key )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo < UID_COUNT && keys[lo] == key;
+}
+
+bool findHash ( const RDM_Uid &uid )
+{
+  // Linear probing
+  for ( uint16_t h = uid.hash () & ( HASH_SIZE - 1 ); slots[h]; h = ( h + 1 ) & ( HASH_SIZE - 1 ) )
+    if ( uids[slots[h] - 1] == uid )
+      return true;
+
+  return false;
+}
+
+void measure ( const char *name, bool (*find)(const RDM_Uid &) )
+{
+  uint16_t found = 0;
+  uint32_t start = micros ();
+
+  for ( uint16_t i = 0; i < LOOKUPS; i++ )
+    found += find ( probes[i & 63] );
+
+  uint32_t us = micros () - start;
+
+  Serial.print ( name );
+  Serial.print ( ": " );
+  Serial.print ( (float)us * 1000 / LOOKUPS, 1 );
+  Serial.print ( " ns/lookup, found " );
+  Serial.println ( found );
+}
+
+void setup() {
+
+  Serial.begin ( 115200 );
+  randomSeed ( 1 );
+
+  // A couple of manufacturers with random device ids
+  for ( uint16_t i = 0; i < UID_COUNT; i++ )
+    uids[i] = RDM_Uid::make ( 0x0700 + random ( 4 ), ( (uint32_t)random ( 0x10000 ) << 16 ) | random ( 0x10000 ) );
+
+  qsort ( uids, UID_COUNT, sizeof ( RDM_Uid ), compareUid );
+
+  for ( uint16_t i = 0; i < UID_COUNT; i++ )
+  {
+    uint16_t h = uids[i].hash () & ( HASH_SIZE - 1 );
+
+    while ( slots[h] )
+      h = ( h + 1 ) & ( HASH_SIZE - 1 );
+
+    keys[i]  = uids[i].toInt ();
+    slots[h] = i + 1;
+  }
+
+  // Every other probe is missing from the table
+  for ( uint8_t i = 0; i < 64; i++ )
+  {
+    probes[i] = uids[random ( UID_COUNT )];
+
+    if ( i & 1 )
+      probes[i].m_id[5] ^= 0x5a;
+  }
+
+  measure ( "Byte compare", findBytes );
+  measure ( "48 bit compare", findPacked );
+  measure ( "48 bit key table", findKey );
+  measure ( "Hash table", findHash );
+}
+
+void loop()
+{
+}
@@ -0,0 +1,84 @@
+/*
+  Arduino_Host.cpp - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino_Host.h"
+
+#include <Conceptinetics.h>
+#include <time.h>
+
+HostSerial Serial;
+
+// ns since the first call, the simulated wire is run up to it
+static uint64_t hostNanos ( void )
+{
+    static uint64_t start;
+    struct timespec ts;
+
+    clock_gettime ( CLOCK_MONOTONIC, &ts );
+
+    uint64_t now = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+    if ( !start )
+        start = now;
+
+    uint64_t cycles = ( now - start ) * ( F_OSC / 1000000UL ) / 1000;
+
+    if ( cycles > DMX_Transport::cycles () )
+        DMX_Transport::run ( cycles - DMX_Transport::cycles () );
+
+    return now - start;
+}
+
+unsigned long micros ( void )
+{
+    return (unsigned long)( hostNanos () / 1000 );
+}
+
+unsigned long millis ( void )
+{
+    return (unsigned long)( hostNanos () / 1000000 );
+}
+
+void delay ( unsigned long ms )
+{
+    unsigned long start = millis ();
+
+    while ( millis () - start < ms );
+}
+
+long random ( long max )
+{
+    return max > 0 ? random () % max : 0;
+}
+
+long random ( long min, long max )
+{
+    return max > min ? min + random ( max - min ) : min;
+}
+
+void randomSeed ( unsigned long seed )
+{
+    srandom ( seed );
+}
+
+int main ( void )
+{
+    setup ();
+    return 0;
+}
@@ -0,0 +1,70 @@
+/*
+  Arduino_Host.h - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  The part of the Arduino core the benchmark sketches use, so they
+  build unchanged on the host (make bench). Serial prints on stdout,
+  micros, millis and delay run on the clock of the PC and bring the
+  simulated wire up to it, the interrupt handlers of the library run
+  inside them and take their time from the sketch like on the AVR.
+  main (Arduino_Host.cpp) runs setup once, loop is not called.
+*/
+
+#ifndef ARDUINO_HOST_H_
+#define ARDUINO_HOST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+class HostSerial
+{
+    public:
+        void    begin ( unsigned long ) {};
+
+        void    print ( const char *s )                 { printf ( "%s", s ); };
+        void    print ( char c )                        { printf ( "%c", c ); };
+        void    print ( int v )                         { printf ( "%d", v ); };
+        void    print ( unsigned int v )                { printf ( "%u", v ); };
+        void    print ( long v )                        { printf ( "%ld", v ); };
+        void    print ( unsigned long v )               { printf ( "%lu", v ); };
+        void    print ( double v, int digits = 2 )      { printf ( "%.*f", digits, v ); };
+
+        void    println ( void )                        { printf ( "\n" ); };
+        void    println ( double v, int digits = 2 )    { print ( v, digits ); println (); };
+
+        template <class T>
+        void    println ( T v )                         { print ( v ); println (); };
+};
+
+extern HostSerial Serial;
+
+unsigned long   micros ( void );
+unsigned long   millis ( void );
+void            delay ( unsigned long ms );
+
+// Next to random () of the C library
+long            random ( long max );
+long            random ( long min, long max );
+void            randomSeed ( unsigned long seed );
+
+void            setup ( void );
+void            loop ( void );
+
+#endif /* ARDUINO_HOST_H_ */
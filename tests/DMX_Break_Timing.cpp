@@ -0,0 +1,272 @@
+/*
+  DMX_Break_Timing.cpp - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  Break and mark after break of DMX_Master as measured on the simulated
+  wire, for the baud rate break, timed breaks of several lengths and
+  manual breaks. Every break has to respect the E1.11 transmitter
+  minimums, lengths below them are refused. Timed and manual breaks
+  keep their length when RDM requests go out in the gaps between the
+  frames, and a manual break never waits for a TX complete that does
+  not come (the first break, the break after a request).
+*/
+
+#include "RDM_Population.h"
+
+#define BIT_USEC(rate)      ( 1000000.0 / (rate) )
+
+struct Timing
+{
+    double      breakUs;
+    double      mabUs;
+    uint32_t    breaks;
+    uint32_t    frames;             // Frames with the right slot values
+    uint32_t    flushHangs;         // Waits for TXC that never end on the AVR
+};
+
+static uint16_t s_slot;
+static uint32_t s_good;
+
+static void onLine ( uint8_t data, bool isBreak, uint64_t )
+{
+    if ( isBreak )
+    {
+        s_slot = 0;
+        return;
+    }
+
+    // Start code followed by channel 1
+    if ( ( s_slot == 0 && data == 0x00 ) || ( s_slot == 1 && data == 0x5a ) )
+        s_good += s_slot;
+
+    s_slot++;
+}
+
+static Timing runFrames ( DMX_Master &master, uint16_t manualBreak_us = 0 )
+{
+    DMX_Transport &usart = master.getPort ()->usart;
+
+    s_good = 0;
+    usart.onLine ( onLine );
+    usart.resetStats ();
+    master.enable ();
+
+    // 50 ms in steps of 100 us, manual breaks are given when asked for
+    for ( uint16_t i = 0; i < 500; i++ )
+    {
+        runMicros ( 100 );
+
+        if ( manualBreak_us && master.waitingBreak () )
+            master.breakAndContinue ( manualBreak_us );
+    }
+
+    master.disable ();
+    usart.onLine ( NULL );
+
+    const DMX_TransportStats &stats = usart.getStats ();
+    Timing t;
+
+    t.breakUs   = (double)stats.lastBreakCycles / CYCLES_PER_USEC;
+    t.mabUs     = (double)stats.lastMabCycles / CYCLES_PER_USEC;
+    t.breaks    = stats.breaksSent;
+    t.frames    = s_good;
+    t.flushHangs = stats.flushHangs;
+
+    return t;
+}
+
+static void checkLimits ( const char *mode, const Timing &t )
+{
+    printf ( "%-24s break %6.1f us  MAB %5.1f us  (%u breaks)\n",
+             mode, t.breakUs, t.mabUs, t.breaks );
+
+    CHECK ( t.breaks > 10 );
+    CHECK ( t.frames + 1 >= t.breaks );
+    CHECK ( t.breakUs >= DMX_MIN_BREAK_USEC );
+    CHECK ( t.mabUs >= DMX_MIN_MAB_USEC );
+    CHECK ( t.flushHangs == 0 );
+}
+
+// Break from a 0x00 at DMX_BREAK_RATE: start bit and eight data bits
+// low, the two stop bits form the MAB
+static void autoBreak ( void )
+{
+    DMX_Master master ( 24, -1, 0 );
+
+    master.setChannelValue ( 1, 0x5a );
+
+    Timing t = runFrames ( master );
+
+    checkLimits ( "baud rate break", t );
+    CHECK ( t.breakUs == 9 * BIT_USEC ( DMX_BREAK_RATE ) );
+    CHECK ( t.mabUs == 2 * BIT_USEC ( DMX_BREAK_RATE ) );
+}
+
+static void timedBreak ( uint16_t break_us, uint16_t mab_us )
+{
+    DMX_Master master ( 24, -1, 0 );
+    char       mode[32];
+
+    master.setChannelValue ( 1, 0x5a );
+    CHECK ( master.setTimedBreakMode ( break_us, mab_us ) );
+    CHECK ( master.timedBreakEnabled () );
+
+    Timing t = runFrames ( master );
+
+    snprintf ( mode, sizeof ( mode ), "timed %u / %u us", break_us, mab_us );
+    checkLimits ( mode, t );
+    CHECK ( t.breakUs == break_us );
+    CHECK ( t.mabUs == mab_us );
+}
+
+// Lengths below the E1.11 minimums leave the mode as it was
+static void timedRejected ( uint16_t break_us, uint16_t mab_us )
+{
+    DMX_Master master ( 24, -1, 0 );
+
+    printf ( "timed %u / %u us refused\n", break_us, mab_us );
+
+    CHECK ( !master.setTimedBreakMode ( break_us, mab_us ) );
+    CHECK ( !master.timedBreakEnabled () );
+
+    CHECK ( master.setTimedBreakMode ( 200, 20 ) );
+    CHECK ( !master.setTimedBreakMode ( break_us, mab_us ) );
+
+    Timing t = runFrames ( master );
+
+    CHECK ( t.breakUs == 200 );
+    CHECK ( t.mabUs == 20 );
+}
+
+// Break in front of every DMX frame (start code 0x00) with requests
+// of an RDM_Controller in between, the request breaks are not counted
+static DMX_Transport    *s_usart;
+static uint32_t         s_expectUs;
+static uint32_t         s_breakUs;
+static bool             s_afterBreak;
+static uint32_t         s_frames;
+static uint32_t         s_wrongBreaks;
+
+static void onFrameBreak ( uint8_t data, bool isBreak, uint64_t )
+{
+    if ( isBreak )
+    {
+        s_breakUs       = s_usart->getStats ().lastBreakCycles / CYCLES_PER_USEC;
+        s_afterBreak    = true;
+        return;
+    }
+
+    if ( s_afterBreak && data == 0x00 )
+    {
+        s_frames++;
+
+        if ( s_breakUs != s_expectUs )
+            s_wrongBreaks++;
+    }
+
+    s_afterBreak = false;
+}
+
+// Timed break, or a manual break of break_us
+static void rdmBreak ( uint16_t break_us, bool manual )
+{
+    RDM_Population  population;
+    DMX_Master      master ( 24, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+    char            mode[32];
+
+    s_usart = &master.getPort ()->usart;
+    s_expectUs = break_us;
+    s_frames = s_wrongBreaks = 0;
+
+    population.create ( 1, 1, 16 );
+
+    if ( manual )
+        master.setManualBreakMode ();
+    else
+        CHECK ( master.setTimedBreakMode ( break_us, 20 ) );
+
+    controller.addPoll ( population.uid ( 0 ), rdm::DeviceInfo, 10 );
+    s_usart->onLine ( onFrameBreak );
+    s_usart->resetStats ();
+    master.enable ();
+
+    for ( uint16_t i = 0; i < 5000; i++ )
+    {
+        runMicros ( 100 );
+
+        if ( manual && master.waitingBreak () )
+            master.breakAndContinue ( break_us );
+
+        controller.service ();
+        population.service ();
+    }
+
+    master.disable ();
+    s_usart->onLine ( NULL );
+
+    const RDM_PollStats &stats = controller.getPollStats ();
+
+    snprintf ( mode, sizeof ( mode ), "%s %u us with RDM", manual ? "manual" : "timed", break_us );
+    printf ( "%-24s %u frames, %u requests, %u other breaks, %u flush hangs\n",
+             mode, s_frames, stats.requests, s_wrongBreaks, s_usart->getStats ().flushHangs );
+
+    CHECK ( s_frames > 100 );
+    CHECK ( stats.acks > 10 );
+    CHECK ( s_wrongBreaks == 0 );
+    CHECK ( s_usart->getStats ().flushHangs == 0 );
+}
+
+static void manualBreak ( uint16_t break_us )
+{
+    DMX_Master master ( 24, -1, 0 );
+    char       mode[32];
+
+    master.setChannelValue ( 1, 0x5a );
+    master.setManualBreakMode ();
+
+    Timing t = runFrames ( master, break_us );
+
+    snprintf ( mode, sizeof ( mode ), "manual %u us", break_us );
+    checkLimits ( mode, t );
+    CHECK ( t.breakUs == break_us );
+}
+
+int main ( void )
+{
+    autoBreak ();
+
+    timedBreak ( DMX_MIN_BREAK_USEC, DMX_MIN_MAB_USEC );
+    timedBreak ( DMX_DEFAULT_BREAK_USEC, DMX_DEFAULT_MAB_USEC );
+    timedBreak ( 200, 20 );
+    timedBreak ( 352, 88 );
+    timedBreak ( 1000, 100 );
+
+    timedRejected ( DMX_MIN_BREAK_USEC - 1, DMX_MIN_MAB_USEC );
+    timedRejected ( DMX_MIN_BREAK_USEC, DMX_MIN_MAB_USEC - 1 );
+    timedRejected ( 0, 0 );
+
+    rdmBreak ( 200, false );
+    rdmBreak ( 150, true );
+
+    manualBreak ( 100 );
+    manualBreak ( 150 );
+
+    return hostResult ( "DMX_Break_Timing" );
+}
@@ -0,0 +1,111 @@
+/*
+  DMX_Frame_Length.cpp - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  DMX_Master transmits the configured frame length only. Every frame
+  on the wire is counted and timed, for short universes with and
+  without padding up to the minimum break to break time and for a
+  full universe.
+*/
+
+#include "Host_Test.h"
+
+static uint16_t     s_slots;        // Slots of the frame on the line
+static uint16_t     s_frameSlots;   // Slots of the last complete frame
+static uint64_t     s_lastBreak;
+static uint64_t     s_period;       // Break to break, in cycles
+static uint32_t     s_frames;
+
+static void onLine ( uint8_t, bool isBreak, uint64_t cycle )
+{
+    if ( !isBreak )
+    {
+        s_slots++;
+        return;
+    }
+
+    if ( s_frames++ )
+    {
+        s_frameSlots    = s_slots;
+        s_period        = cycle - s_lastBreak;
+    }
+
+    s_slots     = 0;
+    s_lastBreak = cycle;
+}
+
+static void frameLength ( uint16_t channels, dmx::dmxFramePadding padding )
+{
+    DMX_Master master ( channels, -1, 0 );
+
+    s_slots = s_frameSlots = s_frames = 0;
+    s_period = 0;
+
+    master.setFramePadding ( padding );
+    master.getPort ()->usart.onLine ( onLine );
+    master.enable ();
+
+    runMicros ( 200000 );
+
+    uint32_t periodUs   = (uint32_t)( s_period / CYCLES_PER_USEC );
+    uint16_t wireRate   = periodUs ? 1000000UL / periodUs : 0;
+    bool     padded     = padding == dmx::dmxPadMinimumFrame;
+
+    printf ( "%3u channels %-6s: %3u slots, break to break %5u us, %3u Hz (getFrameRate %u)\n",
+             channels, padded ? "padded" : "none", s_frameSlots, periodUs,
+             wireRate, master.getFrameRate () );
+
+    // Start code and the configured channels, padded with zero slots
+    // when asked for
+    uint16_t expected = channels + 1;
+
+    if ( padded && expected < DMX_MIN_PADDED_FRAMESIZE )
+        expected = DMX_MIN_PADDED_FRAMESIZE;
+
+    CHECK ( s_frames > 2 );
+    CHECK ( s_frameSlots == expected );
+    CHECK ( master.getFrameSize () == expected );
+
+    // Nothing but the break, MAB and slots on the line
+    CHECK ( periodUs == DMX_BREAK_USEC + (uint32_t)expected * DMX_SLOT_USEC );
+
+    if ( padded )
+        CHECK ( periodUs >= DMX_MIN_BREAK_TO_BREAK_USEC );
+
+    // The rate reported is the one on the wire, measured in whole
+    // microseconds
+    int32_t error = (int32_t)master.getFrameRate () - wireRate;
+
+    CHECK ( ( error < 0 ? -error : error ) * 100 <= wireRate );
+
+    master.disable ();
+    master.getPort ()->usart.onLine ( NULL );
+}
+
+int main ( void )
+{
+    frameLength ( 16, dmx::dmxPadMinimumFrame );
+    frameLength ( 16, dmx::dmxPadNone );
+    frameLength ( 24, dmx::dmxPadMinimumFrame );
+    frameLength ( 1, dmx::dmxPadNone );
+    frameLength ( 100, dmx::dmxPadMinimumFrame );
+    frameLength ( 512, dmx::dmxPadMinimumFrame );
+
+    return hostResult ( "DMX_Frame_Length" );
+}
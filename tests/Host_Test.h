@@ -0,0 +1,64 @@
+/*
+  Host_Test.h - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  Checks shared by the host tests. The tests run the library on the
+  simulated wire (DMX_SIMULATED_USART), print what they measured and
+  exit non zero when a check failed.
+*/
+
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+#include <Conceptinetics.h>
+
+#include <stdio.h>
+
+static int host_failures;
+
+#define CHECK(cond) \
+    do { \
+        if ( !( cond ) ) \
+        { \
+            printf ( "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond ); \
+            host_failures++; \
+        } \
+    } while ( 0 )
+
+// Simulated clock in microseconds, and let it run
+#define CYCLES_PER_USEC     ( F_OSC / 1000000UL )
+
+static inline uint64_t hostMicros ( void )
+{
+    return DMX_Transport::cycles () / CYCLES_PER_USEC;
+}
+
+static inline void runMicros ( uint64_t us )
+{
+    DMX_Transport::run ( us * CYCLES_PER_USEC );
+}
+
+// Print the verdict, the value to return from main
+static inline int hostResult ( const char *name )
+{
+    printf ( "%s: %s\n", name, host_failures ? "FAILED" : "OK" );
+    return host_failures ? 1 : 0;
+}
+
+#endif /* HOST_TEST_H_ */
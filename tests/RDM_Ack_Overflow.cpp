@@ -0,0 +1,195 @@
+/*
+  RDM_Ack_Overflow.cpp - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  Parameter data larger than a response is sent in pages, every page
+  but the last is an ACK_OVERFLOW and the controller repeats the GET
+  for the next one. A poll collects all pages in one round, and a page
+  a deferred responder had to drop (serviced too late) is sent again.
+*/
+
+#include "RDM_Population.h"
+
+#define PID_LARGE       0x8000
+#define LARGE_LEN       600
+
+static RDM_Population   s_population;
+
+static uint8_t          s_data[LARGE_LEN + RDM_PD_MAXLEN];
+static uint16_t         s_len;
+static uint8_t          s_pages;
+static uint8_t          s_overflows;
+static bool             s_done;
+
+static uint8_t largeByte ( uint16_t i )
+{
+    return (uint8_t)( i * 7 + ( i >> 8 ) );
+}
+
+static uint8_t onLarge ( RDM_Responder &, RDM_Message *, RDM_ParameterWriter &pd )
+{
+    for ( uint16_t i = 0; i < LARGE_LEN; i++ )
+        pd.put ( largeByte ( i ) );
+
+    return RDM_ACK;
+}
+
+static const RDM_Parameter s_parameters[] PROGMEM =
+{
+    { PID_LARGE, rdm::ParameterGet, 0, 0, 0, onLarge },
+};
+
+static void reset ( void )
+{
+    s_len       = 0;
+    s_pages     = 0;
+    s_overflows = 0;
+    s_done      = false;
+}
+
+static void page ( const RDM_Message *msg )
+{
+    memcpy ( &s_data[s_len], msg->PD, msg->PDL );
+    s_len += msg->PDL;
+    s_pages++;
+
+    if ( msg->portId == rdm::ResponseTypeAckOverflow )
+        s_overflows++;
+    else
+        s_done = true;
+}
+
+static bool collected ( void )
+{
+    if ( s_len != LARGE_LEN )
+        return false;
+
+    for ( uint16_t i = 0; i < LARGE_LEN; i++ )
+        if ( s_data[i] != largeByte ( i ) )
+            return false;
+
+    return true;
+}
+
+static void onPollResponse ( uint16_t, const RDM_Message *msg )
+{
+    if ( msg && !s_done )
+        page ( msg );
+}
+
+// The poll reads every page in one round
+static void poll ( void )
+{
+    DMX_Master      master ( 24, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+
+    reset ();
+    s_population.create ( 1, 12, 16 );
+    s_population.responder ( 0 )->setParameters ( s_parameters, 1 );
+    controller.onPollResponse ( onPollResponse );
+    master.enable ();
+
+    CHECK ( controller.addPoll ( s_population.uid ( 0 ), PID_LARGE, 1000, 0 ) );
+
+    for ( uint16_t t = 0; t < 5000 && !s_done; t++ )
+    {
+        runMicros ( 100 );
+        controller.service ();
+        s_population.service ();
+    }
+
+    printf ( "poll: %u bytes in %u pages, %u overflows, data %s\n",
+             s_len, s_pages, s_overflows, collected () ? "OK" : "BAD" );
+
+    CHECK ( s_done );
+    CHECK ( s_pages == ( LARGE_LEN + RDM_PD_MAXLEN - 1 ) / RDM_PD_MAXLEN );
+    CHECK ( s_overflows == s_pages - 1 );
+    CHECK ( collected () );
+
+    master.disable ();
+}
+
+// GET PID_LARGE with the responder serviced delay_us after the request
+static void get ( RDM_Controller &controller, RDM_Responder &responder, uint32_t delay_us )
+{
+    uint64_t start = 0;
+
+    CHECK ( controller.sendRequest ( s_population.uid ( 0 ), rdm::GetCommand,
+                                     PID_LARGE, NULL, 0 ) );
+
+    for ( uint16_t i = 0; i < 10000 && ( controller.isBusy () || responder.requestPending () ); i++ )
+    {
+        runMicros ( 10 );
+        controller.service ();
+
+        if ( !start && responder.requestPending () )
+            start = hostMicros ();
+
+        if ( start && hostMicros () >= start + delay_us )
+            s_population.service ();
+    }
+
+    RDM_Message *msg = controller.getResponse ();
+
+    if ( msg )
+        page ( msg );
+}
+
+// A dropped page is not skipped
+static void dropped ( void )
+{
+    DMX_Master      master ( 24, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+
+    reset ();
+    s_population.create ( 1, 13, 16 );
+
+    RDM_Responder   &responder = *s_population.responder ( 0 );
+
+    responder.setParameters ( s_parameters, 1 );
+    responder.setDeferred ( true );
+    master.enable ();
+
+    get ( controller, responder, 100 );
+    CHECK ( s_pages == 1 && s_overflows == 1 );
+
+    // Too late, no response
+    get ( controller, responder, 3000 );
+    CHECK ( s_pages == 1 );
+
+    for ( uint8_t i = 0; i < 5 && !s_done; i++ )
+        get ( controller, responder, 100 );
+
+    printf ( "dropped page: %u bytes in %u pages, %u overflows, data %s\n",
+             s_len, s_pages, s_overflows, collected () ? "OK" : "BAD" );
+
+    CHECK ( s_done );
+    CHECK ( s_overflows == s_pages - 1 );
+    CHECK ( collected () );
+
+    master.disable ();
+}
+
+int main ( void )
+{
+    poll ();
+    dropped ();
+
+    return hostResult ( "RDM_Ack_Overflow" );
+}
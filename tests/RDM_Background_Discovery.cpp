@@ -0,0 +1,248 @@
+/*
+  RDM_Background_Discovery.cpp - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  DMX_Master keeps up the frame rate set with setMinFrameRate while
+  RDM_Controller discovers, counted per second on the wire. Background
+  discovery then has to report responders plugged in and removed
+  through onDeviceFound and onDeviceLost, power cycled responders are
+  not reported, and leave the device table equal to the population.
+*/
+
+#include "RDM_Population.h"
+
+static RDM_Population   s_population;
+
+// DMX frames (breaks) on the wire, per second of simulated time
+static uint32_t         s_breaks;
+static uint64_t         s_windowStart;
+static uint32_t         s_windowBreaks;
+static uint32_t         s_minRate;
+
+static RDM_Uid          s_found[16];
+static RDM_Uid          s_lost[16];
+static uint8_t          s_nrFound;
+static uint8_t          s_nrLost;
+
+static void onLine ( uint8_t, bool isBreak, uint64_t cycle )
+{
+    if ( !isBreak )
+        return;
+
+    if ( cycle - s_windowStart >= F_OSC )
+    {
+        if ( s_windowStart && s_windowBreaks < s_minRate )
+            s_minRate = s_windowBreaks;
+
+        // A whole second without a frame
+        if ( s_windowStart && cycle - s_windowStart >= 2 * F_OSC )
+            s_minRate = 0;
+
+        s_windowStart   = cycle;
+        s_windowBreaks  = 0;
+    }
+
+    s_breaks++;
+    s_windowBreaks++;
+}
+
+static void resetRate ( void )
+{
+    s_breaks        = 0;
+    s_windowStart   = 0;
+    s_windowBreaks  = 0;
+    s_minRate       = 0xffffffff;
+}
+
+static void onFound ( const RDM_Uid &uid )
+{
+    if ( s_nrFound < 16 )
+        s_found[s_nrFound++] = uid;
+}
+
+static void onLost ( const RDM_Uid &uid )
+{
+    if ( s_nrLost < 16 )
+        s_lost[s_nrLost++] = uid;
+}
+
+static bool listed ( const RDM_Uid *list, uint8_t count, const RDM_Uid &uid )
+{
+    for ( uint8_t i = 0; i < count; i++ )
+        if ( list[i] == uid )
+            return true;
+
+    return false;
+}
+
+static bool sorted ( RDM_Controller &controller )
+{
+    for ( uint16_t i = 1; i < controller.getDeviceCount (); i++ )
+        if ( memcmp ( controller.getDevice ( i - 1 ).m_id, controller.getDevice ( i ).m_id, 6 ) >= 0 )
+            return false;
+
+    return true;
+}
+
+// Run until done or the timeout (in seconds of simulated time) passed,
+// returns the time it took in seconds
+static double runUntil ( RDM_Controller &controller, bool (*done)(RDM_Controller &), uint16_t timeout_s )
+{
+    uint64_t start = hostMicros ();
+
+    while ( !done ( controller ) && hostMicros () - start < timeout_s * 1000000ULL )
+    {
+        runMicros ( 100 );
+        controller.service ();
+        s_population.service ();
+    }
+
+    return ( hostMicros () - start ) / 1e6;
+}
+
+static bool discovered ( RDM_Controller &controller )
+{
+    return !controller.isDiscovering ();
+}
+
+static uint8_t  s_wantFound;
+static uint8_t  s_wantLost;
+
+static bool reported ( RDM_Controller & )
+{
+    return s_nrFound >= s_wantFound && s_nrLost >= s_wantLost;
+}
+
+static void frameRateFloor ( uint16_t channels, uint16_t fps )
+{
+    DMX_Master      master ( channels, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+    DMX_Transport   &usart = master.getPort ()->usart;
+
+    s_population.create ( 100, 11, 16 );
+    controller.setMinFrameRate ( fps );
+    usart.onLine ( onLine );
+    master.enable ();
+    runMicros ( 10000 );
+
+    resetRate ();
+    CHECK ( controller.startDiscovery () );
+
+    double t = runUntil ( controller, discovered, 600 );
+
+    printf ( "%3u channels floor %3u fps: %s %3u found in %5.2f s, %4.0f fps, slowest second %3u fps\n",
+             channels, fps, s_population.matches ( controller ) ? "OK " : "BAD",
+             controller.getDeviceCount (), t, s_breaks / t, s_minRate );
+
+    CHECK ( s_population.matches ( controller ) );
+    CHECK ( s_minRate != 0xffffffff );
+    CHECK ( s_minRate >= fps );
+
+    master.disable ();
+    usart.onLine ( NULL );
+}
+
+static void background ( uint16_t count, uint16_t fps )
+{
+    DMX_Master      master ( 24, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+    DMX_Transport   &usart = master.getPort ()->usart;
+    RDM_Uid         removed[5];
+    RDM_Uid         added[7];
+
+    s_population.create ( count, 5, 16 );
+    controller.onDeviceFound ( onFound );
+    controller.onDeviceLost ( onLost );
+    controller.setMinFrameRate ( fps );
+    usart.onLine ( onLine );
+    master.enable ();
+
+    CHECK ( controller.startDiscovery () );
+    runUntil ( controller, discovered, 600 );
+    CHECK ( s_population.matches ( controller ) );
+
+    // Found events of the full discovery don't count
+    s_nrFound = s_nrLost = 0;
+
+    // Unplug 5, plug in 7 new and power cycle 3 responders
+    for ( uint8_t i = 0; i < 5; i++ )
+    {
+        uint16_t slot = i * 7;
+
+        removed[i] = s_population.uid ( slot );
+        s_population.remove ( removed[i] );
+    }
+
+    for ( uint8_t i = 0; i < 3; i++ )
+    {
+        RDM_Uid uid = s_population.uid ( 40 + i );
+
+        s_population.remove ( uid );
+        s_population.add ( uid );
+    }
+
+    for ( uint8_t i = 0; i < 7; i++ )
+    {
+        added[i] = RDM_Uid::make ( 0x5000 + i, 0x1000 * i );
+        s_population.add ( added[i] );
+    }
+
+    controller.setBackgroundDiscovery ( 10 );
+    resetRate ();
+
+    s_wantFound = 7;
+    s_wantLost  = 0;
+    double tFound = runUntil ( controller, reported, 600 );
+
+    s_wantLost  = 5;
+    double tLost = runUntil ( controller, reported, 3600 );
+
+    printf ( "%3u responders: +%u in %5.2f s, -%u in %5.1f s, slowest second %3u fps, table %s\n",
+             count, s_nrFound, tFound, s_nrLost, tLost, s_minRate,
+             s_population.matches ( controller ) && sorted ( controller ) ? "OK" : "BAD" );
+
+    CHECK ( s_nrFound == 7 );
+    CHECK ( s_nrLost == 5 );
+
+    for ( uint8_t i = 0; i < 7; i++ )
+        CHECK ( listed ( s_found, s_nrFound, added[i] ) );
+
+    for ( uint8_t i = 0; i < 5; i++ )
+        CHECK ( listed ( s_lost, s_nrLost, removed[i] ) );
+
+    CHECK ( s_minRate != 0xffffffff );
+    CHECK ( s_minRate >= fps );
+    CHECK ( s_population.matches ( controller ) );
+    CHECK ( sorted ( controller ) );
+
+    master.disable ();
+    usart.onLine ( NULL );
+}
+
+int main ( void )
+{
+    frameRateFloor ( 24, 100 );
+    frameRateFloor ( 24, 200 );
+    frameRateFloor ( 512, 30 );
+
+    background ( 50, 200 );
+    background ( 200, 200 );
+
+    return hostResult ( "RDM_Background_Discovery" );
+}
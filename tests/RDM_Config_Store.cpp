@@ -0,0 +1,158 @@
+/*
+  RDM_Config_Store.cpp - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  RDM_ConfigStore journal in the simulated EEPROM. Every complete save
+  is restored after a power cycle, also once the slots wrapped. A save
+  torn after any number of bytes restores the save before it.
+*/
+
+#include "Host_Test.h"
+
+#include <Dmx_Eeprom.h>
+#include <string.h>
+
+#define EEPROM_FILE     "RDM_Config_Store.eeprom"
+
+struct Config
+{
+    uint16_t    address;
+    uint8_t     personality;
+    char        label[RDM_MAX_DEVICELABEL_LENGTH];
+};
+
+static void makeConfig ( uint16_t n, Config &config )
+{
+    memset ( &config, 0, sizeof ( config ) );
+
+    config.address      = n;
+    config.personality  = 1 + n % 3;
+    snprintf ( config.label, sizeof ( config.label ), "record %u", n );
+}
+
+static bool sameConfig ( const Config &a, const Config &b )
+{
+    return a.address == b.address && a.personality == b.personality &&
+           !memcmp ( a.label, b.label, sizeof ( a.label ) );
+}
+
+// Power up a responder with its store, returns the restored configuration
+static bool boot ( Config &config )
+{
+    DMX_Slave       slave ( 1, -1, 1 );
+    RDM_Responder   responder ( 0x7ff0, 0x0, 0x0, 0x0, 0x2, slave );
+    RDM_ConfigStore store ( responder, 0, 256 );
+
+    config.address      = slave.getStartAddress ();
+    config.personality  = responder.getPersonality ();
+    memcpy ( config.label, responder.getDeviceLabel (), sizeof ( config.label ) );
+
+    return store.restore ();
+}
+
+// Save configuration n, power is lost after torn bytes were written
+// (never with torn 0xffff), returns the bytes written
+static uint16_t save ( uint16_t n, uint16_t torn = 0xffff )
+{
+    DMX_Slave       slave ( 1, -1, 1 );
+    RDM_Responder   responder ( 0x7ff0, 0x0, 0x0, 0x0, 0x2, slave );
+    RDM_ConfigStore store ( responder, 0, 256 );
+    Config          config;
+    uint16_t        written = 0;
+
+    makeConfig ( n, config );
+    slave.setStartAddress ( config.address );
+    responder.setPersonality ( config.personality );
+    responder.setDeviceLabel ( config.label, sizeof ( config.label ) );
+
+    store.changed ();
+    store.flush ();
+
+    // The first call takes the snapshot, every next one writes a byte
+    store.service ();
+
+    while ( store.pending () && written < torn )
+    {
+        store.service ();
+        written++;
+    }
+
+    CHECK ( store.pending () == ( written == torn ) );
+
+    return written;
+}
+
+int main ( void )
+{
+    Config      config;
+    Config      want;
+
+    remove ( EEPROM_FILE );
+    DMX_EepromSetFile ( EEPROM_FILE );
+
+    // Erased EEPROM
+    CHECK ( !boot ( config ) );
+
+    // Enough saves to wrap the slots of the region
+    uint16_t    recordSize = 0;
+    uint16_t    n;
+
+    for ( n = 1; n <= 2 * 256 / 39; n++ )
+    {
+        recordSize = save ( n );
+
+        makeConfig ( n, want );
+        CHECK ( boot ( config ) );
+        CHECK ( sameConfig ( config, want ) );
+    }
+
+    printf ( "%u saves of %u bytes restored\n", n - 1, recordSize );
+
+    // Power lost after every possible number of bytes of the next save
+    uint16_t    last = n - 1;
+    uint16_t    bad = 0;
+
+    makeConfig ( last, want );
+
+    for ( uint16_t torn = 0; torn < recordSize; torn++ )
+    {
+        save ( 200 + torn, torn );
+
+        if ( !boot ( config ) || !sameConfig ( config, want ) )
+        {
+            printf ( "torn after %u bytes: restored address %u\n", torn, config.address );
+            bad++;
+        }
+    }
+
+    printf ( "saves torn after 0 - %u bytes: %u restored the save before\n",
+             recordSize - 1, recordSize - bad );
+
+    CHECK ( bad == 0 );
+
+    // The slot of the torn saves is taken by the next complete one
+    save ( 300 );
+    makeConfig ( 300, want );
+    CHECK ( boot ( config ) );
+    CHECK ( sameConfig ( config, want ) );
+
+    remove ( EEPROM_FILE );
+
+    return hostResult ( "RDM_Config_Store" );
+}
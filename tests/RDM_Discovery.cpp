@@ -0,0 +1,79 @@
+/*
+  RDM_Discovery.cpp - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  Full discovery of RDM_Controller against populations of up to a few
+  hundred RDM_Responders on one line. The UIDs found have to be the
+  population, the discovery time is printed per population size.
+*/
+
+#include "RDM_Population.h"
+
+static RDM_Population   s_population;
+
+static void discover ( uint16_t count, unsigned seed, uint16_t manufacturers )
+{
+    DMX_Master      master ( 24, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+
+    s_population.create ( count, seed, manufacturers );
+    master.enable ();
+    runMicros ( 10000 );
+
+    CHECK ( controller.startDiscovery () );
+
+    uint64_t start = hostMicros ();
+
+    // Give up after 10 minutes of simulated time
+    while ( controller.isDiscovering () && hostMicros () - start < 600000000ULL )
+    {
+        runMicros ( 100 );
+        controller.service ();
+        s_population.service ();
+    }
+
+    const RDM_DiscoveryStats &stats = controller.getDiscoveryStats ();
+    bool found = s_population.matches ( controller );
+
+    printf ( "%3u responders %-13s: %s %3u found in %6.3f s (%6u ms)  branches %4u  collisions %4u  mutes %3u\n",
+             count, manufacturers == 1 ? "1 manufacturer" : "random UIDs", found ? "OK " : "BAD",
+             controller.getDeviceCount (), ( hostMicros () - start ) / 1e6,
+             controller.getDiscoveryTime (), stats.branches, stats.collisions, stats.mutes );
+
+    CHECK ( !controller.isDiscovering () );
+    CHECK ( found );
+    CHECK ( stats.mutes == count );
+    CHECK ( stats.dropped == 0 );
+
+    master.disable ();
+}
+
+int main ( void )
+{
+    const uint16_t sizes[] = { 0, 1, 2, 10, 50, 100, 200, POPULATION_MAX };
+
+    for ( uint8_t i = 0; i < sizeof ( sizes ) / sizeof ( sizes[0] ); i++ )
+        discover ( sizes[i], sizes[i] + 1, 16 );
+
+    // Close UIDs split deep down the tree
+    discover ( 100, 7, 1 );
+    discover ( 200, 8, 1 );
+
+    return hostResult ( "RDM_Discovery" );
+}
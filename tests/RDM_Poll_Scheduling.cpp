@@ -0,0 +1,283 @@
+/*
+  RDM_Poll_Scheduling.cpp - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  Poll plan of RDM_Controller against real responders. Polls due at
+  the same moment are requested highest priority first and in the
+  order they were added among equals. Every poll keeps its interval as
+  long as the line has room, when it has not the higher priorities
+  keep theirs. NACKs are reported with the response, responders that
+  are gone after the retries with NULL.
+*/
+
+#include "RDM_Population.h"
+
+#define MAX_POLLS       64
+
+static RDM_Population   s_population;
+
+static uint8_t          s_priority[MAX_POLLS + 1];
+static uint32_t         s_acks[MAX_POLLS + 1];
+static uint32_t         s_nacks[MAX_POLLS + 1];
+static uint32_t         s_lost[MAX_POLLS + 1];
+static uint16_t         s_order[MAX_POLLS];
+static uint16_t         s_nrOrder;
+
+static void onPollResponse ( uint16_t poll, const RDM_Message *msg )
+{
+    if ( poll > MAX_POLLS )
+        return;
+
+    if ( s_nrOrder < MAX_POLLS )
+        s_order[s_nrOrder++] = poll;
+
+    if ( !msg )
+        s_lost[poll]++;
+    else if ( msg->portId == rdm::ResponseTypeNackReason )
+        s_nacks[poll]++;
+    else
+        s_acks[poll]++;
+}
+
+static void reset ( void )
+{
+    memset ( s_priority, 0, sizeof ( s_priority ) );
+    memset ( s_acks, 0, sizeof ( s_acks ) );
+    memset ( s_nacks, 0, sizeof ( s_nacks ) );
+    memset ( s_lost, 0, sizeof ( s_lost ) );
+    s_nrOrder = 0;
+}
+
+static uint16_t addPoll ( RDM_Controller &controller, const RDM_Uid &uid, uint16_t pid,
+                          uint16_t interval_ms, uint8_t priority )
+{
+    uint16_t poll = controller.addPoll ( uid, pid, interval_ms, priority );
+
+    CHECK ( poll && poll <= MAX_POLLS );
+    s_priority[poll] = priority;
+
+    return poll;
+}
+
+// Run for ms of simulated time, returns the largest age of the polls
+// seen after the first second
+static uint32_t run ( RDM_Controller &controller, uint32_t ms, uint16_t nrPolls )
+{
+    uint32_t maxAge = 0;
+
+    for ( uint32_t t = 0; t < ms * 10; t++ )
+    {
+        runMicros ( 100 );
+        controller.service ();
+        s_population.service ();
+
+        for ( uint16_t poll = 1; t >= 10000 && poll <= nrPolls; poll++ )
+            if ( controller.getPollAge ( poll ) > maxAge )
+                maxAge = controller.getPollAge ( poll );
+    }
+
+    return maxAge;
+}
+
+// Added before the master is enabled all polls are due together, the
+// first round has to come in priority order
+static void order ( void )
+{
+    DMX_Master      master ( 24, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+    const uint16_t  pids[] = { rdm::DeviceInfo, rdm::DmxStartAddress, rdm::DeviceLabel };
+    uint16_t        nrPolls = 0;
+
+    reset ();
+    s_population.create ( 4, 3, 16 );
+    controller.onPollResponse ( onPollResponse );
+
+    for ( uint8_t i = 0; i < 4; i++ )
+        for ( uint8_t j = 0; j < 3; j++ )
+            addPoll ( controller, s_population.uid ( i ), pids[j], 1000, ( i + j ) % 3 ), nrPolls++;
+
+    master.enable ();
+    run ( controller, 500, 0 );
+
+    bool inOrder = s_nrOrder == nrPolls;
+
+    for ( uint16_t i = 1; i < s_nrOrder; i++ )
+    {
+        uint16_t prev = s_order[i - 1];
+        uint16_t poll = s_order[i];
+
+        // Lower priority after higher, and by number among equals
+        if ( s_priority[poll] > s_priority[prev] ||
+             ( s_priority[poll] == s_priority[prev] && poll < prev ) )
+            inOrder = false;
+    }
+
+    printf ( "first round of %u polls:", nrPolls );
+
+    for ( uint16_t i = 0; i < s_nrOrder; i++ )
+        printf ( " %u/%u", s_order[i], s_priority[s_order[i]] );
+
+    printf ( " %s\n", inOrder ? "OK" : "BAD" );
+
+    for ( uint16_t poll = 1; poll <= nrPolls; poll++ )
+        CHECK ( s_acks[poll] == 1 );
+
+    CHECK ( inOrder );
+
+    master.disable ();
+}
+
+// Every poll keeps its interval on a line with room to spare
+static void intervals ( void )
+{
+    DMX_Master      master ( 24, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+    uint16_t        fast[8];
+    uint16_t        slow[8];
+
+    reset ();
+    s_population.create ( 8, 4, 16 );
+    controller.onPollResponse ( onPollResponse );
+    master.enable ();
+
+    for ( uint8_t i = 0; i < 8; i++ )
+    {
+        fast[i] = addPoll ( controller, s_population.uid ( i ), rdm::DmxStartAddress, 100, 1 );
+        slow[i] = addPoll ( controller, s_population.uid ( i ), rdm::DeviceInfo, 1000, 0 );
+    }
+
+    controller.resetPollStats ();
+    uint32_t maxAge = run ( controller, 10000, 16 );
+
+    const RDM_PollStats &stats = controller.getPollStats ();
+    uint32_t fastAcks = 0, slowAcks = 0;
+
+    for ( uint8_t i = 0; i < 8; i++ )
+    {
+        fastAcks += s_acks[fast[i]];
+        slowAcks += s_acks[slow[i]];
+
+        CHECK ( s_acks[fast[i]] >= 95 && s_acks[fast[i]] <= 101 );
+        CHECK ( s_acks[slow[i]] >= 10 && s_acks[slow[i]] <= 11 );
+    }
+
+    printf ( "8 x 100 ms + 8 x 1000 ms in 10 s: %u + %u acks, %u req/s, max age %u ms, timeouts %u\n",
+             fastAcks, slowAcks, controller.getPollRate (), maxAge, stats.timeouts );
+
+    CHECK ( stats.requests == stats.acks );
+    CHECK ( stats.timeouts == 0 && stats.nacks == 0 );
+    // Due polls queue up for the gaps, a few ms each
+    CHECK ( maxAge <= 1000 + 50 );
+
+    master.disable ();
+}
+
+// More polls than a full universe leaves gaps for, the high priority
+// polls keep their interval and the rest share what is left
+static void overload ( void )
+{
+    DMX_Master      master ( 512, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+    uint16_t        high[20];
+    uint16_t        low[20];
+
+    reset ();
+    s_population.create ( 20, 5, 16 );
+    controller.onPollResponse ( onPollResponse );
+    master.enable ();
+
+    for ( uint8_t i = 0; i < 20; i++ )
+    {
+        low[i]  = addPoll ( controller, s_population.uid ( i ), rdm::DeviceInfo, 200, 0 );
+        high[i] = addPoll ( controller, s_population.uid ( i ), rdm::DmxStartAddress, 1000, 5 );
+    }
+
+    controller.resetPollStats ();
+    run ( controller, 10000, 0 );
+
+    uint32_t highAcks = 0, lowAcks = 0, highAge = 0;
+
+    for ( uint8_t i = 0; i < 20; i++ )
+    {
+        highAcks += s_acks[high[i]];
+        lowAcks  += s_acks[low[i]];
+
+        if ( controller.getPollAge ( high[i] ) > highAge )
+            highAge = controller.getPollAge ( high[i] );
+
+        CHECK ( s_acks[high[i]] >= 9 );
+    }
+
+    printf ( "512 channels, 20 x 1000 ms high + 20 x 200 ms low in 10 s: %u fps, %u req/s, "
+             "high %u acks (age %u ms), low %u acks (1000 wanted)\n",
+             master.getFrameRate (), controller.getPollRate (), highAcks, highAge, lowAcks );
+
+    CHECK ( highAge <= 1000 + 100 );
+    CHECK ( lowAcks > 0 && lowAcks < 1000 );
+
+    master.disable ();
+}
+
+// Unknown PIDs are NACKed every interval, responders that are gone are
+// given up after the retries and tried again after the interval
+static void failures ( void )
+{
+    DMX_Master      master ( 24, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+
+    reset ();
+    s_population.create ( 1, 6, 16 );
+    controller.onPollResponse ( onPollResponse );
+    master.enable ();
+
+    uint16_t known  = addPoll ( controller, s_population.uid ( 0 ), rdm::DeviceInfo, 500, 0 );
+    uint16_t nack   = addPoll ( controller, s_population.uid ( 0 ), 0x8123, 500, 0 );
+    uint16_t gone   = addPoll ( controller, RDM_Uid::make ( 0x7fff, 0x1 ), rdm::DeviceInfo, 500, 0 );
+
+    controller.resetPollStats ();
+    run ( controller, 5000, 0 );
+
+    const RDM_PollStats &stats = controller.getPollStats ();
+
+    printf ( "unknown PID %u nacks, gone %u lost | req %u ack %u nack %u timeout %u retry %u fail %u\n",
+             s_nacks[nack], s_lost[gone], stats.requests, stats.acks, stats.nacks,
+             stats.timeouts, stats.retries, stats.failures );
+
+    CHECK ( s_acks[known] >= 10 && s_nacks[known] == 0 && s_lost[known] == 0 );
+    CHECK ( s_nacks[nack] >= 10 && s_acks[nack] == 0 && s_lost[nack] == 0 );
+    CHECK ( s_lost[gone] >= 9 && s_acks[gone] == 0 && s_nacks[gone] == 0 );
+
+    // First attempt and two retries for every failure
+    CHECK ( stats.failures == s_lost[gone] );
+    CHECK ( stats.retries == 2 * stats.failures );
+    CHECK ( stats.timeouts == 3 * stats.failures );
+    CHECK ( stats.nacks == s_nacks[nack] );
+
+    master.disable ();
+}
+
+int main ( void )
+{
+    order ();
+    intervals ();
+    overload ();
+    failures ();
+
+    return hostResult ( "RDM_Poll_Scheduling" );
+}
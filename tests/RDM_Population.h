@@ -0,0 +1,176 @@
+/*
+  RDM_Population.h - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  A population of RDM responders on one simulated line. Every
+  responder is a DMX_Slave with an RDM_Responder on a port of its own
+  (1 and up), wired to the controller on port 0 in both directions.
+  Responses of several responders at the same moment collide on the
+  line (see DMX_Transport::connect).
+*/
+
+#ifndef RDM_POPULATION_H_
+#define RDM_POPULATION_H_
+
+#include "Host_Test.h"
+
+#include <stdlib.h>
+
+#define POPULATION_MAX      ( DMX_SIM_MAX_PORTS - 1 )
+
+class RDM_Population
+{
+    public:
+        RDM_Population ( void ) : m_slots ( 0 ), m_count ( 0 ) {};
+        ~RDM_Population ( void ) { clear (); };
+
+        // Responders with random UIDs, seed picks the UIDs. With a single
+        // manufacturer half of them get sequential device ids
+        void create ( uint16_t count, unsigned seed, uint16_t manufacturers )
+        {
+            clear ();
+            srand ( seed );
+
+            while ( m_count < count )
+            {
+                uint16_t m  = 0x4c00 + rand () % manufacturers;
+                uint32_t d  = ( (uint32_t)rand () << 16 ) ^ rand ();
+
+                if ( manufacturers == 1 && rand () % 2 )
+                    d = m_count;
+
+                if ( find ( RDM_Uid::make ( m, d ) ) < 0 )
+                    add ( RDM_Uid::make ( m, d ) );
+            }
+        }
+
+        // Plug a responder in, it takes the first free port
+        RDM_Responder &add ( const RDM_Uid &uid )
+        {
+            uint16_t slot = 0;
+
+            while ( slot < m_slots && m_responders[slot] )
+                slot++;
+
+            if ( slot == m_slots )
+                m_slots++;
+
+            uint8_t     port    = slot + 1;
+            DMX_Slave   *slave  = new DMX_Slave ( 1, -1, port );
+
+            wire ( port );
+
+            m_uids[slot]        = uid;
+            m_slaves[slot]      = slave;
+            m_responders[slot]  = new RDM_Responder ( uid.manufacturer (),
+                                                      uid.m_id[2], uid.m_id[3],
+                                                      uid.m_id[4], uid.m_id[5], *slave );
+            slave->enable ();
+            m_responders[slot]->enable ();
+            m_count++;
+
+            return *m_responders[slot];
+        }
+
+        // Unplug a responder
+        void remove ( const RDM_Uid &uid )
+        {
+            int slot = find ( uid );
+
+            if ( slot < 0 )
+                return;
+
+            delete m_responders[slot];
+            delete m_slaves[slot];
+
+            m_responders[slot]  = NULL;
+            m_slaves[slot]      = NULL;
+            m_count--;
+        }
+
+        void clear ( void )
+        {
+            for ( uint16_t i = 0; i < m_slots; i++ )
+                if ( m_responders[i] )
+                    remove ( m_uids[i] );
+
+            m_slots = 0;
+        }
+
+        uint16_t count ( void )     { return m_count; };
+
+        // Responders are found by slot, empty slots are NULL
+        uint16_t slots ( void )                         { return m_slots; };
+        RDM_Responder *responder ( uint16_t slot )      { return m_responders[slot]; };
+        const RDM_Uid &uid ( uint16_t slot )            { return m_uids[slot]; };
+
+        int find ( const RDM_Uid &uid )
+        {
+            for ( uint16_t i = 0; i < m_slots; i++ )
+                if ( m_responders[i] && m_uids[i] == uid )
+                    return i;
+
+            return -1;
+        }
+
+        void service ( void )
+        {
+            for ( uint16_t i = 0; i < m_slots; i++ )
+                if ( m_slaves[i] )
+                    m_slaves[i]->service ();
+        }
+
+        // The controller knows every responder, and nothing else
+        bool matches ( RDM_Controller &controller )
+        {
+            if ( controller.getDeviceCount () != m_count )
+                return false;
+
+            for ( uint16_t i = 0; i < controller.getDeviceCount (); i++ )
+                if ( find ( controller.getDevice ( i ) ) < 0 )
+                    return false;
+
+            return true;
+        }
+
+    private:
+        // Ports stay wired once they are
+        static void wire ( uint8_t port )
+        {
+            static bool wired[DMX_SIM_MAX_PORTS];
+
+            if ( wired[port] )
+                return;
+
+            DMX_Transport &controller   = DMX_GetPort ( 0 )->usart;
+            DMX_Transport &responder    = DMX_GetPort ( port )->usart;
+
+            controller.connect ( responder );
+            responder.connect ( controller );
+            wired[port] = true;
+        }
+
+        uint16_t        m_slots;
+        uint16_t        m_count;
+        RDM_Uid         m_uids[POPULATION_MAX];
+        DMX_Slave       *m_slaves[POPULATION_MAX];
+        RDM_Responder   *m_responders[POPULATION_MAX];
+};
+
+#endif /* RDM_POPULATION_H_ */
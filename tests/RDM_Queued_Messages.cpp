@@ -0,0 +1,87 @@
+/*
+  RDM_Queued_Messages.cpp - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  RDM_Responder::queueMessage only takes parameters QUEUED_MESSAGE can
+  answer with their GET response. Every message taken is collected by
+  the controller in order, once the queue is empty the responder
+  answers with STATUS_MESSAGES.
+*/
+
+#include "RDM_Population.h"
+
+static RDM_Population   s_population;
+
+// GET QUEUED_MESSAGE, returns the PID of the response (0 when lost)
+static uint16_t getQueued ( RDM_Controller &controller, uint8_t type = rdm::StatusError )
+{
+    CHECK ( controller.sendRequest ( s_population.uid ( 0 ), rdm::GetCommand,
+                                     rdm::QueuedMessage, &type, 1 ) );
+
+    for ( uint16_t i = 0; i < 1000 && controller.isBusy (); i++ )
+    {
+        runMicros ( 100 );
+        controller.service ();
+        s_population.service ();
+    }
+
+    RDM_Message *msg = controller.getResponse ();
+
+    if ( !msg || msg->portId != rdm::ResponseTypeAck )
+        return 0;
+
+    return msg->PID;
+}
+
+int main ( void )
+{
+    DMX_Master      master ( 24, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+
+    s_population.create ( 1, 9, 16 );
+
+    RDM_Responder &responder = *s_population.responder ( 0 );
+
+    master.enable ();
+
+    // GET without data only
+    CHECK ( responder.queueMessage ( rdm::DmxStartAddress ) );
+    CHECK ( !responder.queueMessage ( rdm::SensorValue ) );
+    CHECK ( !responder.queueMessage ( 0x8123 ) );
+    CHECK ( responder.queueMessage ( rdm::DeviceLabel ) );
+    CHECK ( !responder.queueMessage ( rdm::DiscMute ) );
+    CHECK ( responder.getMessageCount () == 2 );
+
+    uint16_t first  = getQueued ( controller );
+    uint16_t second = getQueued ( controller );
+    uint16_t last   = getQueued ( controller, rdm::StatusGetLastMessage );
+    uint16_t empty  = getQueued ( controller );
+
+    printf ( "queued 0x%04x 0x%04x, last 0x%04x, then 0x%04x\n", first, second, last, empty );
+
+    CHECK ( first == rdm::DmxStartAddress );
+    CHECK ( second == rdm::DeviceLabel );
+    CHECK ( last == rdm::DeviceLabel );
+    CHECK ( empty == rdm::StatusMessages );
+    CHECK ( responder.getMessageCount () == 0 );
+
+    master.disable ();
+
+    return hostResult ( "RDM_Queued_Messages" );
+}
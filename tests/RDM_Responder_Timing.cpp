@@ -0,0 +1,147 @@
+/*
+  RDM_Responder_Timing.cpp - Host tests of the DMX library for Arduino
+  Copyright (c) 2013 W.A. van der Meeren <danny@illogic.nl>.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  Turnaround of a deferred RDM_Responder (setDeferred) serviced some
+  time after the request. The response has to start between the
+  minimum turnaround and the end of the responder window (Table 3-2
+  ANSI_E1-20-2010), a request serviced after the window is not
+  responded to and the responder keeps receiving.
+*/
+
+#include "RDM_Population.h"
+
+static RDM_Population   s_population;
+
+static uint64_t         s_lastTx;           // Last byte of the controller
+static uint64_t         s_responseBreak;    // Start of the response
+static uint32_t         s_responderBytes;
+
+static void onController ( uint8_t, bool isBreak, uint64_t cycle )
+{
+    if ( !isBreak )
+        s_lastTx = cycle;
+}
+
+static void onResponder ( uint8_t, bool isBreak, uint64_t cycle )
+{
+    // Breaks are reported when they end
+    if ( isBreak && !s_responseBreak )
+        s_responseBreak = cycle - DMX_GetPort ( 1 )->usart.getStats ().lastBreakCycles;
+
+    s_responderBytes++;
+}
+
+// GET DEVICE_INFO with the responder serviced delay_us after the end
+// of the request, returns the turnaround in µs (0 without a response)
+static uint32_t request ( RDM_Controller &controller, RDM_Responder &responder,
+                          uint32_t delay_us, bool &acked )
+{
+    uint64_t requestEnd = 0;
+
+    s_responseBreak     = 0;
+    s_responderBytes    = 0;
+
+    CHECK ( controller.sendRequest ( s_population.uid ( 0 ), rdm::GetCommand,
+                                     rdm::DeviceInfo, NULL, 0 ) );
+
+    for ( uint16_t i = 0; i < 10000 && ( controller.isBusy () || responder.requestPending () ); i++ )
+    {
+        runMicros ( 10 );
+        controller.service ();
+
+        if ( !requestEnd && responder.requestPending () )
+            requestEnd = s_lastTx;
+
+        if ( requestEnd && DMX_Transport::cycles () >= requestEnd + delay_us * CYCLES_PER_USEC )
+            s_population.service ();
+    }
+
+    RDM_Message *msg = controller.getResponse ();
+
+    acked = msg && msg->portId == rdm::ResponseTypeAck && msg->PID == rdm::DeviceInfo;
+
+    CHECK ( requestEnd );
+    CHECK ( !responder.requestPending () );
+
+    if ( !s_responseBreak )
+        return 0;
+
+    return ( s_responseBreak - requestEnd ) / CYCLES_PER_USEC;
+}
+
+int main ( void )
+{
+    DMX_Master      master ( 24, -1, 0 );
+    RDM_Controller  controller ( master, 0x7ff0, 0x0, 0x0, 0x0, 0x1 );
+
+    s_population.create ( 1, 14, 16 );
+
+    RDM_Responder   &responder = *s_population.responder ( 0 );
+
+    responder.setDeferred ( true );
+    master.getPort ()->usart.onLine ( onController );
+    DMX_GetPort ( 1 )->usart.onLine ( onResponder );
+    master.enable ();
+    runMicros ( 10000 );
+
+    // Serviced in time, the turnaround is kept from below
+    const uint32_t  inTime[] = { 0, 100, 1000, 1800 };
+
+    for ( uint8_t i = 0; i < sizeof ( inTime ) / sizeof ( inTime[0] ); i++ )
+    {
+        bool        acked;
+        uint32_t    turnaround = request ( controller, responder, inTime[i], acked );
+
+        printf ( "serviced after %4u us: turnaround %4u us, %s\n",
+                 inTime[i], turnaround, acked ? "ACK" : "lost" );
+
+        CHECK ( acked );
+        CHECK ( turnaround >= MIN_RESPONDER_PACKET_SPACING_USEC );
+        CHECK ( turnaround <= MAX_RESPONDER_PACKET_SPACING_USEC );
+    }
+
+    // Serviced too late, nothing goes on the line
+    const uint32_t  late[] = { 2100, 2900, 6000 };
+
+    for ( uint8_t i = 0; i < sizeof ( late ) / sizeof ( late[0] ); i++ )
+    {
+        bool        acked;
+        uint32_t    turnaround = request ( controller, responder, late[i], acked );
+
+        printf ( "serviced after %4u us: %u bytes sent, %s\n",
+                 late[i], s_responderBytes, acked ? "ACK" : "lost" );
+
+        CHECK ( !acked );
+        CHECK ( turnaround == 0 );
+        CHECK ( s_responderBytes == 0 );
+    }
+
+    // And the responder still answers the next request
+    bool acked;
+
+    request ( controller, responder, 100, acked );
+    CHECK ( acked );
+
+    master.disable ();
+    master.getPort ()->usart.onLine ( NULL );
+    DMX_GetPort ( 1 )->usart.onLine ( NULL );
+
+    return hostResult ( "RDM_Responder_Timing" );
+}